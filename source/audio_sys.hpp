@@ -14,6 +14,14 @@
 #include "external_libraries/mini_al/extras/dr_wav.h" // Enables WAV decoding.
 #include "external_libraries/mini_al/mini_al.h"
 
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define AUDIO_MIX_AVX
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define AUDIO_MIX_SSE
+#endif
+
 #define SAMPLES_PER_QUARTER_NOTE(sample_rate__, bpm__) ((60.0 / bpm__) * sample_rate__)
 
 #define LOOP_FRAME_4_4(measure_count__, quarter_notes_per_measure__, extra_quarter_notes__, sample_rate__, bpm__) \
@@ -26,6 +34,9 @@ typedef mal_uint32 mal_u32;
 enum struct AUDIO_COMMAND_TYPE : u8 {
     ADJUST_MASTER_VOLUME,
     DELAY,
+    VOICE_PLAY,
+    VOICE_STOP,
+    VOICE_SET,
     ENUM_COUNT
 };
 
@@ -59,6 +70,16 @@ struct AudioCommand {
             float32 channel_b_offset_percent;
             bool on;
         } delay;
+        // VOICE_STOP only reads index, VOICE_SET gain and pan
+        struct {
+            u8 index;
+            float32 gain;
+            float32 pan;
+            bool looping;
+            bool from_start;
+            u64 loop_start;
+            u64 loop_end;
+        } voice;
     };
 
     Fn_AudioCallback callback;
@@ -126,21 +147,64 @@ void add_animation(float* target, float target_value, float delta)
 
 
 #define MAX_AUDIO_SOURCE_COUNT (16)
+
+enum struct AUDIO_VOICE_STATE : u8 {
+    STOPPED,
+    PLAYING,
+};
+
+// one per decoder, every decoder must produce f32 stereo at the device's sample rate
+struct AudioVoice {
+    mal_decoder* decoder;
+    AUDIO_VOICE_STATE state;
+    float32 gain;
+    // -1 is left, 1 is right
+    float32 pan;
+    bool looping;
+    // in frames, a loop_end of 0 loops at the end of the source
+    u64 loop_start;
+    u64 loop_end;
+    u64 frame;
+};
+
+// frames decoded per voice at a time, the callback mixes larger requests in pieces
+#define AUDIO_MIX_CHUNK_FRAMES (1024)
+
+// out += in * gain per channel, interleaved stereo
+void audio_mix_stereo(float32* out, const float32* in, usize frame_count, float32 gain_l, float32 gain_r);
+#define AUDIO_COMMAND_QUEUE_CAPACITY (128)
+// a ck ring holds one less than its capacity, so every command can be in the return queue at once
+#define AUDIO_COMMAND_POOL_COUNT (AUDIO_COMMAND_QUEUE_CAPACITY - 1)
 struct AudioArgs {
     mal_decoder decoders[MAX_AUDIO_SOURCE_COUNT];
     u8 audio_source_count;
 
+    // main thread -> audio thread, commands from command_pool
+    ConcurrentFIFO_SingleProducerSingleConsumer<AUDIO_COMMAND_QUEUE_CAPACITY> fifo;
+    // audio thread -> main thread, commands handed back once copied
+    ConcurrentFIFO_SingleProducerSingleConsumer<AUDIO_COMMAND_QUEUE_CAPACITY> fifo_free;
 
-    ConcurrentFIFO_SingleProducerSingleConsumer<128> fifo;
+    // audio thread only once the device has started
+    AudioVoice voices[MAX_AUDIO_SOURCE_COUNT];
+
+    AudioCommand command_pool[AUDIO_COMMAND_POOL_COUNT];
+    // main thread only
+    AudioCommand* command_pool_free[AUDIO_COMMAND_POOL_COUNT];
+    usize command_pool_free_count;
 
-    AudioCommand command_buffer__[128 + 2];
-    usize command_buffer_count__;
-    usize command_buffer_idx__;
     usize total_frames_read;
 };
 
 void AudioArgs_init(AudioArgs* audio_sys, usize audio_source_count); 
 
+// main thread, a command from the pool or nullptr when all of them are in flight,
+// the audio thread never allocates or frees
+AudioCommand* AudioCommand_alloc(AudioArgs* audio_sys);
+// main thread, the command goes back to the pool when the queue is full
+bool AudioCommand_send(AudioArgs* audio_sys, AudioCommand* cmd);
+// audio thread, hands a dequeued command back to the main thread
+void AudioCommand_release(AudioArgs* audio_sys, AudioCommand* cmd);
+
 
 
 
@@ -159,9 +223,62 @@ void AudioArgs_init(AudioArgs* audio_sys, usize audio_source_count)
 {
     audio_sys->audio_source_count = audio_source_count;
     ck_ring_init(&audio_sys->fifo.ring, audio_sys->fifo.capacity);
-    audio_sys->command_buffer_count__ = audio_sys->fifo.capacity;
-    audio_sys->command_buffer_idx__ = 0;
+    ck_ring_init(&audio_sys->fifo_free.ring, audio_sys->fifo_free.capacity);
+    foreach (i, AUDIO_COMMAND_POOL_COUNT) {
+        audio_sys->command_pool_free[i] = &audio_sys->command_pool[i];
+    }
+    audio_sys->command_pool_free_count = AUDIO_COMMAND_POOL_COUNT;
     audio_sys->total_frames_read = 0;
+
+    foreach (i, MAX_AUDIO_SOURCE_COUNT) {
+        AudioVoice* voice = &audio_sys->voices[i];
+        voice->decoder    = &audio_sys->decoders[i];
+        voice->state      = AUDIO_VOICE_STATE::STOPPED;
+        voice->gain       = 1.0f;
+        voice->pan        = 0.0f;
+        voice->looping    = false;
+        voice->loop_start = 0;
+        voice->loop_end   = 0;
+        voice->frame      = 0;
+    }
+}
+
+AudioCommand* AudioCommand_alloc(AudioArgs* audio_sys)
+{
+    // collect what the audio thread has handed back since the last time
+    void* returned;
+    while (audio_sys->command_pool_free_count < AUDIO_COMMAND_POOL_COUNT &&
+           ck_ring_dequeue_spsc(&audio_sys->fifo_free.ring, audio_sys->fifo_free.buffer, &returned)) {
+        audio_sys->command_pool_free[audio_sys->command_pool_free_count] = (AudioCommand*)returned;
+        audio_sys->command_pool_free_count += 1;
+    }
+
+    if (audio_sys->command_pool_free_count == 0) {
+        fprintf(stderr, "ERROR: OUT OF AUDIO COMMANDS\n");
+        return nullptr;
+    }
+
+    audio_sys->command_pool_free_count -= 1;
+    AudioCommand* cmd = audio_sys->command_pool_free[audio_sys->command_pool_free_count];
+    memset(cmd, 0, sizeof(*cmd));
+    return cmd;
+}
+
+bool AudioCommand_send(AudioArgs* audio_sys, AudioCommand* cmd)
+{
+    if (ck_ring_enqueue_spsc(&audio_sys->fifo.ring, audio_sys->fifo.buffer, (void*)cmd) == false) {
+        fprintf(stderr, "ERROR: OUT OF AUDIO QUEUE SPACE\n");
+        audio_sys->command_pool_free[audio_sys->command_pool_free_count] = cmd;
+        audio_sys->command_pool_free_count += 1;
+        return false;
+    }
+    return true;
+}
+
+void AudioCommand_release(AudioArgs* audio_sys, AudioCommand* cmd)
+{
+    // cannot fail, the ring has room for the whole pool
+    ck_ring_enqueue_spsc(&audio_sys->fifo_free.ring, audio_sys->fifo_free.buffer, (void*)cmd);
 }
 
 struct AudioSystem {
@@ -209,40 +326,92 @@ void AudioSystem_init(void)
 }
 
 
-mal_u32 on_send_frames_to_device(mal_device* p_device, mal_u32 frame_count, void* p_samples)
+void audio_mix_stereo(float32* out, const float32* in, usize frame_count, float32 gain_l, float32 gain_r)
 {
-    struct AudioArgs* args = (struct AudioArgs*)p_device->pUserData;
-    if (args == NULL) {
-        return 0;
+    const usize count = frame_count * 2;
+    usize i = 0;
+#if defined(AUDIO_MIX_AVX)
+    const __m256 g = _mm256_setr_ps(gain_l, gain_r, gain_l, gain_r, gain_l, gain_r, gain_l, gain_r);
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_mul_ps(_mm256_loadu_ps(in + i), g)));
     }
+#elif defined(AUDIO_MIX_SSE)
+    const __m128 g = _mm_setr_ps(gain_l, gain_r, gain_l, gain_r);
+    for (; i + 8 <= count; i += 8) {
+        const __m128 a = _mm_add_ps(_mm_loadu_ps(out + i),     _mm_mul_ps(_mm_loadu_ps(in + i),     g));
+        const __m128 b = _mm_add_ps(_mm_loadu_ps(out + i + 4), _mm_mul_ps(_mm_loadu_ps(in + i + 4), g));
+        _mm_storeu_ps(out + i,     a);
+        _mm_storeu_ps(out + i + 4, b);
+    }
+#endif
+    for (; i < count; i += 2) {
+        out[i]     += in[i]     * gain_l;
+        out[i + 1] += in[i + 1] * gain_r;
+    }
+}
 
-    mal_decoder* decoders = args->decoders;
+// decodes up to frame_count frames of the voice into out, wrapping at its loop points,
+// stops the voice at the end of a source that does not loop
+static usize AudioVoice_read(AudioVoice* voice, float32* out, usize frame_count)
+{
+    usize done = 0;
+    while (done < frame_count && voice->state == AUDIO_VOICE_STATE::PLAYING) {
+        usize want = frame_count - done;
+        if (voice->looping && voice->loop_end > voice->frame) {
+            want = glm::min<usize>(want, voice->loop_end - voice->frame);
+        }
 
-    mal_u32 frames_read = (mal_u32)mal_decoder_read(&decoders[0], frame_count, p_samples);
+        const usize got = (usize)mal_decoder_read(voice->decoder, want, out + (done * 2));
+        done         += got;
+        voice->frame += got;
 
-    // detect if audio finished playing
-    if (frames_read == 0) {
+        const bool at_loop_end = voice->looping && voice->loop_end != 0 && voice->frame >= voice->loop_end;
+        if (got == want && !at_loop_end) {
+            continue;
+        }
 
-        // loop bgm
-        // (44100 = 1 second into the clip, given a sample rate of 44.1 KHz)
+        // nothing left to play, or nothing between the loop start and the end of the source
+        if (!voice->looping || (got == 0 && voice->frame == voice->loop_start)) {
+            voice->state = AUDIO_VOICE_STATE::STOPPED;
+            break;
+        }
+        mal_decoder_seek_to_frame(voice->decoder, voice->loop_start);
+        voice->frame = voice->loop_start;
+    }
+    return done;
+}
 
-        // for the current iteration of "Time Rush" (July 18th, 2018), which plays at 170 bpm,
-        // the loop-point is 26 measures in at 4/4 (26 * 4 quarter notes) plus 1 quater note
-        // samples per quarter note = (60 / BPM) * SAMPLE_RATE
-        // e.g. (60.0 / 170) * 44100 * 26 * 4
+// adds every playing voice into out with its gain and pan
+static void audio_mix_voices(AudioArgs* args, float32* out, usize frame_count)
+{
+    static float32 scratch[AUDIO_MIX_CHUNK_FRAMES * 2];
 
-        #define SAMPLE_RATE (44100)
-        #define BPM (170)
-        #define MEASURE_COUNT (26)
-        #define QUARTER_NOTES_PER_MEASURE (4)
+    foreach (v, MAX_AUDIO_SOURCE_COUNT) {
+        AudioVoice* voice = &args->voices[v];
+        if (voice->state != AUDIO_VOICE_STATE::PLAYING) {
+            continue;
+        }
 
-        mal_decoder_seek_to_frame(&decoders[0], (mal_uint64)roundf(
-           LOOP_FRAME_4_4(MEASURE_COUNT, QUARTER_NOTES_PER_MEASURE, 1, SAMPLE_RATE, BPM)
-        ));
+        const float32 gain_l = voice->gain * glm::min(1.0f, 1.0f - voice->pan);
+        const float32 gain_r = voice->gain * glm::min(1.0f, 1.0f + voice->pan);
 
-        // read samples from loop point
-        frames_read = (mal_u32)mal_decoder_read(&decoders[0], frame_count, p_samples);
+        for (usize at = 0; at < frame_count && voice->state == AUDIO_VOICE_STATE::PLAYING; at += AUDIO_MIX_CHUNK_FRAMES) {
+            const usize count = glm::min<usize>(AUDIO_MIX_CHUNK_FRAMES, frame_count - at);
+            const usize got = AudioVoice_read(voice, scratch, count);
+            audio_mix_stereo(out + (at * 2), scratch, got, gain_l, gain_r);
+        }
     }
+}
+
+mal_u32 on_send_frames_to_device(mal_device* p_device, mal_u32 frame_count, void* p_samples)
+{
+    struct AudioArgs* args = (struct AudioArgs*)p_device->pUserData;
+    if (args == NULL) {
+        return 0;
+    }
+
+    // the voices are mixed after the commands so that starts and stops apply to this buffer
+    const mal_u32 frames_read = frame_count;
 
     void* result;
 
@@ -265,7 +434,7 @@ mal_u32 on_send_frames_to_device(mal_device* p_device, mal_u32 frame_count, void
 
         RingBuffer_enqueue(&audio_system.command_queue, *cmd);
 
-        free(cmd); // temporary, will have a static buffer to avoid allocations and frees at runtime
+        AudioCommand_release(args, cmd);
 
     }
 
@@ -329,12 +498,45 @@ mal_u32 on_send_frames_to_device(mal_device* p_device, mal_u32 frame_count, void
             }
             break;
         }
+        case AUDIO_COMMAND_TYPE::VOICE_PLAY: {
+            if (cmd->voice.index >= args->audio_source_count) {
+                break;
+            }
+            AudioVoice* voice = &args->voices[cmd->voice.index];
+            voice->gain       = cmd->voice.gain;
+            voice->pan        = cmd->voice.pan;
+            voice->looping    = cmd->voice.looping;
+            voice->loop_start = cmd->voice.loop_start;
+            voice->loop_end   = cmd->voice.loop_end;
+            if (cmd->voice.from_start || voice->state == AUDIO_VOICE_STATE::STOPPED) {
+                mal_decoder_seek_to_frame(voice->decoder, 0);
+                voice->frame = 0;
+            }
+            voice->state = AUDIO_VOICE_STATE::PLAYING;
+            break;
+        }
+        case AUDIO_COMMAND_TYPE::VOICE_STOP: {
+            if (cmd->voice.index < args->audio_source_count) {
+                args->voices[cmd->voice.index].state = AUDIO_VOICE_STATE::STOPPED;
+            }
+            break;
+        }
+        case AUDIO_COMMAND_TYPE::VOICE_SET: {
+            if (cmd->voice.index < args->audio_source_count) {
+                args->voices[cmd->voice.index].gain = cmd->voice.gain;
+                args->voices[cmd->voice.index].pan  = cmd->voice.pan;
+            }
+            break;
+        }
         default: { 
             break; 
         } 
         }
     }
 
+    memset(p_samples, 0, (usize)frame_count * 2 * sizeof(float32));
+    audio_mix_voices(args, (float32*)p_samples, frame_count);
+
     // handle delay
     if (delay_is_on) {
 
@@ -0,0 +1,459 @@
+// micro-benchmarks, CPU side only (no GL context is created)
+// enable with #define BENCHMARKING in run.cpp
+
+#include "mesh_generator.cpp"
+#include "mesh_optimizer.cpp"
+#include "mesh_cache.cpp"
+
+struct Benchmark_Timer {
+    u64 begin;
+};
+
+inline void Benchmark_Timer_start(Benchmark_Timer* t)
+{
+    t->begin = SDL_GetPerformanceCounter();
+}
+
+inline f64 Benchmark_Timer_ms(Benchmark_Timer* t)
+{
+    return (f64)((SDL_GetPerformanceCounter() - t->begin) * 1000) / (f64)SDL_GetPerformanceFrequency();
+}
+
+inline void benchmark_report(const char* name, const usize count, const f64 ms)
+{
+    printf("%-40s %10llu in %10.3lf ms, %12.1lf / ms\n", name, (unsigned long long)count, ms, (f64)count / ms);
+}
+
+// prevents the compiler from discarding the generated data
+static volatile GLfloat benchmark_sink;
+
+// the previous per-point trig + matrix path of sd::polygon_convex_regular, kept for comparison
+static void benchmark_polygon_reference(GLfloat* out, GLfloat radius, Vec3 center, const usize count_sides)
+{
+    GLdouble angle_turn = -(TAU) / count_sides;
+    for (usize p = 0, off = 0; p < count_sides; ++p, off += 7) {
+        Vec3 point = Vec3(Mat4(1.0f) * 
+            Vec4(
+                (radius * glm::cos(p * angle_turn)) + center.x,
+                (radius * glm::sin(p * angle_turn)) + center.y,
+                center.z,
+                1.0f
+            )
+        );
+        out[off]     = point.x;
+        out[off + 1] = point.y;
+        out[off + 2] = point.z;
+    }
+}
+
+void benchmark_shapes(void)
+{
+    static constexpr usize SHAPE_COUNT = 1 << 18;
+    static constexpr usize SIDES       = 32;
+    static constexpr usize BATCH_SIZE  = 2048;
+
+    puts("shapes, 32-sided circles");
+
+    Benchmark_Timer timer;
+
+    {
+        GLfloat* out = (GLfloat*)xmalloc(SIDES * 7 * sizeof(GLfloat));
+        Benchmark_Timer_start(&timer);
+        foreach (i, SHAPE_COUNT) {
+            benchmark_polygon_reference(out, 5.0f, Vec3(i & 1023, i >> 10, 1.0f), SIDES);
+            benchmark_sink = out[0];
+        }
+        benchmark_report("before: trig + Mat4 per point", SHAPE_COUNT, Benchmark_Timer_ms(&timer));
+        ::free(out);
+    }
+
+    {
+        auto* batch = (sd::Render_Batch<BATCH_SIZE>*)xcalloc(1, sizeof(sd::Render_Batch<BATCH_SIZE>));
+        batch->vao_triangles.stride = sd::Render_Batch<BATCH_SIZE>::DEFAULT_ATTRIBUTE_STRIDE;
+        batch->draw_type = GL_TRIANGLES;
+        batch->color = Color::BLUE;
+
+        sd::unit_polygon(SIDES);
+
+        Benchmark_Timer_start(&timer);
+        foreach (i, SHAPE_COUNT) {
+            if (batch->triangle_buffer.v_count + (SIDES * 7) > BATCH_SIZE * 7) {
+                benchmark_sink = batch->vertices_triangles[0];
+                batch->reset(batch);
+            }
+            sd::circle(batch, 5.0f, Vec3(i & 1023, i >> 10, 1.0f), SIDES);
+        }
+        benchmark_report("after: unit polygon table", SHAPE_COUNT, Benchmark_Timer_ms(&timer));
+        ::free(batch);
+    }
+
+    {
+        auto* batch = (sd::Render_Batch_Instanced<BATCH_SIZE>*)xcalloc(1, sizeof(sd::Render_Batch_Instanced<BATCH_SIZE>));
+        batch->draw_type = GL_TRIANGLES;
+        batch->color = Color::BLUE;
+
+        Benchmark_Timer_start(&timer);
+        foreach (i, SHAPE_COUNT) {
+            if (batch->count == BATCH_SIZE) {
+                benchmark_sink = batch->instances[0].radius;
+                batch->count = 0;
+            }
+            sd::circle(batch, 5.0f, Vec3(i & 1023, i >> 10, 1.0f), SIDES);
+        }
+        benchmark_report("after: instanced record", SHAPE_COUNT, Benchmark_Timer_ms(&timer));
+        ::free(batch);
+    }
+}
+
+static constexpr usize BENCHMARK_LINES_BATCH_SIZE = 1 << 17;
+
+// a contiguous range of line indices, split evenly between the workers
+struct Benchmark_Lines_Job {
+    usize first;
+    usize count;
+};
+
+static void benchmark_lines_proc(sd::Render_Batch<BENCHMARK_LINES_BATCH_SIZE>* batch, usize worker_index, usize count_workers, void* data)
+{
+    auto* job = (Benchmark_Lines_Job*)data;
+
+    const usize per_worker = job->count / count_workers;
+    const usize begin = job->first + (worker_index * per_worker);
+    const usize end   = (worker_index + 1 == count_workers) ? job->first + job->count : begin + per_worker;
+
+    sd::color(batch, Color::GREEN);
+    for (usize i = begin; i < end; ++i) {
+        const GLfloat x = (GLfloat)(i & 1023);
+        const GLfloat y = (GLfloat)((i >> 10) & 1023);
+        sd::line(batch, Vec3(x, y, 1.0f), Vec3(x + 4.0f, y + 4.0f, 1.0f));
+    }
+}
+
+void benchmark_batch_builder(void)
+{
+    static constexpr usize LINE_COUNT      = 1 << 20;
+    // one round fills the destination batch, as one frame would
+    static constexpr usize LINES_PER_ROUND = BENCHMARK_LINES_BATCH_SIZE / 2;
+
+    puts("batch building, 1M lines");
+
+    Benchmark_Timer timer;
+
+    auto* dst = (sd::Render_Batch<BENCHMARK_LINES_BATCH_SIZE>*)xmalloc(sizeof(sd::Render_Batch<BENCHMARK_LINES_BATCH_SIZE>));
+    sd::cpu_init(dst);
+
+    {
+        Benchmark_Timer_start(&timer);
+        for (usize first = 0; first < LINE_COUNT; first += LINES_PER_ROUND) {
+            Benchmark_Lines_Job job = {first, LINES_PER_ROUND};
+
+            dst->reset(dst);
+            benchmark_lines_proc(dst, 0, 1, &job);
+            benchmark_sink = dst->vertices_lines[dst->line_buffer.v_count - 1];
+        }
+        benchmark_report("main thread only", LINE_COUNT, Benchmark_Timer_ms(&timer));
+    }
+
+    const usize thread_counts[] = {1, 2, 4, 8};
+    for (usize count_threads : thread_counts) {
+        sd::Render_Batch_Builder<BENCHMARK_LINES_BATCH_SIZE> builder;
+        if (sd::Render_Batch_Builder_init(&builder, count_threads) == false) {
+            continue;
+        }
+
+        Benchmark_Timer merge_timer;
+        f64 ms_merge = 0.0;
+
+        Benchmark_Timer_start(&timer);
+        for (usize first = 0; first < LINE_COUNT; first += LINES_PER_ROUND) {
+            Benchmark_Lines_Job job = {first, LINES_PER_ROUND};
+
+            sd::Render_Batch_Builder_build(&builder, benchmark_lines_proc, &job);
+
+            Benchmark_Timer_start(&merge_timer);
+            dst->reset(dst);
+            sd::Render_Batch_Builder_merge(&builder, dst);
+            ms_merge += Benchmark_Timer_ms(&merge_timer);
+
+            benchmark_sink = dst->vertices_lines[dst->line_buffer.v_count - 1];
+        }
+        const f64 ms = Benchmark_Timer_ms(&timer);
+
+        char name[64];
+        snprintf(name, sizeof(name), "%llu threads, build + merge", (unsigned long long)count_threads);
+        benchmark_report(name, LINE_COUNT, ms);
+        snprintf(name, sizeof(name), "%llu threads, merge only", (unsigned long long)count_threads);
+        benchmark_report(name, LINE_COUNT, ms_merge);
+
+        sd::Render_Batch_Builder_free(&builder);
+    }
+
+    ::free(dst);
+}
+
+void benchmark_culling(void)
+{
+    static constexpr usize LINE_COUNT = BENCHMARK_LINES_BATCH_SIZE / 2;
+    static constexpr usize FRAMES     = 100;
+
+    puts("culling, 64k lines recorded by the null batch, a quarter of them in view");
+
+    Benchmark_Timer timer;
+
+    auto* batch = (sd::Null_Render_Batch<BENCHMARK_LINES_BATCH_SIZE>*)xmalloc(sizeof(sd::Null_Render_Batch<BENCHMARK_LINES_BATCH_SIZE>));
+
+    const bool culls[] = {false, true};
+    for (bool cull : culls) {
+        batch->init();
+        if (cull) {
+            // the lines are laid out in 64 rows of 1024
+            sd::cull_rect_set(&batch->geometry, Vec2(0.0f), Vec2(1024.0f, 16.0f));
+        }
+        sd::Null_Recorder_reset(&sd::null_recorder);
+
+        Benchmark_Timer_start(&timer);
+        foreach (f, FRAMES) {
+            Benchmark_Lines_Job job = {0, LINE_COUNT};
+
+            batch->begin();
+            benchmark_lines_proc(&batch->geometry, 0, 1, &job);
+            batch->end();
+        }
+        const f64 ms = Benchmark_Timer_ms(&timer);
+
+        benchmark_report((cull) ? "culled, add + record" : "unculled, add + record", LINE_COUNT * FRAMES, ms);
+        printf("%-40s %10.1lf\n", "  draws per frame", (f64)sd::null_recorder.draw_calls / FRAMES);
+        printf("%-40s %10.1lf\n", "  indices per frame", (f64)sd::null_recorder.index_count / FRAMES);
+    }
+
+    ::free(batch);
+}
+
+void benchmark_sprites(void)
+{
+    static constexpr usize SPRITE_COUNT = 50000;
+    static constexpr usize FRAMES       = 100;
+    static constexpr usize TEXTURES     = 8;
+    // sprites in a row with the same texture
+    static constexpr usize SPAN         = 7;
+
+    puts("sprites, 50k per frame over 8 textures, interleaved every 7");
+
+    Benchmark_Timer timer;
+
+    // the default size, full batches flush through end() like they would in a frame
+    auto* batch = (sd::Render_Batch_Sprite<>*)xmalloc(sizeof(sd::Render_Batch_Sprite<>));
+
+    const bool sorts[] = {false, true};
+    for (bool sort : sorts) {
+        batch->cpu_init();
+        batch->sort_by_texture = sort;
+
+        Benchmark_Timer_start(&timer);
+        foreach (f, FRAMES) {
+            batch->begin();
+            foreach (i, SPRITE_COUNT) {
+                const GLfloat x = (GLfloat)(i & 1023);
+                const GLfloat y = (GLfloat)((i >> 10) & 1023);
+                batch->sprite(Vec3(x, y, 1.0f), Vec2(16.0f), Vec2(0.0f), Vec2(1.0f), (Texture)(1 + ((i / SPAN) % TEXTURES)));
+            }
+            batch->end();
+            benchmark_sink = batch->vertices[0].position.x;
+        }
+        const f64 ms = Benchmark_Timer_ms(&timer);
+
+        benchmark_report((sort) ? "sorted by texture, add + build" : "submission order, add + build", SPRITE_COUNT * FRAMES, ms);
+        printf("%-40s %10.1lf\n", "  draws per frame", (f64)batch->count_draws / FRAMES);
+    }
+
+    ::free(batch);
+}
+
+void benchmark_parametric_meshes(void)
+{
+    static constexpr GLint M     = 512;
+    static constexpr usize ITERS = 8;
+
+    puts("parametric meshes, 512 x 512");
+
+    Benchmark_Timer timer;
+
+    const GLuint count_vertices = gl_mesh::parametric::grid_vertex_count(M, M);
+    const GLuint count_indices  = gl_mesh::parametric::grid_index_count(M, M);
+    GLfloat* V = (GLfloat*)xmalloc(count_vertices * gl_mesh::parametric::VERTEX_STRIDE * sizeof(GLfloat));
+    GLuint*  I = (GLuint*)xmalloc(count_indices * sizeof(GLuint));
+
+    const char* names_before[] = {"before: sphere, vector per corner", "before: torus, vector per corner"};
+    const char* names_after[]  = {"after: sphere, indexed into buffer", "after: torus, indexed into buffer"};
+    foreach (k, 2) {
+        Benchmark_Timer_start(&timer);
+        foreach (it, ITERS) {
+            std::vector<GLfloat> out = (k == 0) ? gl_mesh::parametric::sphere(M, M) : gl_mesh::parametric::torus(M, M);
+            benchmark_sink = out[out.size() / 2];
+        }
+        benchmark_report(names_before[k], (usize)(M * M) * ITERS, Benchmark_Timer_ms(&timer));
+
+        Benchmark_Timer_start(&timer);
+        foreach (it, ITERS) {
+            if (k == 0) {
+                gl_mesh::parametric::sphere_vertices(V, M, M);
+            } else {
+                gl_mesh::parametric::torus_vertices(V, M, M);
+            }
+            gl_mesh::parametric::grid_indices(I, M, M);
+            benchmark_sink = V[(count_vertices / 2) * gl_mesh::parametric::VERTEX_STRIDE] + (GLfloat)I[count_indices / 2];
+        }
+        benchmark_report(names_after[k], (usize)(M * M) * ITERS, Benchmark_Timer_ms(&timer));
+    }
+
+    printf("%-40s %10llu -> %llu vertices, %llu indices\n", "  per mesh",
+        (unsigned long long)(M * M * 6), (unsigned long long)count_vertices, (unsigned long long)count_indices
+    );
+
+    ::free(V);
+    ::free(I);
+}
+
+static void benchmark_mesh_optimizer_report(const char* name, gl_mesh::MeshData& mesh)
+{
+    Benchmark_Timer timer;
+    Benchmark_Timer_start(&timer);
+    gl_mesh::OptimizedMesh optimized(mesh);
+    const f64 ms = Benchmark_Timer_ms(&timer);
+
+    benchmark_report(name, mesh.num_indices() / 3, ms);
+    printf("%-40s %10.3f -> %.3f\n", "  ACMR, FIFO 16",
+        gl_mesh::optimizer::acmr(mesh.index_data(), mesh.num_indices(), mesh.num_vertices()),
+        gl_mesh::optimizer::acmr(optimized.index_data(), optimized.num_indices(), optimized.num_vertices())
+    );
+}
+
+void benchmark_mesh_lod(void)
+{
+    puts("mesh lod, sphere 256 x 128 of radius 50, 0.5px error");
+
+    gl_mesh::parametric::SphereLOD sphere(256, 128);
+
+    const GLfloat scales[] = {0.125f, 0.25f, 0.5f, 1.0f, 2.0f, 4.0f};
+    for (GLfloat scale : scales) {
+        const GLuint l = sphere.select(50.0f, scale);
+        printf("  camera scale %5.3f: level %u, %7u of %u triangles\n", scale, l,
+            sphere.levels[l].count_indices / 3, sphere.levels[0].count_indices / 3
+        );
+    }
+}
+
+void benchmark_mesh_cache(void)
+{
+    puts("mesh cache, sphere lod 512 x 256");
+
+    Benchmark_Timer timer;
+    // read back so that mapping pays for its page faults too
+    GLfloat sum = 0.0f;
+
+    Benchmark_Timer_start(&timer);
+    {
+        gl_mesh::parametric::SphereLOD sphere(512, 256);
+        const GLfloat* v = sphere.vertex_data();
+        for (GLuint i = 0; i < sphere.num_vertices(); i += 128) {
+            sum += v[i * gl_mesh::parametric::VERTEX_STRIDE];
+        }
+    }
+    printf("%-40s %10.3lf ms\n", "before: generate", Benchmark_Timer_ms(&timer));
+
+    gl_mesh::MappedMesh mesh;
+    Benchmark_Timer_start(&timer);
+    // the first call writes the file when the cache is empty
+    gl_mesh::cache::sphere_lod(&mesh, MESH_CACHE_DIR, 512, 256);
+    printf("%-40s %10.3lf ms\n", "first run: generate + write + map", Benchmark_Timer_ms(&timer));
+
+    Benchmark_Timer_start(&timer);
+    if (gl_mesh::cache::sphere_lod(&mesh, MESH_CACHE_DIR, 512, 256)) {
+        const GLfloat* v = mesh.vertex_data();
+        for (GLuint i = 0; i < mesh.num_vertices(); i += 128) {
+            sum += v[i * gl_mesh::parametric::VERTEX_STRIDE];
+        }
+    }
+    printf("%-40s %10.3lf ms\n", "after: map cached file", Benchmark_Timer_ms(&timer));
+
+    benchmark_sink = sum;
+}
+
+void benchmark_mesh_optimizer(void)
+{
+    puts("mesh optimizer, vertex cache + overdraw + fetch");
+
+    gl_mesh::parametric::Sphere sphere(128);
+    gl_mesh::parametric::Torus torus(128, 64);
+    gl_mesh::platonic_solid::Cube cube;
+
+    benchmark_mesh_optimizer_report("sphere 128 x 128, triangles", sphere);
+    benchmark_mesh_optimizer_report("torus 128 x 64, triangles", torus);
+    benchmark_mesh_optimizer_report("cube, triangles", cube);
+}
+
+// the mix without SIMD, kept for comparison
+static void benchmark_audio_mix_reference(float32* out, const float32* in, usize frame_count, float32 gain_l, float32 gain_r)
+{
+    for (usize frame = 0; frame < frame_count; ++frame) {
+        for (usize channel = 0; channel < 2; ++channel) {
+            out[(frame * 2) + channel] += in[(frame * 2) + channel] * ((channel == 0) ? gain_l : gain_r);
+        }
+    }
+}
+
+void benchmark_audio_mix(void)
+{
+    static constexpr usize VOICES    = MAX_AUDIO_SOURCE_COUNT;
+    static constexpr usize FRAMES    = 512;
+    static constexpr usize CALLBACKS = 20000;
+    // frames of output per millisecond
+    static constexpr f64 FRAMES_PER_MS = 44.1;
+
+    puts("audio mix, 16 voices into 512-frame stereo callbacks at 44.1 kHz");
+
+    Benchmark_Timer timer;
+
+    float32* out = (float32*)xcalloc(FRAMES * 2, sizeof(float32));
+    float32* in  = (float32*)xmalloc(VOICES * FRAMES * 2 * sizeof(float32));
+    foreach (i, VOICES * FRAMES * 2) {
+        in[i] = (float32)((i * 2654435761u) & 0xFFFF) / 65536.0f - 0.5f;
+    }
+
+    foreach (k, 2) {
+        Benchmark_Timer_start(&timer);
+        foreach (c, CALLBACKS) {
+            memset(out, 0, FRAMES * 2 * sizeof(float32));
+            foreach (v, VOICES) {
+                const float32 gain = 1.0f / (1 + v);
+                if (k == 0) {
+                    benchmark_audio_mix_reference(out, in + (v * FRAMES * 2), FRAMES, gain, 1.0f - gain);
+                } else {
+                    audio_mix_stereo(out, in + (v * FRAMES * 2), FRAMES, gain, 1.0f - gain);
+                }
+            }
+            benchmark_sink = out[c & (FRAMES * 2 - 1)];
+        }
+        const f64 ms = Benchmark_Timer_ms(&timer);
+
+        benchmark_report((k == 0) ? "before: scalar, voice-frames" : "after: SIMD, voice-frames", VOICES * FRAMES * CALLBACKS, ms);
+        // how many voices one millisecond of output could carry if the callback spent all of it mixing
+        printf("%-40s %10.1lf\n", "  voices per ms of callback budget", ((f64)(VOICES * FRAMES * CALLBACKS) / ms) / FRAMES_PER_MS);
+    }
+
+    ::free(out);
+    ::free(in);
+}
+
+void benchmarks(void)
+{
+    benchmark_shapes();
+    benchmark_batch_builder();
+    benchmark_culling();
+    benchmark_sprites();
+    benchmark_parametric_meshes();
+    benchmark_mesh_optimizer();
+    benchmark_mesh_lod();
+    benchmark_mesh_cache();
+    benchmark_audio_mix();
+}
@@ -327,4 +327,27 @@ Mat4 FreeCamera_calc_screen_to_world_matrix(FreeCamera* view)
            glm::translate(Vec3(Vec2(view->position), 0.0));   
 }
 
-        
\ No newline at end of file
+        
+
+World_Rect FreeCamera_visible_world_rect(FreeCamera* view, Vec2 viewport_size)
+{
+    const Mat4 screen_to_world = FreeCamera_calc_screen_to_world_matrix(view);
+
+    const Vec2 corners[4] = {
+        Vec2(0.0f, 0.0f),
+        Vec2(viewport_size.x, 0.0f),
+        Vec2(0.0f, viewport_size.y),
+        viewport_size
+    };
+
+    World_Rect rect;
+    rect.min = Vec2(screen_to_world * Vec4(corners[0], 0.0f, 1.0f));
+    rect.max = rect.min;
+    for (usize i = 1; i < 4; ++i) {
+        const Vec2 p = Vec2(screen_to_world * Vec4(corners[i], 0.0f, 1.0f));
+        rect.min = glm::min(rect.min, p);
+        rect.max = glm::max(rect.max, p);
+    }
+
+    return rect;
+}
@@ -158,6 +158,14 @@ Mat4 FreeCamera_calc_view_matrix(FreeCamera* view);
 Mat4 FreeCamera_calc_calc_reverse_translation(FreeCamera* view);
 Mat4 FreeCamera_calc_screen_to_world_matrix(FreeCamera* view);
 
+struct World_Rect {
+    Vec2 min;
+    Vec2 max;
+};
+
+// world-space rectangle shown in a viewport of the given size, accounts for position, offset and scale
+World_Rect FreeCamera_visible_world_rect(FreeCamera* view, Vec2 viewport_size);
+
 void FreeCamera_target_set(FreeCamera* view, Vec2 target);
 void FreeCamera_target_x_set(FreeCamera* view, f64 target);
 void FreeCamera_target_y_set(FreeCamera* view, f64 target);
@@ -153,12 +153,14 @@ void debug_print(const char* const in);
 typedef void* (*Fn_Memory_Allocator)(usize bytes);
 typedef void (*Fn_Memory_Deallocator)(void* memory);
 
-#define PROGRAM_ARGS_COUNT (2)
+#define PROGRAM_ARGS_COUNT (3)
 extern struct option program_args[PROGRAM_ARGS_COUNT + 1];
 
 typedef struct {
     bool verbose;
     bool hot_config;
+    // room directory to stream the level from, see world.hpp
+    const char* world;
 } CommandLineArgs;
 
 bool parse_command_line_args(CommandLineArgs* cmd, const int argc, char* argv[]);
@@ -411,6 +413,7 @@ void debug_print(const char* const in)
 struct option program_args[PROGRAM_ARGS_COUNT + 1] = {
     {"verbose", no_argument, NULL, 'v'},
     {"hotconfig", no_argument, NULL, 'c'},
+    {"world", required_argument, NULL, 'w'},
     {0, 0, 0, 0}
 };
 
@@ -421,7 +424,7 @@ bool parse_command_line_args(CommandLineArgs* cmd, const int argc, char* argv[])
     // later
     char c = '\0';
 
-    while ((c = getopt_long(argc, argv, "vc", program_args, NULL)) != -1) {
+    while ((c = getopt_long(argc, argv, "vcw:", program_args, NULL)) != -1) {
         switch (c) {
         // number of additional threads
         case 'v':
@@ -430,6 +433,9 @@ bool parse_command_line_args(CommandLineArgs* cmd, const int argc, char* argv[])
         case 'c':
             cmd->hot_config = true;
             break;
+        case 'w':
+            cmd->world = optarg;
+            break;
         // missing arg
         case ':':
             fprintf(stderr, "%s: option '-%c' requires an argument\n",
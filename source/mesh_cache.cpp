@@ -0,0 +1,294 @@
+#include "mesh_cache.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <sys/stat.h>
+#ifdef _WIN32
+    #include <direct.h>
+#else
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace gl_mesh {
+
+const cache::Layout cache::LAYOUT_POS_NORM_UV = {
+    8, 3, {
+        {cache::ATTRIBUTE::POSITION, 3, 0},
+        {cache::ATTRIBUTE::NORMAL,   3, 3},
+        {cache::ATTRIBUTE::UV,       2, 6},
+    }
+};
+
+static uint64_t cache_align(uint64_t offset)
+{
+    return (offset + (cache::ALIGNMENT - 1)) & ~(uint64_t)(cache::ALIGNMENT - 1);
+}
+
+uint64_t cache::hash(const void* data, size_t size, uint64_t h)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+uint64_t cache::hash_file(const char* path)
+{
+    FILE* in = fopen(path, "rb");
+    if (in == nullptr) {
+        fprintf(stderr, "ERROR: could not open %s\n", path);
+        return 0;
+    }
+
+    uint64_t h = cache::hash(nullptr, 0);
+    unsigned char chunk[4096];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        h = cache::hash(chunk, count, h);
+    }
+    fclose(in);
+
+    return h;
+}
+
+void cache::path(char* out, size_t cap, const char* dir, uint64_t hash)
+{
+    snprintf(out, cap, "%s/%016llx.mesh", dir, (unsigned long long)hash);
+}
+
+bool cache::write(const char* path, uint64_t hash, MeshData& mesh, const Layout& layout,
+                  const parametric::LODMesh::Level* levels, GLuint count_levels)
+{
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic          = cache::MAGIC;
+    header.version        = cache::VERSION;
+    header.hash           = hash;
+    header.layout         = layout;
+    header.count_vertices = mesh.num_vertices();
+    header.count_indices  = mesh.num_indices();
+    header.vertex_offset  = cache_align(sizeof(header));
+    header.index_offset   = cache_align(header.vertex_offset + (uint64_t)header.count_vertices * layout.stride * sizeof(GLfloat));
+
+    if (levels != nullptr && count_levels > 0) {
+        header.count_levels = std::min(count_levels, parametric::LODMesh::MAX_LEVELS);
+        std::copy(levels, levels + header.count_levels, header.levels);
+    } else {
+        header.count_levels = 1;
+        header.levels[0].base_vertex    = 0;
+        header.levels[0].count_vertices = header.count_vertices;
+        header.levels[0].first_index    = 0;
+        header.levels[0].count_indices  = header.count_indices;
+    }
+
+    const size_t size = header.index_offset + (size_t)header.count_indices * sizeof(GLuint);
+    unsigned char* data = (unsigned char*)calloc(size, 1);
+    if (data == nullptr) {
+        fprintf(stderr, "ERROR: out of memory writing %s\n", path);
+        return false;
+    }
+    memcpy(data, &header, sizeof(header));
+    memcpy(data + header.vertex_offset, mesh.vertex_data(), (size_t)header.count_vertices * layout.stride * sizeof(GLfloat));
+    memcpy(data + header.index_offset, mesh.index_data(), (size_t)header.count_indices * sizeof(GLuint));
+
+    // written next to the destination and renamed so a reader never maps a partial file
+    char tmp_path[1024];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE* out = fopen(tmp_path, "wb");
+    if (out == nullptr) {
+        fprintf(stderr, "ERROR: could not open %s for writing\n", tmp_path);
+        free(data);
+        return false;
+    }
+    const bool written = fwrite(data, 1, size, out) == size;
+    fclose(out);
+    free(data);
+
+    if (!written) {
+        fprintf(stderr, "ERROR: could not write %s\n", tmp_path);
+        remove(tmp_path);
+        return false;
+    }
+    #ifdef _WIN32
+    remove(path);
+    #endif
+    if (rename(tmp_path, path) != 0) {
+        fprintf(stderr, "ERROR: could not rename %s to %s\n", tmp_path, path);
+        remove(tmp_path);
+        return false;
+    }
+
+    return true;
+}
+
+static void cache_make_dir(const char* dir)
+{
+    #ifdef _WIN32
+    _mkdir(dir);
+    #else
+    mkdir(dir, 0755);
+    #endif
+}
+
+template <typename LOD>
+static bool cache_lod(MappedMesh* out, const char* dir, const char* name, GLint m, GLint n, GLuint count_levels)
+{
+    // everything that changes the output, the generator's name, its parameters and the format
+    uint64_t h = cache::hash(name, strlen(name));
+    h = cache::hash(&m, sizeof(m), h);
+    h = cache::hash(&n, sizeof(n), h);
+    h = cache::hash(&count_levels, sizeof(count_levels), h);
+    h = cache::hash(&cache::VERSION, sizeof(cache::VERSION), h);
+
+    char path[1024];
+    cache::path(path, sizeof(path), dir, h);
+
+    struct stat info;
+    if (stat(path, &info) == 0 && out->open(path, h)) {
+        return true;
+    }
+
+    LOD lod(m, n, count_levels);
+    cache_make_dir(dir);
+    if (!cache::write(path, h, lod, cache::LAYOUT_POS_NORM_UV, lod.levels, lod.count_levels)) {
+        return false;
+    }
+
+    return out->open(path, h);
+}
+
+bool cache::sphere_lod(MappedMesh* out, const char* dir, GLint m, GLint n, GLuint count_levels)
+{
+    return cache_lod<parametric::SphereLOD>(out, dir, "sphere", m, n, count_levels);
+}
+bool cache::torus_lod(MappedMesh* out, const char* dir, GLint m, GLint n, GLuint count_levels)
+{
+    return cache_lod<parametric::TorusLOD>(out, dir, "torus", m, n, count_levels);
+}
+
+// MAPPED MESH
+
+MappedMesh::MappedMesh(void)
+    : header(nullptr), size(0)
+{
+}
+MappedMesh::~MappedMesh(void)
+{
+    this->close();
+}
+
+bool MappedMesh::open(const char* path, uint64_t expected_hash)
+{
+    this->close();
+
+    #ifdef _WIN32
+    FILE* in = fopen(path, "rb");
+    if (in == nullptr) {
+        fprintf(stderr, "ERROR: could not open %s\n", path);
+        return false;
+    }
+    fseek(in, 0, SEEK_END);
+    const long length = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    void* data = (length > 0) ? malloc(length) : nullptr;
+    if (data == nullptr || fread(data, 1, length, in) != (size_t)length) {
+        fprintf(stderr, "ERROR: could not read %s\n", path);
+        free(data);
+        fclose(in);
+        return false;
+    }
+    fclose(in);
+    this->size = length;
+    #else
+    const int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: could not open %s\n", path);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        fprintf(stderr, "ERROR: could not stat %s\n", path);
+        ::close(fd);
+        return false;
+    }
+    // private so that vertex_data() may be written without touching the file
+    void* data = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "ERROR: could not map %s\n", path);
+        return false;
+    }
+    this->size = info.st_size;
+    #endif
+    this->header = (const cache::FileHeader*)data;
+
+    const cache::FileHeader* h = this->header;
+    bool valid = this->size >= sizeof(cache::FileHeader) &&
+                 h->magic == cache::MAGIC &&
+                 h->version == cache::VERSION &&
+                 (expected_hash == 0 || h->hash == expected_hash) &&
+                 h->layout.stride > 0 &&
+                 h->count_levels >= 1 && h->count_levels <= parametric::LODMesh::MAX_LEVELS &&
+                 h->vertex_offset <= this->size &&
+                 (uint64_t)h->count_vertices * h->layout.stride * sizeof(GLfloat) <= this->size - h->vertex_offset &&
+                 h->index_offset <= this->size &&
+                 (uint64_t)h->count_indices * sizeof(GLuint) <= this->size - h->index_offset;
+    for (GLuint l = 0; valid && l < h->count_levels; l++) {
+        const parametric::LODMesh::Level* level = &h->levels[l];
+        valid = (uint64_t)level->first_index + level->count_indices <= h->count_indices &&
+                (uint64_t)level->base_vertex + level->count_vertices <= h->count_vertices;
+    }
+    if (!valid) {
+        fprintf(stderr, "ERROR: %s is not a cached mesh of version %u or is stale\n", path, cache::VERSION);
+        this->close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedMesh::close(void)
+{
+    if (this->header == nullptr) {
+        return;
+    }
+
+    #ifdef _WIN32
+    free((void*)this->header);
+    #else
+    munmap((void*)this->header, this->size);
+    #endif
+    this->header = nullptr;
+    this->size   = 0;
+}
+
+GLuint MappedMesh::select(GLfloat world_scale, GLfloat camera_scale, GLfloat max_error_px) const
+{
+    return parametric::LODMesh::select_level(this->header->levels, this->header->count_levels,
+                                             world_scale, camera_scale, max_error_px);
+}
+
+GLuint MappedMesh::num_vertices(void)
+{
+    return this->header->count_vertices;
+}
+GLuint MappedMesh::num_indices(void)
+{
+    return this->header->count_indices;
+}
+GLfloat* MappedMesh::vertex_data(void)
+{
+    return (GLfloat*)((const char*)this->header + this->header->vertex_offset);
+}
+GLuint* MappedMesh::index_data(void)
+{
+    return (GLuint*)((const char*)this->header + this->header->index_offset);
+}
+
+}
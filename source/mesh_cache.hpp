@@ -0,0 +1,105 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "mesh_generator.hpp"
+
+#include <cstdint>
+#include <cstddef>
+
+// relative to the working directory, like textures/ and shaders/
+#define MESH_CACHE_DIR "mesh_cache"
+
+namespace gl_mesh {
+
+struct MappedMesh;
+
+// binary meshes written once and mapped on later runs, no parsing:
+// the header with the vertex layout and the LOD table, then the vertex blob and the index blob,
+// each at a cache-line aligned offset, native byte order.
+// files are named by a hash of whatever produced them, dir/0123456789abcdef.mesh
+struct cache {
+    static constexpr GLuint MAGIC = 0x3148534d; // "MSH1"
+    static constexpr GLuint VERSION = 1;
+    static constexpr GLuint MAX_ATTRIBUTES = 8;
+    static constexpr GLuint ALIGNMENT = 64;
+
+    enum struct ATTRIBUTE : GLuint {
+        POSITION = 0,
+        NORMAL   = 1,
+        UV       = 2,
+        COLOR    = 3,
+    };
+
+    struct Attribute {
+        ATTRIBUTE semantic;
+        GLuint components;
+        // in floats from the start of the vertex
+        GLuint offset;
+    };
+
+    struct Layout {
+        // floats per vertex
+        GLuint stride;
+        GLuint count_attributes;
+        Attribute attributes[MAX_ATTRIBUTES];
+    };
+
+    // pos, norm, uv as generated by parametric and platonic_solid
+    static const Layout LAYOUT_POS_NORM_UV;
+
+    struct FileHeader {
+        GLuint magic;
+        GLuint version;
+        uint64_t hash;
+        Layout layout;
+        GLuint count_vertices;
+        GLuint count_indices;
+        // from the start of the file
+        uint64_t vertex_offset;
+        uint64_t index_offset;
+        GLuint count_levels;
+        GLuint pad_;
+        parametric::LODMesh::Level levels[parametric::LODMesh::MAX_LEVELS];
+    };
+
+    // FNV-1a, chain calls through h to hash several fields
+    static uint64_t hash(const void* data, size_t size, uint64_t h = 14695981039346656037ull);
+    static uint64_t hash_file(const char* path);
+
+    // dir/<hash>.mesh
+    static void path(char* out, size_t cap, const char* dir, uint64_t hash);
+
+    // a mesh without levels is written as a single level covering every index
+    static bool write(const char* path, uint64_t hash, MeshData& mesh, const Layout& layout,
+                      const parametric::LODMesh::Level* levels = nullptr, GLuint count_levels = 0);
+
+    // maps the cached LOD chain, generating and writing it first when there is none
+    static bool sphere_lod(MappedMesh* out, const char* dir, GLint m, GLint n, GLuint count_levels = parametric::LODMesh::MAX_LEVELS);
+    static bool torus_lod(MappedMesh* out, const char* dir, GLint m, GLint n, GLuint count_levels = parametric::LODMesh::MAX_LEVELS);
+};
+
+// a .mesh file, mapped copy-on-write where mmap exists and read into memory otherwise
+struct MappedMesh : public MeshData {
+    const cache::FileHeader* header;
+    size_t size;
+
+    MappedMesh(void);
+    ~MappedMesh(void);
+    MappedMesh(const MappedMesh&) = delete;
+    MappedMesh& operator=(const MappedMesh&) = delete;
+
+    // fails on a missing file, another version or a hash other than expected_hash (0 accepts any)
+    bool open(const char* path, uint64_t expected_hash = 0);
+    void close(void);
+
+    GLuint select(GLfloat world_scale, GLfloat camera_scale, GLfloat max_error_px = 0.5f) const;
+
+    virtual GLuint num_vertices(void);
+    virtual GLuint num_indices(void);
+    virtual GLfloat* vertex_data(void);
+    virtual GLuint* index_data(void);
+};
+
+}
+
+#endif // MESH_CACHE_H
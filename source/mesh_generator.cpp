@@ -1,15 +1,23 @@
 #include "mesh_generator.hpp"
 #include <iostream>
+#include <cmath>
+#include <algorithm>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define MESH_GENERATOR_SSE2
+#endif
 
 namespace gl_mesh {
 
 // PARAMETRIC
 
+static constexpr double TORUS_MINOR_RADIUS = 0.3;
+
 std::vector<GLfloat> parametric::SphereFunction::operator() (GLfloat u, GLfloat v)
 {
-    const double PI = glm::pi<double>();
-    const double theta = 2 * PI * u;
-    const double phi = PI * (v - 0.5);
+    const double pi = glm::pi<double>();
+    const double theta = 2 * pi * u;
+    const double phi = pi * (v - 0.5);
 
     double c = glm::cos(theta) * glm::cos(phi);
     double s = glm::sin(theta) * glm::cos(phi);
@@ -28,11 +36,11 @@ std::vector<GLfloat> parametric::SphereFunction::operator() (GLfloat u, GLfloat
 
 std::vector<GLfloat> parametric::TorusFunction::operator() (GLfloat u, GLfloat v)
 {
-    const double PI = glm::pi<double>();
-    const double theta = 2 * PI * u;
-    const double phi = 2 * PI * v;
+    const double pi = glm::pi<double>();
+    const double theta = 2 * pi * u;
+    const double phi = 2 * pi * v;
 
-    double r = 0.3;
+    double r = TORUS_MINOR_RADIUS;
 
     double c = glm::cos(theta) * (1 + r * glm::cos(phi));
     double s = glm::sin(theta) * (1 + r * glm::cos(phi));
@@ -119,16 +127,219 @@ std::vector<GLfloat> parametric::torus(GLint m, GLint n)
     return V;   
 }
 
+// INDEXED PARAMETRIC
+
+// Cephes-style sin/cos, x = q * pi/2 + r with |r| <= pi/4,
+// the scalar version is also the SIMD tail so both agree
+static const GLfloat SINCOS_2_OVER_PI = 0.636619772367581f;
+static const GLfloat SINCOS_DP1 = 1.5703125f;
+static const GLfloat SINCOS_DP2 = 4.837512969970703125e-4f;
+static const GLfloat SINCOS_DP3 = 7.54978995489188216e-8f;
+static const GLfloat SINCOS_S0 = -1.9515295891e-4f;
+static const GLfloat SINCOS_S1 =  8.3321608736e-3f;
+static const GLfloat SINCOS_S2 = -1.6666654611e-1f;
+static const GLfloat SINCOS_C0 =  2.443315711809948e-5f;
+static const GLfloat SINCOS_C1 = -1.388731625493765e-3f;
+static const GLfloat SINCOS_C2 =  4.166664568298827e-2f;
+
+static inline void mesh_sincos(GLfloat x, GLfloat* c, GLfloat* s)
+{
+    const GLint q = (GLint)std::nearbyint(x * SINCOS_2_OVER_PI);
+    const GLfloat qf = (GLfloat)q;
+    const GLfloat r = ((x - qf * SINCOS_DP1) - qf * SINCOS_DP2) - qf * SINCOS_DP3;
+    const GLfloat z = r * r;
+
+    const GLfloat sr = r + r * z * ((SINCOS_S0 * z + SINCOS_S1) * z + SINCOS_S2);
+    const GLfloat cr = 1.0f - 0.5f * z + z * z * ((SINCOS_C0 * z + SINCOS_C1) * z + SINCOS_C2);
+
+    switch (q & 3) {
+    case 0: *s =  sr; *c =  cr; break;
+    case 1: *s =  cr; *c = -sr; break;
+    case 2: *s = -sr; *c = -cr; break;
+    case 3: *s = -cr; *c =  sr; break;
+    }
+}
+
+void parametric::sincos_steps(GLfloat* c, GLfloat* s, GLuint count, GLfloat start, GLfloat step)
+{
+    GLuint k = 0;
+#if defined(MESH_GENERATOR_SSE2)
+    const __m128 two_over_pi = _mm_set1_ps(SINCOS_2_OVER_PI);
+    const __m128 dp1 = _mm_set1_ps(SINCOS_DP1);
+    const __m128 dp2 = _mm_set1_ps(SINCOS_DP2);
+    const __m128 dp3 = _mm_set1_ps(SINCOS_DP3);
+    const __m128 s0  = _mm_set1_ps(SINCOS_S0);
+    const __m128 s1  = _mm_set1_ps(SINCOS_S1);
+    const __m128 s2  = _mm_set1_ps(SINCOS_S2);
+    const __m128 c0  = _mm_set1_ps(SINCOS_C0);
+    const __m128 c1  = _mm_set1_ps(SINCOS_C1);
+    const __m128 c2  = _mm_set1_ps(SINCOS_C2);
+    const __m128 one  = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i i1 = _mm_set1_epi32(1);
+    const __m128i i2 = _mm_set1_epi32(2);
+
+    const __m128 lane = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128 vstep  = _mm_set1_ps(step);
+    const __m128 vstart = _mm_set1_ps(start);
+
+    for (; k + 4 <= count; k += 4) {
+        // same angle as the scalar path, start + k * step
+        const __m128 x = _mm_add_ps(vstart, _mm_mul_ps(_mm_add_ps(_mm_set1_ps((GLfloat)k), lane), vstep));
+
+        // round to nearest under the default MXCSR mode
+        const __m128i q  = _mm_cvtps_epi32(_mm_mul_ps(x, two_over_pi));
+        const __m128  qf = _mm_cvtepi32_ps(q);
+        __m128 r = _mm_sub_ps(x, _mm_mul_ps(qf, dp1));
+        r = _mm_sub_ps(r, _mm_mul_ps(qf, dp2));
+        r = _mm_sub_ps(r, _mm_mul_ps(qf, dp3));
+        const __m128 z = _mm_mul_ps(r, r);
+
+        __m128 sr = _mm_add_ps(_mm_mul_ps(s0, z), s1);
+        sr = _mm_add_ps(_mm_mul_ps(sr, z), s2);
+        sr = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, z), sr));
+
+        __m128 cr = _mm_add_ps(_mm_mul_ps(c0, z), c1);
+        cr = _mm_add_ps(_mm_mul_ps(cr, z), c2);
+        cr = _mm_add_ps(_mm_sub_ps(one, _mm_mul_ps(half, z)), _mm_mul_ps(_mm_mul_ps(z, z), cr));
+
+        // odd quadrants swap sin and cos, the sign bits come from q & 2 and (q + 1) & 2
+        const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, i1), i1));
+        const __m128 sign_s = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, i2), 30));
+        const __m128 sign_c = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, i1), i2), 30));
+
+        const __m128 vs = _mm_or_ps(_mm_and_ps(swap, cr), _mm_andnot_ps(swap, sr));
+        const __m128 vc = _mm_or_ps(_mm_and_ps(swap, sr), _mm_andnot_ps(swap, cr));
+
+        _mm_storeu_ps(s + k, _mm_xor_ps(vs, sign_s));
+        _mm_storeu_ps(c + k, _mm_xor_ps(vc, sign_c));
+    }
+#endif
+    for (; k < count; k += 1) {
+        mesh_sincos(start + (GLfloat)k * step, &c[k], &s[k]);
+    }
+}
+
+GLuint parametric::grid_vertex_count(GLint m, GLint n)
+{
+    return (GLuint)((m + 1) * (n + 1));
+}
+GLuint parametric::grid_index_count(GLint m, GLint n)
+{
+    return (GLuint)(m * n * 6);
+}
+
+void parametric::grid_indices(GLuint* I, GLint m, GLint n, GLuint base_vertex)
+{
+    const GLuint row = (GLuint)m + 1;
+    for (GLint j = 0; j < n; j++) {
+        GLuint a = base_vertex + (GLuint)j * row;
+        for (GLint i = 0; i < m; i++, a++, I += 6) {
+            const GLuint b = a + 1;
+            const GLuint c = a + row;
+            const GLuint d = c + 1;
+            I[0] = a;
+            I[1] = b;
+            I[2] = d;
+            I[3] = d;
+            I[4] = c;
+            I[5] = a;
+        }
+    }
+}
+
+// the grid is separable, so sin/cos are evaluated once per column and row
+// in chunks that fit on the stack instead of once per vertex
+static constexpr GLuint GRID_TRIG_CHUNK = 256;
+
+enum struct GRID_SURFACE {
+    SPHERE,
+    TORUS,
+};
+
+static void grid_vertices(GLfloat* V, GLint m, GLint n, GRID_SURFACE surface)
+{
+    const GLfloat pi = glm::pi<GLfloat>();
+    const GLuint columns = (GLuint)m + 1;
+    const GLuint rows    = (GLuint)n + 1;
+
+    const GLfloat theta_step = 2 * pi / m;
+    const GLfloat phi_start  = (surface == GRID_SURFACE::SPHERE) ? -0.5f * pi : 0.0f;
+    const GLfloat phi_step   = ((surface == GRID_SURFACE::SPHERE) ? pi : 2 * pi) / n;
+    const GLfloat r = (GLfloat)TORUS_MINOR_RADIUS;
+
+    GLfloat cos_theta[GRID_TRIG_CHUNK];
+    GLfloat sin_theta[GRID_TRIG_CHUNK];
+    GLfloat cos_phi[GRID_TRIG_CHUNK];
+    GLfloat sin_phi[GRID_TRIG_CHUNK];
+
+    for (GLuint i0 = 0; i0 < columns; i0 += GRID_TRIG_CHUNK) {
+        const GLuint count_i = std::min(GRID_TRIG_CHUNK, columns - i0);
+        parametric::sincos_steps(cos_theta, sin_theta, count_i, i0 * theta_step, theta_step);
+
+        for (GLuint j0 = 0; j0 < rows; j0 += GRID_TRIG_CHUNK) {
+            const GLuint count_j = std::min(GRID_TRIG_CHUNK, rows - j0);
+            parametric::sincos_steps(cos_phi, sin_phi, count_j, phi_start + j0 * phi_step, phi_step);
+
+            for (GLuint jj = 0; jj < count_j; jj++) {
+                const GLuint j = j0 + jj;
+                const GLfloat v = j / (GLfloat)n;
+                const GLfloat cp = cos_phi[jj];
+                const GLfloat sp = sin_phi[jj];
+
+                GLfloat* out = V + ((j * columns) + i0) * parametric::VERTEX_STRIDE;
+                if (surface == GRID_SURFACE::SPHERE) {
+                    for (GLuint ii = 0; ii < count_i; ii++, out += parametric::VERTEX_STRIDE) {
+                        const GLfloat x = cos_theta[ii] * cp;
+                        const GLfloat y = sin_theta[ii] * cp;
+                        out[0] = x;
+                        out[1] = y;
+                        out[2] = sp;
+                        out[3] = x;
+                        out[4] = y;
+                        out[5] = sp;
+                        out[6] = (i0 + ii) / (GLfloat)m;
+                        out[7] = v;
+                    }
+                } else {
+                    const GLfloat ring = 1 + r * cp;
+                    for (GLuint ii = 0; ii < count_i; ii++, out += parametric::VERTEX_STRIDE) {
+                        out[0] = cos_theta[ii] * ring;
+                        out[1] = sin_theta[ii] * ring;
+                        out[2] = r * sp;
+                        out[3] = r * cp * cos_theta[ii];
+                        out[4] = r * cp * sin_theta[ii];
+                        out[5] = r * sp;
+                        out[6] = (i0 + ii) / (GLfloat)m;
+                        out[7] = v;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void parametric::sphere_vertices(GLfloat* V, GLint m, GLint n)
+{
+    grid_vertices(V, m, n, GRID_SURFACE::SPHERE);
+}
+void parametric::torus_vertices(GLfloat* V, GLint m, GLint n)
+{
+    grid_vertices(V, m, n, GRID_SURFACE::TORUS);
+}
+
 parametric::Sphere::Sphere(GLint m) 
     : parametric::Sphere::Sphere(m, m)   
 {
 }
 parametric::Sphere::Sphere(GLint m, GLint n)
 {
-    this->_vertex_data = parametric::sphere(m, n);
-    this->_num_vertices = this->_vertex_data.size() / 8;
-    this->_index_data = MeshData::create_linear_indices(this->_num_vertices);
-    this->_num_indices = this->_index_data.size();
+    this->_num_vertices = parametric::grid_vertex_count(m, n);
+    this->_num_indices = parametric::grid_index_count(m, n);
+    this->_vertex_data.resize(this->_num_vertices * parametric::VERTEX_STRIDE);
+    this->_index_data.resize(this->_num_indices);
+    parametric::sphere_vertices(&(this->_vertex_data[0]), m, n);
+    parametric::grid_indices(&(this->_index_data[0]), m, n);
 }
 
 GLuint parametric::Sphere::num_vertices(void)
@@ -155,10 +366,12 @@ parametric::Torus::Torus(GLint m)
 }
 parametric::Torus::Torus(GLint m, GLint n)
 {
-    this->_vertex_data = parametric::torus(m, n);
-    this->_num_vertices = this->_vertex_data.size() / 8;
-    this->_index_data = MeshData::create_linear_indices(this->_num_vertices);
-    this->_num_indices = this->_index_data.size();
+    this->_num_vertices = parametric::grid_vertex_count(m, n);
+    this->_num_indices = parametric::grid_index_count(m, n);
+    this->_vertex_data.resize(this->_num_vertices * parametric::VERTEX_STRIDE);
+    this->_index_data.resize(this->_num_indices);
+    parametric::torus_vertices(&(this->_vertex_data[0]), m, n);
+    parametric::grid_indices(&(this->_index_data[0]), m, n);
 }
 
 GLuint parametric::Torus::num_vertices(void)
@@ -178,6 +391,106 @@ GLuint* parametric::Torus::index_data(void)
     return &(this->_index_data[0]);
 }
 
+// LOD
+
+void parametric::LODMesh::build(void (*generate)(GLfloat* V, GLint m, GLint n), GLint m, GLint n, GLuint count_levels)
+{
+    count_levels = std::max(1u, std::min(count_levels, MAX_LEVELS));
+
+    // stop once both directions reach the minimum
+    this->count_levels = 0;
+    GLuint total_vertices = 0;
+    GLuint total_indices  = 0;
+    for (GLuint l = 0; l < count_levels; l++) {
+        Level* level = &this->levels[l];
+        level->m = (l == 0) ? m : std::max(std::min(MIN_SEGMENTS, m), m >> l);
+        level->n = (l == 0) ? n : std::max(std::min(MIN_SEGMENTS, n), n >> l);
+        if (l > 0 && level->m == this->levels[l - 1].m && level->n == this->levels[l - 1].n) {
+            break;
+        }
+
+        level->base_vertex    = total_vertices;
+        level->count_vertices = parametric::grid_vertex_count(level->m, level->n);
+        level->first_index    = total_indices;
+        level->count_indices  = parametric::grid_index_count(level->m, level->n);
+        level->error          = 0.0f;
+
+        total_vertices += level->count_vertices;
+        total_indices  += level->count_indices;
+        this->count_levels++;
+    }
+
+    this->_vertex_data.resize(total_vertices * parametric::VERTEX_STRIDE);
+    this->_index_data.resize(total_indices);
+    for (GLuint l = 0; l < this->count_levels; l++) {
+        const Level* level = &this->levels[l];
+        generate(&(this->_vertex_data[level->base_vertex * parametric::VERTEX_STRIDE]), level->m, level->n);
+        parametric::grid_indices(&(this->_index_data[level->first_index]), level->m, level->n, level->base_vertex);
+    }
+}
+
+GLuint parametric::LODMesh::select(GLfloat world_scale, GLfloat camera_scale, GLfloat max_error_px) const
+{
+    return select_level(this->levels, this->count_levels, world_scale, camera_scale, max_error_px);
+}
+GLuint parametric::LODMesh::select_level(const Level* levels, GLuint count_levels,
+                                         GLfloat world_scale, GLfloat camera_scale, GLfloat max_error_px)
+{
+    const GLfloat px_per_unit = world_scale * camera_scale;
+    for (GLuint l = count_levels - 1; l > 0; l--) {
+        if (levels[l].error * px_per_unit <= max_error_px) {
+            return l;
+        }
+    }
+    return 0;
+}
+
+GLuint parametric::LODMesh::num_vertices(void)
+{
+    return (GLuint)(this->_vertex_data.size() / parametric::VERTEX_STRIDE);
+}
+GLuint parametric::LODMesh::num_indices(void)
+{
+    return (GLuint)this->_index_data.size();
+}
+GLfloat* parametric::LODMesh::vertex_data(void)
+{
+    return &(this->_vertex_data[0]);
+}
+GLuint* parametric::LODMesh::index_data(void)
+{
+    return &(this->_index_data[0]);
+}
+
+// sagitta of a circle of radius r split into arcs of the given angle
+static GLfloat chord_error(GLfloat r, GLfloat angle)
+{
+    return r * (1.0f - std::cos(0.5f * angle));
+}
+
+parametric::SphereLOD::SphereLOD(GLint m, GLint n, GLuint count_levels)
+{
+    const GLfloat pi = glm::pi<GLfloat>();
+
+    this->build(parametric::sphere_vertices, m, n, count_levels);
+    for (GLuint l = 0; l < this->count_levels; l++) {
+        Level* level = &this->levels[l];
+        level->error = std::max(chord_error(1.0f, 2 * pi / level->m), chord_error(1.0f, pi / level->n));
+    }
+}
+
+parametric::TorusLOD::TorusLOD(GLint m, GLint n, GLuint count_levels)
+{
+    const GLfloat pi = glm::pi<GLfloat>();
+    const GLfloat r  = (GLfloat)TORUS_MINOR_RADIUS;
+
+    this->build(parametric::torus_vertices, m, n, count_levels);
+    for (GLuint l = 0; l < this->count_levels; l++) {
+        Level* level = &this->levels[l];
+        level->error = std::max(chord_error(1.0f + r, 2 * pi / level->m), chord_error(r, 2 * pi / level->n));
+    }
+}
+
 // PLATONIC SOLIDS
 
 GLuint platonic_solid::Cube::_num_vertices = 24;
@@ -43,6 +43,21 @@ struct parametric {
     static std::vector<GLfloat> torus(GLint m);
     static std::vector<GLfloat> torus(GLint m, GLint n);
 
+    // indexed generation into caller-provided buffers, no allocation,
+    // an m x n grid shares its (m + 1) * (n + 1) vertices (pos, norm, uv)
+    // and is drawn with m * n * 6 indices in the same winding as add_mesh_vertices
+    static constexpr GLuint VERTEX_STRIDE = 8;
+
+    static GLuint grid_vertex_count(GLint m, GLint n);
+    static GLuint grid_index_count(GLint m, GLint n);
+
+    // c[k] = cos(start + k * step), s[k] = sin(start + k * step)
+    static void sincos_steps(GLfloat* c, GLfloat* s, GLuint count, GLfloat start, GLfloat step);
+
+    static void grid_indices(GLuint* I, GLint m, GLint n, GLuint base_vertex = 0);
+    static void sphere_vertices(GLfloat* V, GLint m, GLint n);
+    static void torus_vertices(GLfloat* V, GLint m, GLint n);
+
     struct Sphere : public MeshData {
     private:
         GLuint _num_vertices;
@@ -78,6 +93,52 @@ struct parametric {
         virtual GLfloat* vertex_data(void);
         virtual GLuint* index_data(void);
     }; 
+
+    // tessellation levels of one surface, level 0 is the densest and each level
+    // halves m and n, all levels share one vertex and one index buffer,
+    // indices are absolute so a level draws with its first_index and count_indices
+    struct LODMesh : public MeshData {
+        static constexpr GLuint MAX_LEVELS = 8;
+        static constexpr GLint MIN_SEGMENTS = 4;
+
+        struct Level {
+            GLint m;
+            GLint n;
+            GLuint base_vertex;
+            GLuint count_vertices;
+            GLuint first_index;
+            GLuint count_indices;
+            // largest chord error of a unit-scale mesh, in world units
+            GLfloat error;
+        };
+
+        Level levels[MAX_LEVELS];
+        GLuint count_levels;
+
+        // coarsest level whose error stays under max_error_px on screen,
+        // the game's ortho projection maps one world unit to camera_scale pixels
+        GLuint select(GLfloat world_scale, GLfloat camera_scale, GLfloat max_error_px = 0.5f) const;
+        static GLuint select_level(const Level* levels, GLuint count_levels,
+                                   GLfloat world_scale, GLfloat camera_scale, GLfloat max_error_px = 0.5f);
+
+        virtual GLuint num_vertices(void);
+        virtual GLuint num_indices(void);
+        virtual GLfloat* vertex_data(void);
+        virtual GLuint* index_data(void);
+    protected:
+        std::vector<GLfloat> _vertex_data;
+        std::vector<GLuint> _index_data;
+
+        void build(void (*generate)(GLfloat* V, GLint m, GLint n), GLint m, GLint n, GLuint count_levels);
+    };
+
+    struct SphereLOD : public LODMesh {
+        SphereLOD(GLint m, GLint n, GLuint count_levels = MAX_LEVELS);
+    };
+
+    struct TorusLOD : public LODMesh {
+        TorusLOD(GLint m, GLint n, GLuint count_levels = MAX_LEVELS);
+    };
 };
 
 struct platonic_solid {
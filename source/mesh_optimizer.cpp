@@ -0,0 +1,306 @@
+#include "mesh_optimizer.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace gl_mesh {
+
+GLfloat optimizer::acmr(const GLuint* indices, GLuint count_indices, GLuint count_vertices, GLuint cache_size)
+{
+    if (count_indices < 3) {
+        return 0.0f;
+    }
+
+    // FIFO, a vertex is resident if it entered within the last cache_size misses
+    std::vector<GLuint> entered(count_vertices, 0);
+    GLuint misses = 0;
+    for (GLuint i = 0; i < count_indices; i++) {
+        const GLuint v = indices[i];
+        if (entered[v] == 0 || misses + 1 - entered[v] > cache_size) {
+            misses++;
+            entered[v] = misses;
+        }
+    }
+
+    return misses / (GLfloat)(count_indices / 3);
+}
+
+// TIPSIFY
+
+struct Tipsify {
+    const GLuint* indices;
+    GLuint count_vertices;
+    GLuint cache_size;
+
+    // vertex -> triangles
+    std::vector<GLuint> offsets;
+    std::vector<GLuint> triangles;
+
+    std::vector<GLuint> live;
+    std::vector<GLuint> cache_time;
+    std::vector<GLuint> dead_end;
+    std::vector<GLuint> candidates;
+    std::vector<bool> emitted;
+
+    GLuint time;
+    GLuint cursor;
+};
+
+static void Tipsify_init(Tipsify* t, const GLuint* indices, GLuint count_indices, GLuint count_vertices, GLuint cache_size)
+{
+    const GLuint count_triangles = count_indices / 3;
+
+    t->indices        = indices;
+    t->count_vertices = count_vertices;
+    t->cache_size     = cache_size;
+
+    t->live.assign(count_vertices, 0);
+    for (GLuint i = 0; i < count_triangles * 3; i++) {
+        t->live[indices[i]]++;
+    }
+
+    t->offsets.resize(count_vertices + 1);
+    t->offsets[0] = 0;
+    for (GLuint v = 0; v < count_vertices; v++) {
+        t->offsets[v + 1] = t->offsets[v] + t->live[v];
+    }
+
+    std::vector<GLuint> fill(t->offsets.begin(), t->offsets.end() - 1);
+    t->triangles.resize(count_triangles * 3);
+    for (GLuint tri = 0; tri < count_triangles; tri++) {
+        for (GLuint k = 0; k < 3; k++) {
+            t->triangles[fill[indices[tri * 3 + k]]++] = tri;
+        }
+    }
+
+    t->cache_time.assign(count_vertices, 0);
+    t->emitted.assign(count_triangles, false);
+    t->dead_end.clear();
+    t->dead_end.reserve(count_triangles * 3);
+    t->candidates.reserve(64);
+
+    t->time   = cache_size + 1;
+    t->cursor = 0;
+}
+
+// a vertex with live triangles from the dead-end stack, then from the input order
+static GLint Tipsify_skip_dead_end(Tipsify* t)
+{
+    while (!t->dead_end.empty()) {
+        const GLuint v = t->dead_end.back();
+        t->dead_end.pop_back();
+        if (t->live[v] > 0) {
+            return (GLint)v;
+        }
+    }
+    for (; t->cursor < t->count_vertices; t->cursor++) {
+        if (t->live[t->cursor] > 0) {
+            return (GLint)t->cursor;
+        }
+    }
+    return -1;
+}
+
+// the candidate that will still be in the cache after its remaining triangles
+// are emitted, oldest first, or -1
+static GLint Tipsify_next_vertex(Tipsify* t)
+{
+    GLint best = -1;
+    GLint best_priority = -1;
+    for (GLuint v : t->candidates) {
+        if (t->live[v] == 0) {
+            continue;
+        }
+
+        GLint priority = 0;
+        if (t->time - t->cache_time[v] + 2 * t->live[v] <= t->cache_size) {
+            priority = (GLint)(t->time - t->cache_time[v]);
+        }
+        if (priority > best_priority) {
+            best_priority = priority;
+            best = (GLint)v;
+        }
+    }
+    return best;
+}
+
+void optimizer::vertex_cache(GLuint* dst, const GLuint* indices, GLuint count_indices, GLuint count_vertices,
+                             GLuint cache_size, std::vector<GLuint>* cluster_starts)
+{
+    Tipsify t;
+    Tipsify_init(&t, indices, count_indices, count_vertices, cache_size);
+
+    if (cluster_starts != nullptr) {
+        cluster_starts->clear();
+        cluster_starts->push_back(0);
+    }
+
+    GLuint out_triangles = 0;
+    GLint fan = Tipsify_skip_dead_end(&t);
+    while (fan >= 0) {
+        t.candidates.clear();
+
+        for (GLuint a = t.offsets[fan]; a < t.offsets[fan + 1]; a++) {
+            const GLuint tri = t.triangles[a];
+            if (t.emitted[tri]) {
+                continue;
+            }
+
+            for (GLuint k = 0; k < 3; k++) {
+                const GLuint v = indices[tri * 3 + k];
+                *dst++ = v;
+                t.dead_end.push_back(v);
+                t.candidates.push_back(v);
+                t.live[v]--;
+                if (t.time - t.cache_time[v] > cache_size) {
+                    t.cache_time[v] = t.time;
+                    t.time++;
+                }
+            }
+            t.emitted[tri] = true;
+            out_triangles++;
+        }
+
+        fan = Tipsify_next_vertex(&t);
+        if (fan < 0) {
+            fan = Tipsify_skip_dead_end(&t);
+            if (fan >= 0 && cluster_starts != nullptr && cluster_starts->back() != out_triangles) {
+                cluster_starts->push_back(out_triangles);
+            }
+        }
+    }
+}
+
+// OVERDRAW
+
+struct Mesh_Cluster_Sort {
+    GLfloat key;
+    GLuint cluster;
+
+    bool operator<(const Mesh_Cluster_Sort& other) const
+    {
+        return key > other.key;
+    }
+};
+
+void optimizer::overdraw(GLuint* dst, const GLuint* indices, GLuint count_indices,
+                         const GLfloat* vertices, GLuint stride,
+                         const GLuint* cluster_starts, GLuint count_clusters)
+{
+    const GLuint count_triangles = count_indices / 3;
+
+    // mesh centroid over the referenced vertices, weighted by use
+    glm::vec3 mesh_center(0.0f);
+    for (GLuint i = 0; i < count_triangles * 3; i++) {
+        const GLfloat* p = vertices + indices[i] * stride;
+        mesh_center += glm::vec3(p[0], p[1], p[2]);
+    }
+    mesh_center /= (GLfloat)std::max(1u, count_triangles * 3);
+
+    // clusters facing away from the center occlude the rest of a roughly convex mesh
+    std::vector<Mesh_Cluster_Sort> order(count_clusters);
+    for (GLuint c = 0; c < count_clusters; c++) {
+        const GLuint begin = cluster_starts[c];
+        const GLuint end   = (c + 1 < count_clusters) ? cluster_starts[c + 1] : count_triangles;
+
+        glm::vec3 center(0.0f);
+        glm::vec3 normal(0.0f);
+        GLfloat area = 0.0f;
+        for (GLuint tri = begin; tri < end; tri++) {
+            const GLfloat* a = vertices + indices[tri * 3 + 0] * stride;
+            const GLfloat* b = vertices + indices[tri * 3 + 1] * stride;
+            const GLfloat* d = vertices + indices[tri * 3 + 2] * stride;
+            const glm::vec3 pa(a[0], a[1], a[2]);
+            const glm::vec3 pb(b[0], b[1], b[2]);
+            const glm::vec3 pd(d[0], d[1], d[2]);
+
+            const glm::vec3 n = glm::cross(pb - pa, pd - pa);
+            const GLfloat tri_area = glm::length(n);
+            center += (pa + pb + pd) * (tri_area / 3.0f);
+            normal += n;
+            area   += tri_area;
+        }
+
+        GLfloat key = 0.0f;
+        const GLfloat normal_length = glm::length(normal);
+        if (area > 0.0f && normal_length > 0.0f) {
+            key = glm::dot(center / area - mesh_center, normal / normal_length);
+        }
+
+        order[c].key     = key;
+        order[c].cluster = c;
+    }
+
+    std::stable_sort(order.begin(), order.end());
+
+    for (GLuint i = 0; i < count_clusters; i++) {
+        const GLuint c     = order[i].cluster;
+        const GLuint begin = cluster_starts[c];
+        const GLuint end   = (c + 1 < count_clusters) ? cluster_starts[c + 1] : count_triangles;
+
+        std::copy(indices + begin * 3, indices + end * 3, dst);
+        dst += (end - begin) * 3;
+    }
+}
+
+// VERTEX FETCH
+
+GLuint optimizer::vertex_fetch(GLfloat* dst, GLuint* indices, GLuint count_indices,
+                               const GLfloat* vertices, GLuint count_vertices, GLuint stride)
+{
+    const GLuint UNUSED = ~0u;
+
+    std::vector<GLuint> remap(count_vertices, UNUSED);
+    GLuint next = 0;
+    for (GLuint i = 0; i < count_indices; i++) {
+        const GLuint v = indices[i];
+        if (remap[v] == UNUSED) {
+            remap[v] = next;
+            std::copy(vertices + v * stride, vertices + (v + 1) * stride, dst + next * stride);
+            next++;
+        }
+        indices[i] = remap[v];
+    }
+
+    return next;
+}
+
+// OPTIMIZED MESH
+
+OptimizedMesh::OptimizedMesh(MeshData& src, GLuint stride, GLuint cache_size)
+{
+    const GLuint count_indices  = src.num_indices();
+    const GLuint count_vertices = src.num_vertices();
+
+    std::vector<GLuint> cached(count_indices);
+    std::vector<GLuint> clusters;
+    optimizer::vertex_cache(&cached[0], src.index_data(), count_indices, count_vertices, cache_size, &clusters);
+
+    this->_index_data.resize(count_indices);
+    optimizer::overdraw(&(this->_index_data[0]), &cached[0], count_indices,
+                        src.vertex_data(), stride, &clusters[0], (GLuint)clusters.size());
+
+    this->_vertex_data.resize(count_vertices * stride);
+    this->_num_vertices = optimizer::vertex_fetch(&(this->_vertex_data[0]), &(this->_index_data[0]), count_indices,
+                                                  src.vertex_data(), count_vertices, stride);
+    this->_vertex_data.resize(this->_num_vertices * stride);
+    this->_num_indices = count_indices;
+}
+
+GLuint OptimizedMesh::num_vertices(void)
+{
+    return this->_num_vertices;
+}
+GLuint OptimizedMesh::num_indices(void)
+{
+    return this->_num_indices;
+}
+GLfloat* OptimizedMesh::vertex_data(void)
+{
+    return &(this->_vertex_data[0]);
+}
+GLuint* OptimizedMesh::index_data(void)
+{
+    return &(this->_index_data[0]);
+}
+
+}
@@ -0,0 +1,57 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "mesh_generator.hpp"
+
+namespace gl_mesh {
+
+// index and vertex reordering for the post-transform vertex cache,
+// vertices are interleaved with the position in the first 3 floats
+struct optimizer {
+    static constexpr GLuint DEFAULT_CACHE_SIZE = 16;
+
+    // average cache miss ratio, misses per triangle on a FIFO cache,
+    // 3.0 is the worst case and ~0.5 the best for a regular grid
+    static GLfloat acmr(const GLuint* indices, GLuint count_indices, GLuint count_vertices,
+                        GLuint cache_size = DEFAULT_CACHE_SIZE);
+
+    // Tipsify (Sander, Nehab, Barczak 2007), linear time,
+    // dst may not alias indices, cluster_starts receives the first triangle of each
+    // cluster (a fan that could not continue from the cache), may be null
+    static void vertex_cache(GLuint* dst, const GLuint* indices, GLuint count_indices, GLuint count_vertices,
+                             GLuint cache_size = DEFAULT_CACHE_SIZE,
+                             std::vector<GLuint>* cluster_starts = nullptr);
+
+    // orders the clusters from vertex_cache so the outward-facing ones are drawn first,
+    // triangles inside a cluster keep their cache-friendly order, dst may not alias indices
+    static void overdraw(GLuint* dst, const GLuint* indices, GLuint count_indices,
+                         const GLfloat* vertices, GLuint stride,
+                         const GLuint* cluster_starts, GLuint count_clusters);
+
+    // renumbers vertices in first-use order and rewrites indices in place,
+    // unreferenced vertices are dropped, returns the number of vertices written to dst
+    static GLuint vertex_fetch(GLfloat* dst, GLuint* indices, GLuint count_indices,
+                               const GLfloat* vertices, GLuint count_vertices, GLuint stride);
+};
+
+// an optimized copy of any mesh: vertex cache, then overdraw, then fetch order
+struct OptimizedMesh : public MeshData {
+private:
+    GLuint _num_vertices;
+    GLuint _num_indices;
+    std::vector<GLfloat> _vertex_data;
+    std::vector<GLuint> _index_data;
+
+    OptimizedMesh(void) = delete;
+public:
+    OptimizedMesh(MeshData& src, GLuint stride = 8, GLuint cache_size = optimizer::DEFAULT_CACHE_SIZE);
+
+    virtual GLuint num_vertices(void);
+    virtual GLuint num_indices(void);
+    virtual GLfloat* vertex_data(void);
+    virtual GLuint* index_data(void);
+};
+
+}
+
+#endif // MESH_OPTIMIZER_H
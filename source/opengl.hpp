@@ -135,6 +135,68 @@ inline void GLData_advance(GLData* const gl_data, const size_t i); // probably n
 void GLData_delete(GLData* gl_data);
 void GLData_delete_inplace(GLData* gl_data);
 
+// STATE CACHE
+// mirrors the bound GL state so that redundant binds and uniform updates are skipped,
+// anything bound with the raw gl* calls must be followed by gl_state_invalidate()
+
+#define GL_STATE_UNKNOWN (~(GLuint)0)
+#define GL_STATE_MAX_TEXTURE_UNITS (16)
+#define GL_STATE_UNIFORM_CACHE_SIZE (256)
+
+struct GL_Uniform_Cache_Entry {
+    GLuint  program;
+    GLint   location;
+    u32     byte_count;
+    u8      bytes[16 * sizeof(GLfloat)];
+};
+
+struct GL_State_Cache {
+    GLuint  program;
+    VAO     vao;
+    GLuint  array_buffer;
+    GLuint  element_buffer;
+    GLuint  uniform_buffer;
+    GLenum  active_texture;
+    Texture textures_2d[GL_STATE_MAX_TEXTURE_UNITS];
+    Texture textures_2d_array[GL_STATE_MAX_TEXTURE_UNITS];
+
+    // -1 unknown
+    i8      blend;
+    i8      depth_test;
+    GLenum  blend_src;
+    GLenum  blend_dst;
+
+    GL_Uniform_Cache_Entry uniforms[GL_STATE_UNIFORM_CACHE_SIZE];
+
+    u32 issued;
+    u32 elided;
+    u32 issued_last_frame;
+    u32 elided_last_frame;
+};
+
+extern GL_State_Cache gl_state;
+
+void gl_state_invalidate(void);
+// drops the uniforms cached for program, before glDeleteProgram since GL may reuse the name
+void gl_state_forget_program(GLuint program);
+// stores this frame's issued / elided counts in the *_last_frame fields and resets them
+void gl_state_frame_end(void);
+
+void gl_use_program(GLuint program);
+void gl_bind_vertex_array(VAO vao);
+void gl_bind_buffer(GLenum target, GLuint buffer);
+void gl_active_texture(GLenum unit);
+void gl_bind_texture(GLenum target, Texture texture);
+void gl_set_blend(bool enabled);
+void gl_blend_func(GLenum src, GLenum dst);
+void gl_set_depth_test(bool enabled);
+
+void gl_uniform1i(GLint location, GLint value);
+void gl_uniform1f(GLint location, GLfloat value);
+void gl_uniform3fv(GLint location, const GLfloat* value);
+void gl_uniform4fv(GLint location, const GLfloat* value);
+void gl_uniform_matrix4fv(GLint location, const GLfloat* value);
+
 #endif // OPEN_GL_HPP
 
 #ifdef OPEN_GL_IMPLEMENTATION
@@ -344,10 +406,10 @@ void gl_bind_buffers_and_upload_data(VertexBufferData* vbd, GLenum usage, GLintp
 
 void gl_bind_buffers_and_upload_sub_data(VertexBufferData* vbd)
 {
-    glBindBuffer(GL_ARRAY_BUFFER, vbd->vbo);
+    gl_bind_buffer(GL_ARRAY_BUFFER, vbd->vbo);
     glBufferSubData(GL_ARRAY_BUFFER, 0, vbd->v_count * sizeof(GLfloat), vbd->vertices);
     
-    glBindBuffer(GL_ARRAY_BUFFER, vbd->ebo);
+    gl_bind_buffer(GL_ARRAY_BUFFER, vbd->ebo);
     glBufferSubData(GL_ARRAY_BUFFER, 0, vbd->i_count * sizeof(GLuint), vbd->indices);
 }
 
@@ -401,5 +463,275 @@ void GLData_delete_inplace(GLData* gl_data)
     VertexBufferData_delete_inplace(&gl_data->vbd);    
 }
 
-#endif
+// STATE CACHE
 
+GL_State_Cache gl_state;
+
+void gl_state_invalidate(void)
+{
+    gl_state.program        = GL_STATE_UNKNOWN;
+    gl_state.vao            = GL_STATE_UNKNOWN;
+    gl_state.array_buffer   = GL_STATE_UNKNOWN;
+    gl_state.element_buffer = GL_STATE_UNKNOWN;
+    gl_state.uniform_buffer = GL_STATE_UNKNOWN;
+    gl_state.active_texture = GL_STATE_UNKNOWN;
+    for (usize i = 0; i < GL_STATE_MAX_TEXTURE_UNITS; i += 1) {
+        gl_state.textures_2d[i]       = GL_STATE_UNKNOWN;
+        gl_state.textures_2d_array[i] = GL_STATE_UNKNOWN;
+    }
+
+    gl_state.blend      = -1;
+    gl_state.depth_test = -1;
+    gl_state.blend_src  = GL_STATE_UNKNOWN;
+    gl_state.blend_dst  = GL_STATE_UNKNOWN;
+
+    // program 0 marks an empty slot
+    memset(gl_state.uniforms, 0x00, sizeof(gl_state.uniforms));
+}
+
+void gl_state_forget_program(GLuint program)
+{
+    if (program == 0) {
+        return;
+    }
+    if (gl_state.program == program) {
+        gl_state.program = GL_STATE_UNKNOWN;
+    }
+
+    // left as tombstones so that probes for other programs still walk past them
+    foreach (i, GL_STATE_UNIFORM_CACHE_SIZE) {
+        GL_Uniform_Cache_Entry* entry = &gl_state.uniforms[i];
+        if (entry->program == program) {
+            entry->program  = GL_STATE_UNKNOWN;
+            entry->location = -1;
+        }
+    }
+}
+
+void gl_state_frame_end(void)
+{
+    gl_state.issued_last_frame = gl_state.issued;
+    gl_state.elided_last_frame = gl_state.elided;
+    gl_state.issued = 0;
+    gl_state.elided = 0;
+}
+
+void gl_use_program(GLuint program)
+{
+    if (gl_state.program == program) {
+        gl_state.elided += 1;
+        return;
+    }
+    gl_state.issued += 1;
+    gl_state.program = program;
+    glUseProgram(program);
+}
+
+void gl_bind_vertex_array(VAO vao)
+{
+    if (gl_state.vao == vao) {
+        gl_state.elided += 1;
+        return;
+    }
+    gl_state.issued += 1;
+    gl_state.vao = vao;
+    // the element buffer binding belongs to the vertex array
+    gl_state.element_buffer = GL_STATE_UNKNOWN;
+    glBindVertexArray(vao);
+}
+
+void gl_bind_buffer(GLenum target, GLuint buffer)
+{
+    GLuint* bound = nullptr;
+    switch (target) {
+    case GL_ARRAY_BUFFER:         bound = &gl_state.array_buffer;   break;
+    case GL_ELEMENT_ARRAY_BUFFER: bound = &gl_state.element_buffer; break;
+    case GL_UNIFORM_BUFFER:       bound = &gl_state.uniform_buffer; break;
+    default:                                                        break;
+    }
+
+    if (bound != nullptr) {
+        if (*bound == buffer) {
+            gl_state.elided += 1;
+            return;
+        }
+        *bound = buffer;
+    }
+    gl_state.issued += 1;
+    glBindBuffer(target, buffer);
+}
+
+void gl_active_texture(GLenum unit)
+{
+    if (gl_state.active_texture == unit) {
+        gl_state.elided += 1;
+        return;
+    }
+    gl_state.issued += 1;
+    gl_state.active_texture = unit;
+    glActiveTexture(unit);
+}
+
+void gl_bind_texture(GLenum target, Texture texture)
+{
+    const usize unit = gl_state.active_texture - GL_TEXTURE0;
+
+    Texture* bound = nullptr;
+    if (gl_state.active_texture != GL_STATE_UNKNOWN && unit < GL_STATE_MAX_TEXTURE_UNITS) {
+        switch (target) {
+        case GL_TEXTURE_2D:       bound = &gl_state.textures_2d[unit];       break;
+        case GL_TEXTURE_2D_ARRAY: bound = &gl_state.textures_2d_array[unit]; break;
+        default:                                                             break;
+        }
+    }
+
+    if (bound != nullptr) {
+        if (*bound == texture) {
+            gl_state.elided += 1;
+            return;
+        }
+        *bound = texture;
+    }
+    gl_state.issued += 1;
+    glBindTexture(target, texture);
+}
+
+void gl_set_blend(bool enabled)
+{
+    if (gl_state.blend == (i8)enabled) {
+        gl_state.elided += 1;
+        return;
+    }
+    gl_state.issued += 1;
+    gl_state.blend = (i8)enabled;
+    if (enabled) {
+        glEnable(GL_BLEND);
+    } else {
+        glDisable(GL_BLEND);
+    }
+}
+
+void gl_blend_func(GLenum src, GLenum dst)
+{
+    if (gl_state.blend_src == src && gl_state.blend_dst == dst) {
+        gl_state.elided += 1;
+        return;
+    }
+    gl_state.issued += 1;
+    gl_state.blend_src = src;
+    gl_state.blend_dst = dst;
+    glBlendFunc(src, dst);
+}
+
+void gl_set_depth_test(bool enabled)
+{
+    if (gl_state.depth_test == (i8)enabled) {
+        gl_state.elided += 1;
+        return;
+    }
+    gl_state.issued += 1;
+    gl_state.depth_test = (i8)enabled;
+    if (enabled) {
+        glEnable(GL_DEPTH_TEST);
+    } else {
+        glDisable(GL_DEPTH_TEST);
+    }
+}
+
+// returns false if the bound program already holds these bytes at location,
+// otherwise records them and returns true
+static bool gl_uniform_cache_update(GLint location, const void* bytes, const u32 byte_count)
+{
+    const GLuint program = gl_state.program;
+    if (program == 0 || program == GL_STATE_UNKNOWN) {
+        return true;
+    }
+
+    // short linear probe, a full neighbourhood just means the update is not cached,
+    // entries of forgotten programs (GL_STATE_UNKNOWN) are reused once the key is known to be absent
+    const usize hash = ((program * 31) + (GLuint)location) & (GL_STATE_UNIFORM_CACHE_SIZE - 1);
+    GL_Uniform_Cache_Entry* free_entry = nullptr;
+    for (usize probe = 0; probe < 8; probe += 1) {
+        GL_Uniform_Cache_Entry* entry = &gl_state.uniforms[(hash + probe) & (GL_STATE_UNIFORM_CACHE_SIZE - 1)];
+
+        if (entry->program == program && entry->location == location) {
+            if (entry->byte_count == byte_count && memcmp(entry->bytes, bytes, byte_count) == 0) {
+                return false;
+            }
+            entry->byte_count = byte_count;
+            memcpy(entry->bytes, bytes, byte_count);
+            return true;
+        }
+
+        if (entry->program == GL_STATE_UNKNOWN) {
+            free_entry = (free_entry == nullptr) ? entry : free_entry;
+            continue;
+        }
+
+        if (entry->program == 0) {
+            free_entry = (free_entry == nullptr) ? entry : free_entry;
+            break;
+        }
+    }
+
+    if (free_entry != nullptr) {
+        free_entry->program    = program;
+        free_entry->location   = location;
+        free_entry->byte_count = byte_count;
+        memcpy(free_entry->bytes, bytes, byte_count);
+    }
+
+    return true;
+}
+
+void gl_uniform1i(GLint location, GLint value)
+{
+    if (location < 0 || !gl_uniform_cache_update(location, &value, sizeof(GLint))) {
+        gl_state.elided += 1;
+        return;
+    }
+    gl_state.issued += 1;
+    glUniform1i(location, value);
+}
+
+void gl_uniform1f(GLint location, GLfloat value)
+{
+    if (location < 0 || !gl_uniform_cache_update(location, &value, sizeof(GLfloat))) {
+        gl_state.elided += 1;
+        return;
+    }
+    gl_state.issued += 1;
+    glUniform1f(location, value);
+}
+
+void gl_uniform3fv(GLint location, const GLfloat* value)
+{
+    if (location < 0 || !gl_uniform_cache_update(location, value, 3 * sizeof(GLfloat))) {
+        gl_state.elided += 1;
+        return;
+    }
+    gl_state.issued += 1;
+    glUniform3fv(location, 1, value);
+}
+
+void gl_uniform4fv(GLint location, const GLfloat* value)
+{
+    if (location < 0 || !gl_uniform_cache_update(location, value, 4 * sizeof(GLfloat))) {
+        gl_state.elided += 1;
+        return;
+    }
+    gl_state.issued += 1;
+    glUniform4fv(location, 1, value);
+}
+
+void gl_uniform_matrix4fv(GLint location, const GLfloat* value)
+{
+    if (location < 0 || !gl_uniform_cache_update(location, value, 16 * sizeof(GLfloat))) {
+        gl_state.elided += 1;
+        return;
+    }
+    gl_state.issued += 1;
+    glUniformMatrix4fv(location, 1, GL_FALSE, value);
+}
+
+#endif
@@ -0,0 +1,760 @@
+#ifndef PARALLAX_HPP
+#define PARALLAX_HPP
+
+// background layers described by a list file, one layer per line, back to front:
+//     <image path> <scroll divisor x> <scroll divisor y>
+// a layer scrolls by the camera position divided by its divisors, all images must share one size,
+// on the GPU the layers are the slices of one GL_TEXTURE_2D_ARRAY, see parallax_v2_frg.glsl
+//
+// parallax_tile_masks_bake runs offline (see PARALLAX_TILE_BAKE in run.cpp) and writes <list>.tiles,
+// the coverage of every tile of every layer, with it the layers are drawn as tiled quads and
+// tiles that are empty or hidden behind an opaque tile of a nearer layer are never shaded
+#if !(UNITY_BUILD)
+#define COMMON_UTILS_CPP_IMPLEMENTATION
+#include "common_utils_cpp.hpp"
+
+#include "opengl.hpp"
+#include "sdl.hpp"
+#endif
+
+// must match MAX_LAYERS in shaders/parallax/parallax_v2_frg.glsl
+#define PARALLAX_MAX_LAYERS (16)
+#define PARALLAX_PATH_MAX (256)
+
+#define PARALLAX_TILE_SIZE (64)
+#define PARALLAX_TILE_MAGIC (0x314d5450) // "PTM1"
+#define PARALLAX_TILE_VERSION (1)
+// quads per frame, a view that needs more is drawn with the single-pass shader
+#define PARALLAX_MAX_TILE_QUADS (4096)
+// tiles along one axis of one layer, bounds the work when zoomed far out
+#define PARALLAX_MAX_TILE_SPAN (96)
+
+enum struct PARALLAX_TILE : u8 {
+    EMPTY,
+    MIXED,
+    OPAQUE,
+};
+
+// the .tiles file: the header, then layer_count * tiles_y * tiles_x PARALLAX_TILE values,
+// layer by layer, row by row
+struct Parallax_Tile_File_Header {
+    u32 magic;
+    u32 version;
+    u32 layer_count;
+    u32 width;
+    u32 height;
+    u32 tile_size;
+};
+
+struct Parallax_Layer_List {
+    char paths[PARALLAX_MAX_LAYERS][PARALLAX_PATH_MAX];
+    Vec2 scroll_divisors[PARALLAX_MAX_LAYERS];
+    u32  count;
+};
+
+struct Parallax_Layers {
+    // GL_TEXTURE_2D_ARRAY, slice i is layer i
+    Texture array;
+    u32     width;
+    u32     height;
+
+    Parallax_Layer_List list;
+    char  list_path[PARALLAX_PATH_MAX];
+    GLint unit;
+    // the single-pass program given to Parallax_Layers_set_uniforms
+    GLuint program;
+    // cooked with -p, every layer or none
+    bool  premultiplied;
+
+    // filled by a Texture_Loader with Parallax_Layers_load_async, array is 0 until every slice is in
+    Texture_Array_Target target;
+    bool                 ready;
+
+    // nullptr without a .tiles file, then only the single-pass shader is used
+    PARALLAX_TILE* tile_masks;
+    u32            tile_size;
+    u32            tiles_x;
+    u32            tiles_y;
+
+    Shader   tile_shader;
+    GLuint   tile_vao;
+    GLuint   tile_vbo;
+    GLuint   tile_ebo;
+    GLfloat* tile_vertices;
+};
+
+bool Parallax_Layer_List_read(Parallax_Layer_List* list, const char* path);
+
+// writes the tile coverage of the listed layers to the list path with a .tiles extension
+bool parallax_tile_masks_bake(const char* list_path, const u32 tile_size);
+
+bool Parallax_Layers_load(Parallax_Layers* layers, const char* list_path);
+// queues the layers on the loader and returns at once
+bool Parallax_Layers_load_async(Parallax_Layers* layers, const char* list_path, Texture_Loader* loader);
+// true once every layer is uploaded, the first time also loads the tile masks
+bool Parallax_Layers_ready(Parallax_Layers* layers);
+// sets u_layers to texture unit `unit`, u_count_layers, u_scroll_divisors and u_premultiplied, program must be in use
+void Parallax_Layers_set_uniforms(Parallax_Layers* layers, GLuint program, const GLint unit);
+// opaque tiles front to back with depth writes, then mixed tiles back to front with blending,
+// off is the camera position in background uv space, quad_min / quad_max the screen rectangle of the background,
+// the array must be bound to the unit given to Parallax_Layers_set_uniforms,
+// returns false without drawing when there is no tile mask or the view needs too many tiles
+bool Parallax_Layers_draw_tiles(Parallax_Layers* layers, const Vec2 off, const f32 cam_scale, const Vec2 quad_min, const Vec2 quad_max);
+void Parallax_Layers_free(Parallax_Layers* layers);
+
+#endif
+
+#ifdef PARALLAX_IMPLEMENTATION
+#undef PARALLAX_IMPLEMENTATION
+
+bool Parallax_Layer_List_read(Parallax_Layer_List* list, const char* path)
+{
+    list->count = 0;
+
+    FILE* in = fopen(path, "r");
+    if (in == nullptr) {
+        fprintf(stderr, "ERROR: could not open parallax layer list %s\n", path);
+        return false;
+    }
+
+    char line[PARALLAX_PATH_MAX + 64];
+    while (fgets(line, sizeof(line), in) != nullptr) {
+        char layer_path[PARALLAX_PATH_MAX];
+        Vec2 divisors;
+        if (sscanf(line, "%255s %f %f", layer_path, &divisors.x, &divisors.y) != 3) {
+            continue;
+        }
+        if (list->count == PARALLAX_MAX_LAYERS) {
+            fprintf(stderr, "WARNING: %s has more than %d layers, the rest are ignored\n", path, PARALLAX_MAX_LAYERS);
+            break;
+        }
+        if (divisors.x == 0.0f || divisors.y == 0.0f) {
+            fprintf(stderr, "ERROR: %s, layer %s has a zero scroll divisor\n", path, layer_path);
+            fclose(in);
+            return false;
+        }
+
+        strcpy(list->paths[list->count], layer_path);
+        list->scroll_divisors[list->count] = divisors;
+        list->count += 1;
+    }
+
+    fclose(in);
+
+    if (list->count == 0) {
+        fprintf(stderr, "ERROR: %s lists no layers\n", path);
+        return false;
+    }
+
+    return true;
+}
+
+// the list path with its extension replaced by .tiles
+static void parallax_tile_path(char* out, const usize cap, const char* list_path)
+{
+    snprintf(out, cap, "%s", list_path);
+
+    char* slash = strrchr(out, '/');
+    char* dot   = strrchr(out, '.');
+    if (dot != nullptr && (slash == nullptr || dot > slash)) {
+        *dot = '\0';
+    }
+    const usize len = strlen(out);
+    snprintf(out + len, cap - len, ".tiles");
+}
+
+static PARALLAX_TILE parallax_tile_classify(const SDL_Surface* rgba, const u32 x0, const u32 y0, const u32 x1, const u32 y1)
+{
+    bool any_opaque      = false;
+    bool any_transparent = false;
+    for (u32 y = y0; y < y1; y += 1) {
+        const u8* row = (const u8*)rgba->pixels + (y * rgba->pitch);
+        for (u32 x = x0; x < x1; x += 1) {
+            const u8 alpha = row[(x * 4) + 3];
+            any_opaque      = any_opaque      || (alpha == 255);
+            any_transparent = any_transparent || (alpha != 255);
+            if (alpha != 0 && alpha != 255) {
+                return PARALLAX_TILE::MIXED;
+            }
+        }
+    }
+
+    if (any_opaque && any_transparent) {
+        return PARALLAX_TILE::MIXED;
+    }
+    return (any_opaque) ? PARALLAX_TILE::OPAQUE : PARALLAX_TILE::EMPTY;
+}
+
+bool parallax_tile_masks_bake(const char* list_path, const u32 tile_size)
+{
+    Parallax_Layer_List list;
+    if (!Parallax_Layer_List_read(&list, list_path)) {
+        return false;
+    }
+
+    Parallax_Tile_File_Header header = {};
+    header.magic       = PARALLAX_TILE_MAGIC;
+    header.version     = PARALLAX_TILE_VERSION;
+    header.layer_count = list.count;
+    header.tile_size   = tile_size;
+
+    PARALLAX_TILE* masks = nullptr;
+    u32 tiles_x = 0;
+    u32 tiles_y = 0;
+
+    usize counts[3] = {0, 0, 0};
+
+    bool ok = true;
+    for (u32 layer = 0; ok && layer < list.count; layer += 1) {
+        const char* path = list.paths[layer];
+
+        SDL_Surface* img = IMG_Load(path);
+        if (img == nullptr) {
+            fprintf(stderr, "SDL_image could not be loaded %s, SDL_image Error: %s\n", path, IMG_GetError());
+            ok = false;
+            break;
+        }
+        SDL_Surface* rgba = SDL_ConvertSurfaceFormat(img, SDL_PIXELFORMAT_RGBA32, 0);
+        SDL_FreeSurface(img);
+        if (rgba == nullptr) {
+            fprintf(stderr, "ERROR: %s, SDL Error: %s\n", path, SDL_GetError());
+            ok = false;
+            break;
+        }
+
+        if (layer == 0) {
+            header.width  = rgba->w;
+            header.height = rgba->h;
+            tiles_x = (header.width  + tile_size - 1) / tile_size;
+            tiles_y = (header.height + tile_size - 1) / tile_size;
+            masks = (PARALLAX_TILE*)xcalloc((usize)list.count * tiles_x * tiles_y, sizeof(PARALLAX_TILE));
+        } else if ((u32)rgba->w != header.width || (u32)rgba->h != header.height) {
+            fprintf(stderr, "ERROR: %s is %dx%d, the first layer is %ux%u\n", path, rgba->w, rgba->h, header.width, header.height);
+            SDL_FreeSurface(rgba);
+            ok = false;
+            break;
+        }
+
+        SDL_LockSurface(rgba);
+        PARALLAX_TILE* mask = masks + ((usize)layer * tiles_x * tiles_y);
+        foreach (ty, tiles_y) {
+            foreach (tx, tiles_x) {
+                const u32 x0 = tx * tile_size;
+                const u32 y0 = ty * tile_size;
+                const PARALLAX_TILE kind = parallax_tile_classify(
+                    rgba, x0, y0, glm::min(x0 + tile_size, header.width), glm::min(y0 + tile_size, header.height)
+                );
+                mask[(ty * tiles_x) + tx] = kind;
+                counts[(usize)kind] += 1;
+            }
+        }
+        SDL_UnlockSurface(rgba);
+        SDL_FreeSurface(rgba);
+    }
+
+    if (ok) {
+        char out_path[PARALLAX_PATH_MAX + 8];
+        parallax_tile_path(out_path, sizeof(out_path), list_path);
+
+        FILE* out = fopen(out_path, "wb");
+        if (out == nullptr) {
+            fprintf(stderr, "ERROR: could not open %s for writing\n", out_path);
+            ok = false;
+        } else {
+            const usize tile_count = (usize)list.count * tiles_x * tiles_y;
+            ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+                 fwrite(masks, sizeof(PARALLAX_TILE), tile_count, out) == tile_count;
+            fclose(out);
+
+            if (ok) {
+                printf("%s: %u layers of %ux%u tiles, %llu empty, %llu mixed, %llu opaque\n",
+                    out_path, list.count, tiles_x, tiles_y,
+                    (unsigned long long)counts[(usize)PARALLAX_TILE::EMPTY],
+                    (unsigned long long)counts[(usize)PARALLAX_TILE::MIXED],
+                    (unsigned long long)counts[(usize)PARALLAX_TILE::OPAQUE]
+                );
+            } else {
+                fprintf(stderr, "ERROR: could not write %s\n", out_path);
+            }
+        }
+    }
+
+    ::free(masks);
+
+    return ok;
+}
+
+// a missing or stale .tiles file is not an error, the layers are then drawn with the single-pass shader
+static void parallax_tile_masks_load(Parallax_Layers* layers, const char* list_path)
+{
+    char path[PARALLAX_PATH_MAX + 8];
+    parallax_tile_path(path, sizeof(path), list_path);
+
+    FILE* in = fopen(path, "rb");
+    if (in == nullptr) {
+        printf("no parallax tile masks at %s, drawing every layer per pixel\n", path);
+        return;
+    }
+
+    Parallax_Tile_File_Header header;
+    if (fread(&header, sizeof(header), 1, in) != 1 ||
+        header.magic != PARALLAX_TILE_MAGIC || header.version != PARALLAX_TILE_VERSION ||
+        header.layer_count != layers->list.count || header.width != layers->width || header.height != layers->height ||
+        header.tile_size == 0) {
+        fprintf(stderr, "WARNING: %s does not match the layer list, rebake it, drawing every layer per pixel\n", path);
+        fclose(in);
+        return;
+    }
+
+    const u32 tiles_x = (header.width  + header.tile_size - 1) / header.tile_size;
+    const u32 tiles_y = (header.height + header.tile_size - 1) / header.tile_size;
+    const usize tile_count = (usize)header.layer_count * tiles_x * tiles_y;
+
+    PARALLAX_TILE* masks = (PARALLAX_TILE*)xmalloc(tile_count * sizeof(PARALLAX_TILE));
+    const bool read = fread(masks, sizeof(PARALLAX_TILE), tile_count, in) == tile_count;
+    fclose(in);
+    if (!read) {
+        fprintf(stderr, "WARNING: %s is truncated, drawing every layer per pixel\n", path);
+        ::free(masks);
+        return;
+    }
+
+    if (false == Shader_load_from_file(
+        &layers->tile_shader,
+        "shaders/parallax/parallax_tiles_vrt.glsl",
+        "shaders/parallax/parallax_tiles_frg.glsl"
+    )) {
+        fprintf(stderr, "WARNING: parallax tile shader, drawing every layer per pixel\n");
+        ::free(masks);
+        return;
+    }
+
+    layers->tile_masks = masks;
+    layers->tile_size  = header.tile_size;
+    layers->tiles_x    = tiles_x;
+    layers->tiles_y    = tiles_y;
+
+    // position xyz, uv and layer
+    layers->tile_vertices = (GLfloat*)xmalloc(PARALLAX_MAX_TILE_QUADS * 4 * 6 * sizeof(GLfloat));
+
+    GLuint* indices = (GLuint*)xmalloc(PARALLAX_MAX_TILE_QUADS * 6 * sizeof(GLuint));
+    foreach (q, PARALLAX_MAX_TILE_QUADS) {
+        const GLuint v = q * 4;
+        GLuint* i = indices + (q * 6);
+        i[0] = v + 0; i[1] = v + 1; i[2] = v + 2;
+        i[3] = v + 2; i[4] = v + 3; i[5] = v + 0;
+    }
+
+    glGenVertexArrays(1, &layers->tile_vao);
+    glGenBuffers(1, &layers->tile_vbo);
+    glGenBuffers(1, &layers->tile_ebo);
+
+    glBindVertexArray(layers->tile_vao);
+
+        glBindBuffer(GL_ARRAY_BUFFER, layers->tile_vbo);
+        glBufferData(GL_ARRAY_BUFFER, PARALLAX_MAX_TILE_QUADS * 4 * 6 * sizeof(GLfloat), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, layers->tile_ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, PARALLAX_MAX_TILE_QUADS * 6 * sizeof(GLuint), indices, GL_STATIC_DRAW);
+
+        // POSITION
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*)0);
+        glEnableVertexAttribArray(0);
+        // UV AND LAYER
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(1);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    ::free(indices);
+}
+
+static void parallax_layers_reset(Parallax_Layers* layers, const char* list_path)
+{
+    layers->array          = 0;
+    layers->unit           = 0;
+    layers->program        = 0;
+    layers->premultiplied  = false;
+    layers->ready          = false;
+    layers->target.texture = 0;
+    layers->tile_masks     = nullptr;
+    layers->tile_vertices  = nullptr;
+    snprintf(layers->list_path, sizeof(layers->list_path), "%s", list_path);
+}
+
+// the tile shader samples the same unit as the single-pass one
+static void parallax_tile_shader_set_unit(Parallax_Layers* layers)
+{
+    if (layers->tile_masks == nullptr) {
+        return;
+    }
+
+    glUseProgram(layers->tile_shader);
+    glUniform1i(glGetUniformLocation(layers->tile_shader, "u_layers"), layers->unit);
+    glUseProgram(0);
+    gl_state_invalidate();
+}
+
+bool Parallax_Layers_load(Parallax_Layers* layers, const char* list_path)
+{
+    parallax_layers_reset(layers, list_path);
+
+    if (!Parallax_Layer_List_read(&layers->list, list_path)) {
+        return false;
+    }
+
+    foreach (i, layers->list.count) {
+        const char* path = layers->list.paths[i];
+        printf("loading %s\n", path);
+
+        // the cooked file when there is one
+        Texture_Cooked cooked;
+        bool premultiplied;
+        SDL_Surface* rgba = texture_rgba_load(path, &cooked, &premultiplied);
+        if (rgba == nullptr) {
+            Parallax_Layers_free(layers);
+            return false;
+        }
+        // the camera zooms far out over the background
+        Texture_Mip_Chain mips;
+        Texture_Mip_Chain_make(&mips, rgba, &cooked, TEXTURE_COOKED_MAX_MIPS);
+
+        if (i == 0) {
+            layers->width         = rgba->w;
+            layers->height        = rgba->h;
+            layers->premultiplied = premultiplied;
+
+            glGenTextures(1, &layers->array);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, layers->array);
+            for (u32 l = 0; l < mips.count; l += 1) {
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, l, GL_RGBA8, mips.levels[l].width, mips.levels[l].height, layers->list.count, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            }
+            layers->target.mip_count = mips.count;
+            // repeats horizontally, clamps vertically
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            GL_texture_apply_filter(GL_TEXTURE_2D_ARRAY, TEXTURE_FILTER::NEAREST_MIPMAP, mips.count);
+        } else if ((u32)rgba->w != layers->width || (u32)rgba->h != layers->height || mips.count != layers->target.mip_count) {
+            fprintf(stderr, "ERROR: %s is %dx%d, the first layer is %ux%u\n", path, rgba->w, rgba->h, layers->width, layers->height);
+            Texture_Mip_Chain_free(&mips);
+            texture_rgba_free(rgba, &cooked);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            Parallax_Layers_free(layers);
+            return false;
+        } else if (premultiplied != layers->premultiplied) {
+            fprintf(stderr, "ERROR: %s does not match the alpha mode of the first layer\n", path);
+            Texture_Mip_Chain_free(&mips);
+            texture_rgba_free(rgba, &cooked);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            Parallax_Layers_free(layers);
+            return false;
+        }
+
+        SDL_LockSurface(rgba);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, rgba->pitch / sizeof(u32));
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, layers->width, layers->height, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba->pixels);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        for (u32 l = 1; l < mips.count; l += 1) {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, l, 0, 0, i, mips.levels[l].width, mips.levels[l].height, 1, GL_RGBA, GL_UNSIGNED_BYTE, Texture_Mip_Chain_level(&mips, rgba, l));
+        }
+        SDL_UnlockSurface(rgba);
+        Texture_Mip_Chain_free(&mips);
+        texture_rgba_free(rgba, &cooked);
+    }
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    parallax_tile_masks_load(layers, list_path);
+
+    gl_state_invalidate();
+
+    layers->ready = true;
+    return true;
+}
+
+bool Parallax_Layers_load_async(Parallax_Layers* layers, const char* list_path, Texture_Loader* loader)
+{
+    parallax_layers_reset(layers, list_path);
+
+    if (!Parallax_Layer_List_read(&layers->list, list_path)) {
+        return false;
+    }
+
+    Texture_Array_Target* target = &layers->target;
+    target->width        = 0;
+    target->height       = 0;
+    target->depth        = layers->list.count;
+    // repeats horizontally, clamps vertically
+    target->edge_x       = GL_REPEAT;
+    target->edge_y       = GL_CLAMP_TO_EDGE;
+    // the camera zooms far out over the background
+    target->filter       = TEXTURE_FILTER::NEAREST_MIPMAP;
+    target->mip_count     = 0;
+    target->premultiplied = false;
+    target->slices_ready  = 0;
+    target->failed       = false;
+
+    foreach (i, layers->list.count) {
+        if (Texture_Loader_request_slice(loader, layers->list.paths[i], target, i) == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Parallax_Layers_ready(Parallax_Layers* layers)
+{
+    if (layers->ready) {
+        return true;
+    }
+    if (layers->target.failed || layers->target.slices_ready < layers->target.depth) {
+        return false;
+    }
+
+    layers->array         = layers->target.texture;
+    layers->width         = layers->target.width;
+    layers->height        = layers->target.height;
+    layers->premultiplied = layers->target.premultiplied;
+
+    parallax_tile_masks_load(layers, layers->list_path);
+    parallax_tile_shader_set_unit(layers);
+
+    // the uniforms were set before the alpha mode was known
+    if (layers->program != 0) {
+        glUseProgram(layers->program);
+        glUniform1i(glGetUniformLocation(layers->program, "u_premultiplied"), layers->premultiplied);
+        glUseProgram(0);
+        gl_state_invalidate();
+    }
+
+    layers->ready = true;
+    return true;
+}
+
+void Parallax_Layers_set_uniforms(Parallax_Layers* layers, GLuint program, const GLint unit)
+{
+    glUniform1i(glGetUniformLocation(program, "u_layers"), unit);
+    glUniform1i(glGetUniformLocation(program, "u_count_layers"), layers->list.count);
+    glUniform2fv(glGetUniformLocation(program, "u_scroll_divisors"), layers->list.count, &layers->list.scroll_divisors[0].x);
+    glUniform1i(glGetUniformLocation(program, "u_premultiplied"), layers->premultiplied);
+
+    layers->unit    = unit;
+    layers->program = program;
+    if (layers->tile_masks != nullptr) {
+        parallax_tile_shader_set_unit(layers);
+        glUseProgram(program);
+    }
+}
+
+// one axis of the background quad split at tile boundaries, v is the quad's [0, 1] parameter
+struct Parallax_Tile_Axis {
+    f32 v_edges[PARALLAX_MAX_TILE_SPAN + 1];
+    u32 tiles[PARALLAX_MAX_TILE_SPAN];
+    u32 span;
+};
+
+static i64 parallax_floor_div(const i64 a, const i64 b)
+{
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+// the layer's uv along the axis is (v - 0.5) * s + 0.5 + c, the same mapping as parallax_v2_frg.glsl,
+// repeat axes wrap, the others clamp so the edge tiles stretch to the edge of the quad
+static bool parallax_tile_axis(Parallax_Tile_Axis* axis, const f32 c, const f32 s, const u32 texels, const u32 tile_size, const u32 tile_count, const bool repeat)
+{
+    const f64 uv_lo = (-0.5 * s) + 0.5 + c;
+    const f64 uv_hi = ( 0.5 * s) + 0.5 + c;
+
+    i64 t_lo;
+    i64 t_hi;
+    if (repeat) {
+        const f64 p_lo = floor(uv_lo);
+        const f64 p_hi = floor(uv_hi);
+        t_lo = ((i64)p_lo * tile_count) + (i64)(((uv_lo - p_lo) * texels) / tile_size);
+        t_hi = ((i64)p_hi * tile_count) + (i64)(((uv_hi - p_hi) * texels) / tile_size);
+    } else {
+        t_lo = glm::clamp((i64)floor((uv_lo * texels) / tile_size), (i64)0, (i64)tile_count - 1);
+        t_hi = glm::clamp((i64)floor((uv_hi * texels) / tile_size), (i64)0, (i64)tile_count - 1);
+    }
+
+    if (t_hi - t_lo + 1 > PARALLAX_MAX_TILE_SPAN) {
+        return false;
+    }
+    axis->span = (u32)(t_hi - t_lo + 1);
+
+    for (u32 k = 0; k < axis->span; k += 1) {
+        const i64 t      = t_lo + k;
+        const i64 period = parallax_floor_div(t, tile_count);
+        const u32 local  = (u32)(t - (period * tile_count));
+        axis->tiles[k] = local;
+
+        if (k == 0) {
+            axis->v_edges[0] = 0.0f;
+        } else {
+            const f64 uv = ((f64)(period * texels) + (f64)(local * tile_size)) / texels;
+            axis->v_edges[k] = glm::clamp((f32)(((uv - 0.5 - c) / s) + 0.5), 0.0f, 1.0f);
+        }
+    }
+    axis->v_edges[axis->span] = 1.0f;
+
+    return true;
+}
+
+// appends one quad per run of neighbouring tiles of the given kind in each row of the layer,
+// returns false when the quad buffer is full
+static bool parallax_tile_emit(
+    Parallax_Layers* layers, u32* quad_count, const u32 layer, const PARALLAX_TILE kind,
+    const Parallax_Tile_Axis* ax, const Parallax_Tile_Axis* ay,
+    const Vec2 c, const f32 s, const Vec2 quad_min, const Vec2 quad_max
+) {
+    const PARALLAX_TILE* mask = layers->tile_masks + ((usize)layer * layers->tiles_x * layers->tiles_y);
+    // nearer layers are closer to the camera, every layer gets its own depth
+    const GLfloat z     = -0.5f * (GLfloat)(layers->list.count - 1 - layer);
+    const Vec2    range = quad_max - quad_min;
+
+    for (u32 row = 0; row < ay->span; row += 1) {
+        const f32 y0 = ay->v_edges[row];
+        const f32 y1 = ay->v_edges[row + 1];
+        if (y1 <= y0) {
+            continue;
+        }
+
+        const PARALLAX_TILE* mask_row = mask + ((usize)ay->tiles[row] * layers->tiles_x);
+
+        u32 col = 0;
+        while (col < ax->span) {
+            // the back layer is drawn opaque whatever its alpha, as in the single-pass shader
+            if (layer != 0 && mask_row[ax->tiles[col]] != kind) {
+                col += 1;
+                continue;
+            }
+
+            u32 end = col + 1;
+            while (end < ax->span && (layer == 0 || mask_row[ax->tiles[end]] == kind)) {
+                end += 1;
+            }
+
+            const f32 x0 = ax->v_edges[col];
+            const f32 x1 = ax->v_edges[end];
+            col = end;
+            if (x1 <= x0) {
+                continue;
+            }
+
+            if (*quad_count == PARALLAX_MAX_TILE_QUADS) {
+                return false;
+            }
+
+            const Vec2 corners[4] = {
+                Vec2(x0, y0), // top left
+                Vec2(x0, y1), // bottom left
+                Vec2(x1, y1), // bottom right
+                Vec2(x1, y0), // top right
+            };
+
+            GLfloat* v = layers->tile_vertices + (*quad_count * 4 * 6);
+            foreach (k, 4) {
+                const Vec2 screen = quad_min + (corners[k] * range);
+                const Vec2 uv     = ((corners[k] - Vec2(0.5f)) * s) + Vec2(0.5f) + c;
+                v[0] = screen.x;
+                v[1] = screen.y;
+                v[2] = z;
+                v[3] = uv.x;
+                v[4] = uv.y;
+                v[5] = (GLfloat)layer;
+                v += 6;
+            }
+            *quad_count += 1;
+        }
+    }
+
+    return true;
+}
+
+bool Parallax_Layers_draw_tiles(Parallax_Layers* layers, const Vec2 off, const f32 cam_scale, const Vec2 quad_min, const Vec2 quad_max)
+{
+    if (layers->tile_masks == nullptr) {
+        return false;
+    }
+
+    const f32 s     = 1.0f / cam_scale;
+    const u32 count = layers->list.count;
+
+    Parallax_Tile_Axis axes_x[PARALLAX_MAX_LAYERS];
+    Parallax_Tile_Axis axes_y[PARALLAX_MAX_LAYERS];
+    Vec2 offsets[PARALLAX_MAX_LAYERS];
+    foreach (i, count) {
+        offsets[i] = off / layers->list.scroll_divisors[i];
+        if (!parallax_tile_axis(&axes_x[i], offsets[i].x, s, layers->width,  layers->tile_size, layers->tiles_x, true) ||
+            !parallax_tile_axis(&axes_y[i], offsets[i].y, s, layers->height, layers->tile_size, layers->tiles_y, false)) {
+            return false;
+        }
+    }
+
+    u32 quad_count = 0;
+    for (u32 i = count; i > 0; i -= 1) {
+        if (!parallax_tile_emit(layers, &quad_count, i - 1, PARALLAX_TILE::OPAQUE, &axes_x[i - 1], &axes_y[i - 1], offsets[i - 1], s, quad_min, quad_max)) {
+            return false;
+        }
+    }
+    const u32 opaque_count = quad_count;
+    for (u32 i = 1; i < count; i += 1) {
+        if (!parallax_tile_emit(layers, &quad_count, i, PARALLAX_TILE::MIXED, &axes_x[i], &axes_y[i], offsets[i], s, quad_min, quad_max)) {
+            return false;
+        }
+    }
+    const u32 mixed_count = quad_count - opaque_count;
+
+    gl_bind_buffer(GL_ARRAY_BUFFER, layers->tile_vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, quad_count * 4 * 6 * sizeof(GLfloat), layers->tile_vertices);
+
+    gl_use_program(layers->tile_shader);
+    gl_bind_vertex_array(layers->tile_vao);
+
+    gl_set_depth_test(true);
+    gl_set_blend(false);
+    glDrawElements(GL_TRIANGLES, opaque_count * 6, GL_UNSIGNED_INT, (void*)0);
+
+    if (mixed_count > 0) {
+        // tested against the opaque tiles of nearer layers, but not written
+        gl_set_blend(true);
+        GL_texture_blend_func(layers->premultiplied);
+        glDepthMask(GL_FALSE);
+        glDrawElements(GL_TRIANGLES, mixed_count * 6, GL_UNSIGNED_INT, (void*)(opaque_count * 6 * sizeof(GLuint)));
+        glDepthMask(GL_TRUE);
+        gl_set_blend(false);
+    }
+
+    gl_set_depth_test(false);
+
+    return true;
+}
+
+void Parallax_Layers_free(Parallax_Layers* layers)
+{
+    // still loading, the loader created the array
+    if (layers->array == 0) {
+        layers->array = layers->target.texture;
+    }
+    if (layers->array != 0) {
+        glDeleteTextures(1, &layers->array);
+        layers->array = 0;
+    }
+    layers->target.texture = 0;
+
+    if (layers->tile_masks != nullptr) {
+        glDeleteVertexArrays(1, &layers->tile_vao);
+        glDeleteBuffers(1, &layers->tile_vbo);
+        glDeleteBuffers(1, &layers->tile_ebo);
+        gl_state_forget_program(layers->tile_shader);
+        glDeleteProgram(layers->tile_shader);
+        ::free(layers->tile_vertices);
+        ::free(layers->tile_masks);
+        layers->tile_masks    = nullptr;
+        layers->tile_vertices = nullptr;
+        gl_state_invalidate();
+    }
+}
+
+#endif // PARALLAX_HPP
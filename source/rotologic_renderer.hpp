@@ -8,13 +8,244 @@
 
 namespace sd {
 
+// draws are recorded with a 64-bit sort key and executed once per frame
+//
+// key layout, most significant first:
+// [63:56] layer      (depth buffer is cleared between layers)
+// [55]    blend
+// [54]    depth test
+// [53:40] shader     (zero for blended draws)
+// [39:24] texture    (zero for blended draws)
+// [23:0]  submission order within the layer
+//
+// blended draws keep their submission order, opaque draws are grouped by state
+// and only keep it among draws that share a shader and texture,
+// coplanar opaque draws with different state need a layer of their own
 struct Render_Context {
-    // TODO
-    Array<sd::Render_Batch<0>, 128> render_batches;
+    static constexpr usize MAX_COMMANDS = 512;
+    static constexpr usize MAX_MATRICES = 256;
+    static constexpr usize MAX_UPLOADS  = 32;
+
+    Array<Draw_Command, MAX_COMMANDS> commands;
+    // double-buffered for the radix sort
+    u64 keys[2][MAX_COMMANDS];
+    u32 order[2][MAX_COMMANDS];
+
+    Array<Mat4, MAX_MATRICES> matrices;
+    Array<VertexBufferData*, MAX_UPLOADS> uploads;
+
+    // state captured by submissions
+    u8   layer;
+    bool blend;
+    bool depth_test;
+    u32  sequence;
+
     //Shader_Registry shaders;
 };
 
+void Render_Context_init(Render_Context* ctx);
+// subsequent submissions are drawn over everything submitted before, as with glClear(GL_DEPTH_BUFFER_BIT)
+void Render_Context_layer_next(Render_Context* ctx);
+void Render_Context_execute(Render_Context* ctx);
+
 }
 
 #endif
 
+#ifdef ROTOLOGIC_RENDERER_IMPLEMENTATION
+#undef ROTOLOGIC_RENDERER_IMPLEMENTATION
+
+namespace sd {
+
+void Render_Context_init(Render_Context* ctx)
+{
+    ctx->commands.count = 0;
+    ctx->matrices.count = 0;
+    ctx->uploads.count  = 0;
+
+    ctx->layer      = 0;
+    ctx->blend      = false;
+    ctx->depth_test = true;
+    ctx->sequence   = 0;
+}
+
+void Render_Context_layer_next(Render_Context* ctx)
+{
+    ASSERT(ctx->layer < 0xFF);
+    ctx->layer += 1;
+    ctx->sequence = 0;
+}
+
+u32 Render_Context_push_matrix(Render_Context* ctx, const Mat4& matrix)
+{
+    // consecutive batches usually share the camera transform
+    if (ctx->matrices.count > 0 && ctx->matrices[ctx->matrices.count - 1] == matrix) {
+        return ctx->matrices.count - 1;
+    }
+
+    ctx->matrices.push_back(matrix);
+    return ctx->matrices.count - 1;
+}
+
+void Render_Context_upload(Render_Context* ctx, VertexBufferData* vbd)
+{
+    foreach (i, ctx->uploads.count) {
+        if (ctx->uploads[i] == vbd) {
+            return;
+        }
+    }
+
+    ctx->uploads.push_back(vbd);
+}
+
+void Render_Context_submit(Render_Context* ctx, const Draw_Command* cmd)
+{
+    if (ctx->commands.count == Render_Context::MAX_COMMANDS) {
+        SD_LOG_ERR("%s\n", "ERROR: Render_Context_submit MAX COMMANDS EXCEEDED");
+        return;
+    }
+
+    u64 key =
+        ((u64)ctx->layer                  << 56) |
+        ((u64)ctx->blend                  << 55) |
+        ((u64)ctx->depth_test             << 54) |
+        ((u64)(ctx->sequence & 0xFFFFFF));
+    if (!ctx->blend) {
+        key |= ((u64)(cmd->program & 0x3FFF) << 40) |
+               ((u64)(cmd->texture & 0xFFFF) << 24);
+    }
+    ctx->keys[0][ctx->commands.count] = key;
+    ctx->sequence += 1;
+
+    ctx->commands.push_back(*cmd);
+}
+
+// stable LSD radix sort on the keys, 8 bits per pass,
+// returns the command indices in draw order
+static const u32* Render_Context_sort(Render_Context* ctx)
+{
+    const usize count = ctx->commands.count;
+
+    u64* keys      = ctx->keys[0];
+    u64* keys_next = ctx->keys[1];
+    u32* order      = ctx->order[0];
+    u32* order_next = ctx->order[1];
+
+    foreach (i, count) {
+        order[i] = i;
+    }
+
+    for (usize shift = 0; shift < 64; shift += 8) {
+        usize histogram[256] = {0};
+        foreach (i, count) {
+            histogram[(keys[i] >> shift) & 0xFF] += 1;
+        }
+
+        // every key has the same byte here, the pass would not move anything
+        if (histogram[(keys[0] >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        usize sum = 0;
+        foreach (b, 256) {
+            const usize c = histogram[b];
+            histogram[b] = sum;
+            sum += c;
+        }
+
+        foreach (i, count) {
+            const usize dst = histogram[(keys[i] >> shift) & 0xFF]++;
+            keys_next[dst]  = keys[i];
+            order_next[dst] = order[i];
+        }
+
+        std::swap(keys, keys_next);
+        std::swap(order, order_next);
+    }
+
+    return order;
+}
+
+void Render_Context_execute(Render_Context* ctx)
+{
+    const usize count = ctx->commands.count;
+    if (count == 0) {
+        Render_Context_init(ctx);
+        return;
+    }
+
+    // each batch buffer is uploaded once, however many ranges of it were queued
+    foreach (i, ctx->uploads.count) {
+        gl_bind_buffers_and_upload_sub_data(ctx->uploads[i]);
+    }
+
+    const u32* order = Render_Context_sort(ctx);
+    const u64* keys  = (order == ctx->order[0]) ? ctx->keys[0] : ctx->keys[1];
+
+    // binds go through the GL state cache, only the matrix is tracked here
+    // since comparing an index is cheaper than comparing 16 floats
+    u64 prev_state   = ~(u64)0;
+    u32 matrix_index = ~(u32)0;
+    GLuint program   = GL_STATE_UNKNOWN;
+
+    foreach (i, count) {
+        const Draw_Command* cmd = &ctx->commands[order[i]];
+        const u64 key = keys[i];
+
+        // layer, blend and depth test
+        const u64 state = key >> 54;
+        if (state != prev_state) {
+            const u64 layer = key >> 56;
+            if (layer != 0 && (prev_state == ~(u64)0 || (prev_state >> 2) != layer)) {
+                glClear(GL_DEPTH_BUFFER_BIT);
+            }
+
+            const bool blend = (key >> 55) & 1;
+            gl_set_blend(blend);
+            if (blend) {
+                gl_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            }
+
+            gl_set_depth_test((key >> 54) & 1);
+
+            prev_state = state;
+        }
+
+        if (cmd->program != program) {
+            program = cmd->program;
+            gl_use_program(program);
+            matrix_index = ~(u32)0;
+        }
+
+        if (cmd->matrix_index != matrix_index) {
+            matrix_index = cmd->matrix_index;
+            gl_uniform_matrix4fv(cmd->mat_loc, glm::value_ptr(ctx->matrices[matrix_index]));
+        }
+
+        if (cmd->texture != 0) {
+            gl_active_texture(GL_TEXTURE0);
+            gl_bind_texture(GL_TEXTURE_2D, cmd->texture);
+        }
+
+        gl_bind_vertex_array(cmd->vao);
+
+        switch (cmd->type) {
+        case DRAW_COMMAND_TYPE::ELEMENTS:
+            glDrawElements(cmd->primitive, cmd->count, GL_UNSIGNED_INT, (GLvoid*)cmd->offset);
+            break;
+        case DRAW_COMMAND_TYPE::ARRAYS_INSTANCED:
+            gl_bind_buffer(GL_ARRAY_BUFFER, cmd->instance_buffer);
+            Shape_Instance_set_attribs(cmd->instance_offset);
+            glDrawArraysInstanced(cmd->primitive, cmd->offset, cmd->count, cmd->instance_count);
+            break;
+        }
+    }
+
+    gl_set_blend(false);
+
+    Render_Context_init(ctx);
+}
+
+}
+
+#endif
@@ -14,12 +14,19 @@
 
 #if !(RELEASE_MODE)
     #define USE_ASSERTS
+    #define SHADER_HOT_RELOAD
 #endif
 
 
 #define UNITY_BUILD (true)
 
 //#define METATESTING
+//#define BENCHMARKING
+//#define THUMBNAIL
+//#define WORLD_PARTITION
+//#define TEXTURE_ATLAS_PACK
+//#define PARALLAX_TILE_BAKE
+//#define TEXTURE_COOK
 
 // audio
 #define AUDIO_SYS_IMPLEMENTATION
@@ -59,6 +66,12 @@
 #define TEXTURE_IMPLEMENTATION
 #include "texture.hpp"
 
+#define TEXTURE_ATLAS_IMPLEMENTATION
+#include "texture_atlas.hpp"
+
+#define PARALLAX_IMPLEMENTATION
+#include "parallax.hpp"
+
 #define CAMERA_IMPLEMENTATION
 #include "camera.hpp"
 
@@ -78,19 +91,6 @@ void* GlobalArenaAlloc_index_data(size_t count)
     return xmalloc(count * sizeof(GLuint));    
 }
 
-// WORLD STATE
-struct Room {
-    VertexBufferData  geometry;
-    Collider* collision_data;
-    Mat4 matrix;
-};
-
-struct World {
-    Room* rooms;
-    Mat4 m_view;
-    Mat4 m_projection;
-};
-
 struct GlobalData {
     SDL_GLContext context;
     TextureData textures;
@@ -112,8 +112,13 @@ GlobalData program_data;
 #define SD_IMPLEMENTATION
 #include "sd.hpp"
 
+#define ROTOLOGIC_RENDERER_IMPLEMENTATION
 #include "rotologic_renderer.hpp"
 
+// WORLD STATE
+#define WORLD_IMPLEMENTATION
+#include "world.hpp"
+
 
 #define LOGIC_NODE_TYPE_LIST \
     LOGIC_NODE_ENTRY(VALUE, STRING(VALUE)) \
@@ -1170,6 +1175,17 @@ bool load_config(AirPhysicsConfig* conf)
 #include "metatesting.cpp"
 #endif
 
+#ifdef BENCHMARKING
+#include "benchmarks.cpp"
+#endif
+
+#ifdef THUMBNAIL
+#define SOFTWARE_RASTER_IMPLEMENTATION
+#include "software_raster.hpp"
+#include "sd_software.hpp"
+#include "thumbnail.cpp"
+#endif
+
 
 #include <time.h>
 int main(int argc, char* argv[])
@@ -1254,6 +1270,80 @@ int main(int argc, char* argv[])
     metatesting();
     return EXIT_SUCCESS;
     #endif
+    #ifdef BENCHMARKING
+    puts("benchmarking, main program disabled");
+    benchmarks();
+    return EXIT_SUCCESS;
+    #endif
+    #ifdef THUMBNAIL
+    puts("thumbnail, main program disabled");
+    return thumbnail((argc > 1) ? argv[1] : "worlds/lines_test_a.txt") ? EXIT_SUCCESS : EXIT_FAILURE;
+    #endif
+    #ifdef WORLD_PARTITION
+    puts("world partition, main program disabled");
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <level file> <existing room directory>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    return World_partition(argv[1], argv[2], WORLD_ROOM_SIZE) ? EXIT_SUCCESS : EXIT_FAILURE;
+    #endif
+    #ifdef TEXTURE_ATLAS_PACK
+    puts("texture atlas packing, main program disabled");
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <output prefix> <image>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)) {
+        fprintf(stderr, "SDL_image could not initialize, SDL_image Error: %s\n", IMG_GetError());
+        return EXIT_FAILURE;
+    }
+    {
+        const bool packed = texture_atlas_pack(argv[1], argv + 2, argc - 2);
+        IMG_Quit();
+        return packed ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    #endif
+    #ifdef TEXTURE_COOK
+    puts("texture cooking, main program disabled");
+    {
+        // -p premultiplies alpha, -f sets the filter the texture is loaded with
+        bool premultiply = false;
+        TEXTURE_FILTER filter = TEXTURE_FILTER::NEAREST_MIPMAP;
+        int first = 1;
+        for (; first < argc && argv[first][0] == '-'; first += 1) {
+            if (strcmp(argv[first], "-p") == 0) {
+                premultiply = true;
+            } else if (strcmp(argv[first], "-f") == 0 && first + 1 < argc && texture_filter_parse(argv[first + 1], &filter)) {
+                first += 1;
+            } else {
+                break;
+            }
+        }
+        if (argc <= first || argv[first][0] == '-') {
+            fprintf(stderr, "usage: %s [-p] [-f nearest|nearest_mipmap|linear|trilinear] <image>...\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+        if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)) {
+            fprintf(stderr, "SDL_image could not initialize, SDL_image Error: %s\n", IMG_GetError());
+            return EXIT_FAILURE;
+        }
+        const bool cooked = texture_cook_files(argv + first, argc - first, premultiply, filter);
+        IMG_Quit();
+        return cooked ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    #endif
+    #ifdef PARALLAX_TILE_BAKE
+    puts("parallax tile baking, main program disabled");
+    if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)) {
+        fprintf(stderr, "SDL_image could not initialize, SDL_image Error: %s\n", IMG_GetError());
+        return EXIT_FAILURE;
+    }
+    {
+        const bool baked = parallax_tile_masks_bake((argc > 1) ? argv[1] : "textures/separate_test_2/layers.txt", PARALLAX_TILE_SIZE);
+        IMG_Quit();
+        return baked ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    #endif
     using namespace input_sys;
     int control_lock_time = 0;
     bool control_lock = false;
@@ -1351,21 +1441,16 @@ int main(int argc, char* argv[])
 
     ConfigState_load_runtime();
 
-    bool status = false;
-    std::string glsl_perlin_noise = Shader_retrieve_src_from_file("shaders/perlin_noise.glsl", &status);
-    if (!status) {
-        fprintf(stderr, "ERROR: failed to load shader addon source");
-        return EXIT_FAILURE;
-    } 
+    #ifdef SHADER_HOT_RELOAD
+    Shader_hot_reload_init();
+    #endif
 
     // SHADERS
     Shader shader_2d;
     if (false == Shader_load_from_file(
         &shader_2d,
         "shaders/parallax/parallax_v2_vrt.glsl",
-        "shaders/parallax/parallax_v2_frg.glsl",
-        glsl_perlin_noise,
-        glsl_perlin_noise
+        "shaders/parallax/parallax_v2_frg.glsl"
     )) {
         fprintf(stderr, "ERROR: shader_2d\n");
         return EXIT_FAILURE;
@@ -1381,6 +1466,12 @@ int main(int argc, char* argv[])
         fprintf(stderr, "ERROR: shader_grid\n");
         return EXIT_FAILURE;
     }
+
+    // projection, view, camera and time, shared by all programs
+    Frame_Uniform_Buffer frame_ubo;
+    if (false == Frame_Uniform_Buffer_init(&frame_ubo)) {
+        return EXIT_FAILURE;
+    }
 ///////////////
 
     const GLfloat ASPECT = (GLfloat)SCREEN_WIDTH / (GLfloat)SCREEN_HEIGHT;
@@ -1579,16 +1670,20 @@ int main(int argc, char* argv[])
     // }
 
 
-    Texture bgs[5];
-    foreach(i, 5) {
-        if (GL_FALSE == GL_texture_gen_and_load_1(
-                &bgs[i], ("./textures/separate_test_2/" + std::to_string(i) + ".png").c_str(), 
-                GL_TRUE, GL_REPEAT, GL_CLAMP_TO_EDGE
-        )) {
+    // decoded on worker threads, streamed in over the first frames
+    Texture_Loader texture_loader;
+    {
+        const int cpu_count = SDL_GetCPUCount();
+        if (!Texture_Loader_init(&texture_loader, (cpu_count > 2) ? cpu_count - 1 : 1, 4 * 1024 * 1024)) {
             return EXIT_FAILURE;
         }
     }
 
+    Parallax_Layers bg_layers;
+    if (!Parallax_Layers_load_async(&bg_layers, "textures/separate_test_2/layers.txt", &texture_loader)) {
+        return EXIT_FAILURE;
+    }
+
     gl_get_errors();
 
 
@@ -1596,45 +1691,32 @@ int main(int argc, char* argv[])
 
     //UniformLocation RES_LOC = glGetUniformLocation(shader_2d, "u_resolution");
     //UniformLocation COUNT_LAYERS_LOC = glGetUniformLocation(shader_2d, "u_count_layers");
-    UniformLocation MAT_LOC = glGetUniformLocation(shader_2d, "u_matrix");
-    UniformLocation TIME_LOC = glGetUniformLocation(shader_2d, "u_time");
-    UniformLocation CAM_LOC = glGetUniformLocation(shader_2d, "u_position_cam");
-    UniformLocation SCALE_LOC = glGetUniformLocation(shader_2d, "u_scale");
-    glUniform1f(SCALE_LOC, (GLfloat)1.0);
+    glUniform3fv(glGetUniformLocation(shader_2d, "u_world_bguv_factor"), 1, glm::value_ptr(world_bguv_factor));
     //UniformLocation ASPECT_LOC = glGetUniformLocation(shader_2d, "u_aspect");
 
-    const GLuint UVAL_COUNT_LAYERS = 5;
-
     //glUniform2fv(RES_LOC, 1, glm::value_ptr(Vec2(SCREEN_WIDTH, SCREEN_HEIGHT)));
     //glUniform1i(COUNT_LAYERS_LOC, UVAL_COUNT_LAYERS);
     //glUniform1f(ASPECT_LOC, (GLfloat)SCREEN_WIDTH / (GLfloat)SCREEN_HEIGHT);
-    // TEXTURE 0
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, bgs[0]);
-    glUniform1i(glGetUniformLocation(shader_2d, "tex0"), 0);
-
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, bgs[1]);
-    glUniform1i(glGetUniformLocation(shader_2d, "tex1"), 1);
-
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, bgs[2]);
-    glUniform1i(glGetUniformLocation(shader_2d, "tex2"), 2);
-
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, bgs[3]);
-    glUniform1i(glGetUniformLocation(shader_2d, "tex3"), 3);
-
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D, bgs[4]);
-    glUniform1i(glGetUniformLocation(shader_2d, "tex4"), 4);
+    // every layer in one texture array on unit 0
+    Parallax_Layers_set_uniforms(&bg_layers, shader_2d, 0);
 
 
     gl_get_errors();
 
 
     #ifdef SD
-    auto drawctx = sd::Render_Batch_make(mat_projection);
+    sd::Render_Context render_ctx;
+    sd::Render_Context_init(&render_ctx);
+
+    auto drawctx = sd::Render_Batch_make();
+    drawctx.render_context = &render_ctx;
+
+    // rooms streamed around the camera when started with -w <room directory>
+    World world;
+    const bool world_streaming = (cmd.world != nullptr);
+    if (world_streaming && !World_init(&world, cmd.world, WORLD_ROOM_SIZE)) {
+        return EXIT_FAILURE;
+    }
     #endif
 
     Toggle free_cam_toggle = false;
@@ -1650,26 +1732,25 @@ int main(int argc, char* argv[])
     GLfloat grid_square_pixel_size = 16.0f;
     glUniform1f(SQUARE_PIXEL_LOC_GRID, tex_res.x / grid_square_pixel_size);
 
-    UniformLocation MAT_LOC_GRID = glGetUniformLocation(shader_grid, "u_matrix");
 
-    UniformLocation CAM_LOC_GRID = glGetUniformLocation(shader_grid, "u_position_cam");
-
-    UniformLocation SCALE_LOC_GRID = glGetUniformLocation(shader_grid, "u_scale");
-    glUniform1f(SCALE_LOC_GRID, (GLfloat)1.0);
-
-    sd::Render_Batch<> existing;
+    sd::Static_Mesh<> existing;
     sd::Render_Batch<256> in_prog;
+    sd::Render_Batch_Instanced<64> in_prog_shapes;
     Toggle drawing = false;
     Toggle deletion = false;
 
-    if (!existing.init(mat_projection)) {
+    if (!sd::Static_Mesh_init(&existing)) {
         fprintf(stderr, "FAILED TO INITIALIZE EDITOR DATA \"existing\"\n");
         return EXIT_FAILURE;
     }
-    if (!in_prog.init(mat_projection)) {
+    if (!in_prog.init()) {
         fprintf(stderr, "FAILED TO INITIALIZE EDITOR DATA \"in_prog\"\n");
         return EXIT_FAILURE;
     }
+    if (!in_prog_shapes.init()) {
+        fprintf(stderr, "FAILED TO INITIALIZE EDITOR DATA \"in_prog_shapes\"\n");
+        return EXIT_FAILURE;
+    }
     #endif
 
 
@@ -1750,15 +1831,17 @@ int main(int argc, char* argv[])
     collision_map.next_free_slot()->b = Vec3(768.0, 3 * 128, 0.0);
     collision_map.count += 1;
 
-    existing.begin();
-    existing.draw_type = sd::LINES;
-    existing.color = Color::BLACK;
+    existing.geometry.draw_type = sd::LINES;
+    existing.geometry.color = Color::BLACK;
     
     foreach (i, collision_map.count) {
-        SD_ASSERT(existing.line(collision_map[i].a, collision_map[i].b));
+        SD_ASSERT(existing.geometry.line(collision_map[i].a, collision_map[i].b));
     }
 
-    existing.end_no_reset();
+    sd::Static_Mesh_bake(&existing);
+
+    in_prog.render_context        = &render_ctx;
+    in_prog_shapes.render_context = &render_ctx;
 
 
     Toggle temp = false;
@@ -1836,6 +1919,27 @@ int main(int argc, char* argv[])
         return -2;
     }
 
+    // loop bgm
+    // (44100 = 1 second into the clip, given a sample rate of 44.1 KHz)
+
+    // for the current iteration of "Time Rush" (July 18th, 2018), which plays at 170 bpm,
+    // the loop-point is 26 measures in at 4/4 (26 * 4 quarter notes) plus 1 quater note
+    // samples per quarter note = (60 / BPM) * SAMPLE_RATE
+    // e.g. (60.0 / 170) * 44100 * 26 * 4
+    {
+        #define SAMPLE_RATE (44100)
+        #define BPM (170)
+        #define MEASURE_COUNT (26)
+        #define QUARTER_NOTES_PER_MEASURE (4)
+
+        // the device has not started, so the voice can be set up directly
+        AudioVoice* bgm = &audio_args.voices[0];
+        bgm->looping    = true;
+        bgm->loop_start = (u64)roundf(LOOP_FRAME_4_4(MEASURE_COUNT, QUARTER_NOTES_PER_MEASURE, 1, SAMPLE_RATE, BPM));
+        bgm->loop_end   = 0;
+        bgm->state      = AUDIO_VOICE_STATE::PLAYING;
+    }
+
     mal_device_config config = mal_device_config_init_playback(
         audio_args.decoders[0].outputFormat,
         audio_args.decoders[0].outputChannels,
@@ -1878,6 +1982,10 @@ int main(int argc, char* argv[])
         SDL_GetWindowSize(window, &w, &h);
         std::cout << "WIDTH: " << w << " HEIGHT: " << h << std::endl;
     }
+
+    // everything bound during setup went through the raw gl calls
+    gl_state_invalidate();
+
     while (is_running) {
         t_prev = t_now;
         t_prev_s = t_now_s;
@@ -1890,6 +1998,11 @@ int main(int argc, char* argv[])
 
         f64 t_since_start_s = ((f64)(t_now - t_start)) / frequency;
 
+        #ifdef SHADER_HOT_RELOAD
+        Shader_hot_reload_poll();
+        #endif
+        Texture_Loader_update(&texture_loader);
+
         // INPUT /////////////////////////////////
         if (!poll_input_events(&input, &event)) {
             is_running = false;
@@ -1915,6 +2028,21 @@ int main(int argc, char* argv[])
         bool left_held = false;
         bool right_held = false;
 
+        // rooms are only evicted or finished here, so the spans stay valid for the rest of the frame
+        if (world_streaming) {
+            World_Rect streaming_rect = FreeCamera_visible_world_rect(&main_cam, Vec2(SCREEN_WIDTH, SCREEN_HEIGHT));
+            World_update(&world, (streaming_rect.min + streaming_rect.max) * 0.5f);
+        }
+
+        // the editor's colliders followed by the resident rooms'
+        Collider_Span collider_spans[1 + WORLD_MAX_ROOMS];
+        collider_spans[0].begin = collision_map.begin();
+        collider_spans[0].end   = collision_map.next_free_slot();
+        usize collider_span_count = 1;
+        if (world_streaming) {
+            collider_span_count += World_collider_spans(&world, &collider_spans[1]);
+        }
+
         {
 
             //main_cam.orientation = Quat();
@@ -2117,10 +2245,9 @@ int main(int argc, char* argv[])
                 // this will be off by one movement, need to reorganize so camera updated after play is updated,
                 // also cannot draw bg yet... will need to sequence things differently
 
-                drawctx.begin();
-                drawctx.transform_matrix = FreeCamera_calc_view_matrix(&main_cam);
-
-                for (auto it = collision_map.begin(); it != collision_map.next_free_slot(); it += 1)
+                // the intersection lines stay in drawctx and are queued with the editor overlay below
+                for (usize span = 0; span < collider_span_count; span += 1)
+                for (Collider* it = collider_spans[span].begin; it != collider_spans[span].end; it += 1)
                 {
                     //Collider_print(it);
                     
@@ -2146,7 +2273,6 @@ int main(int argc, char* argv[])
 
                     }
                 }
-                drawctx.end_no_reset();
 
                 // TODO slopes
 
@@ -2240,7 +2366,10 @@ int main(int argc, char* argv[])
 
             switch (key_is_toggled_4_states(&input, CONTROL::TEMP, &temp)) {
             case TOGGLE_BRANCH::PRESSED_ON: {
-                AudioCommand* cmd = (AudioCommand*)xmalloc(sizeof(*cmd));
+                AudioCommand* cmd = AudioCommand_alloc(&audio_args);
+                if (cmd == nullptr) {
+                    break;
+                }
                 cmd->type = AUDIO_COMMAND_TYPE::ADJUST_MASTER_VOLUME;
                 
                 cmd->adjust_master_volume.duration = 5.0f;
@@ -2249,16 +2378,17 @@ int main(int argc, char* argv[])
                 cmd->adjust_master_volume.t_delta  = 0.0f;
                 cmd->adjust_master_volume.t_prev   = 0.0f; 
 
-                if (ck_ring_enqueue_spsc(&audio_args.fifo.ring, audio_args.fifo.buffer, (void*)cmd) == false) {
-                    fprintf(stderr, "ERROR: OUT OF AUDIO QUEUE SPACE\n");
-                }
+                AudioCommand_send(&audio_args, cmd);
                 break;
             }
             case TOGGLE_BRANCH::ON: {
                 break;
             }
             case TOGGLE_BRANCH::PRESSED_OFF: {
-                AudioCommand* cmd = (AudioCommand*)xmalloc(sizeof(*cmd));
+                AudioCommand* cmd = AudioCommand_alloc(&audio_args);
+                if (cmd == nullptr) {
+                    break;
+                }
                 cmd->type = AUDIO_COMMAND_TYPE::ADJUST_MASTER_VOLUME;
                 
                 cmd->adjust_master_volume.duration  = 5.0f;
@@ -2267,9 +2397,7 @@ int main(int argc, char* argv[])
                 cmd->adjust_master_volume.t_delta   = 0.0f;
                 cmd->adjust_master_volume.t_prev    = 0.0f;
 
-                if (ck_ring_enqueue_spsc(&audio_args.fifo.ring, audio_args.fifo.buffer, (void*)cmd) == false) {
-                    fprintf(stderr, "ERROR: OUT OF AUDIO QUEUE SPACE\n");
-                }
+                AudioCommand_send(&audio_args, cmd);
                 break;
             }
             case TOGGLE_BRANCH::OFF: {
@@ -2290,21 +2418,16 @@ int main(int argc, char* argv[])
         glClearColor(97.0 / 255.0, 201.0 / 255.0, 255.0 / 255.0, 0.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glUseProgram(shader_2d);
-
-
-        //glUniformMatrix4fv(MAT_LOC, 1, GL_FALSE, glm::value_ptr(ViewCamera_calc_view_matrix(&main_cam) * mat_ident));
-        glUniformMatrix4fv(MAT_LOC, 1, GL_FALSE, glm::value_ptr(
-            mat_projection
-            /**FreeCamera_calc_view_matrix(&main_cam)*/
-            /*glm::translate(mat_ident, Vec3(glm::sin(((double)t_now / frequency)), 0.0, 0.0)) * */
-            /*glm::scale(mat_ident, Vec3(0.25, 0.25, 1.0))* */
-                        )
-        );
+        Vec3 pos = main_cam.position;
 
-        glUniform1f(TIME_LOC, t_since_start_s);
+        Frame_Data frame_data;
+        frame_data.projection   = mat_projection;
+        frame_data.view         = FreeCamera_calc_view_matrix(&main_cam);
+        frame_data.position_cam = Vec4(pos, 1.0f);
+        frame_data.scale        = main_cam.scale;
+        frame_data.time         = t_since_start_s;
+        Frame_Uniform_Buffer_update(&frame_ubo, &frame_data);
 
-        Vec3 pos = main_cam.position;
         #ifdef DEBUG_PRINT
 
             if (pos.x != prev_pos.x || pos.y != prev_pos.y || pos.z != prev_pos.z) {
@@ -2317,9 +2440,6 @@ int main(int argc, char* argv[])
         // Vec3 VV = pos * world_bguv_factor;
         // vec3_print(&VV);
         // std::cout << std::endl;
-        glUniform1f(SCALE_LOC, main_cam.scale);
-
-        glUniform3fv(CAM_LOC, 1, glm::value_ptr(pos * world_bguv_factor));
         //glEnable(GL_DEPTH_TEST);
         //glClear(GL_DEPTH_BUFFER_BIT);
         // glDepthRange(0, 1);
@@ -2345,18 +2465,47 @@ int main(int argc, char* argv[])
         //glDisable(GL_DEPTH_TEST);
 
         
-        glBindVertexArray(vao_2d2.vao);
-        glDrawElements(GL_TRIANGLES, tri_data.i_count, GL_UNSIGNED_INT, 0);
+        // the clear colour until every layer is in,
+        // tiled when the layers have tile masks, the single-pass shader otherwise
+        if (Parallax_Layers_ready(&bg_layers)) {
+            // elided unless something else was bound to unit 0
+            gl_active_texture(GL_TEXTURE0);
+            gl_bind_texture(GL_TEXTURE_2D_ARRAY, bg_layers.array);
+
+            const Vec3 bg_pos = pos * world_bguv_factor;
+            const Vec2 bg_off = Vec2(bg_pos.x, glm::clamp(bg_pos.y, -1.45f, 1.45f));
+            if (!Parallax_Layers_draw_tiles(
+                &bg_layers, bg_off, main_cam.scale,
+                Vec2(-X_OFF, -Y_OFF), Vec2(tex_res.x - X_OFF, tex_res.y - Y_OFF)
+            )) {
+                gl_use_program(shader_2d);
+                gl_bind_vertex_array(vao_2d2.vao);
+                glDrawElements(GL_TRIANGLES, tri_data.i_count, GL_UNSIGNED_INT, 0);
+            }
+        }
         //glBindVertexArray(0);
 
         #ifdef SD
 
-        glEnable(GL_DEPTH_TEST);
+        gl_set_depth_test(true);
         glDepthRange(0, 1);
         glClear(GL_DEPTH_BUFFER_BIT);
 
 
-        Mat4 cam = FreeCamera_calc_view_matrix(&main_cam);
+        Mat4 cam = frame_data.view;
+
+        // batches drawn with the camera transform only queue what is on screen
+        World_Rect view_rect = FreeCamera_visible_world_rect(&main_cam, Vec2(SCREEN_WIDTH, SCREEN_HEIGHT));
+        sd::cull_rect_set(&drawctx, view_rect.min, view_rect.max);
+
+        if (world_streaming) {
+            World_draw(&world, &render_ctx, cam, view_rect.min, view_rect.max);
+        }
+        #ifdef EDITOR
+        sd::cull_rect_set(&existing.geometry, view_rect.min, view_rect.max);
+        sd::cull_rect_set(&in_prog, view_rect.min, view_rect.max);
+        sd::cull_rect_set(&in_prog_shapes, view_rect.min, view_rect.max);
+        #endif
 
         // drawctx.begin();
 
@@ -2433,39 +2582,29 @@ int main(int argc, char* argv[])
         #ifdef EDITOR
 
         if (key_is_toggled(&input, CONTROL::EDIT_MODE, &grid_toggle)) {
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            gl_set_blend(true);
+            gl_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            render_ctx.blend = true;
 
             glClear(GL_DEPTH_BUFFER_BIT);
 
 
-            glUseProgram(shader_grid);
-
-            glUniform1f(glGetUniformLocation(shader_grid, "u_time"), t_since_start_s);
-            glUniform1f(SCALE_LOC_GRID, main_cam.scale);
+            gl_use_program(shader_grid);
 
             if (key_is_pressed(&input, CONTROL::ZOOM_IN)) {
                 grid_square_pixel_size *= 2;
                 grid_square_pixel_size = glm::clamp(grid_square_pixel_size, 4.0f, 128.0f);
 
-                glUniform1f(SQUARE_PIXEL_LOC_GRID, tex_res.x / grid_square_pixel_size);
+                gl_uniform1f(SQUARE_PIXEL_LOC_GRID, tex_res.x / grid_square_pixel_size);
             } else if (key_is_pressed(&input, CONTROL::ZOOM_OUT)) {
                 grid_square_pixel_size /= 2;
                 grid_square_pixel_size = glm::clamp(grid_square_pixel_size, 4.0f, 128.0f);
 
-                glUniform1f(SQUARE_PIXEL_LOC_GRID, tex_res.x / grid_square_pixel_size);
+                gl_uniform1f(SQUARE_PIXEL_LOC_GRID, tex_res.x / grid_square_pixel_size);
             }
 
 
-            glUniformMatrix4fv(MAT_LOC_GRID, 1, GL_FALSE, glm::value_ptr(
-                    mat_projection
-                )
-            );
-
-            glUniform3fv(CAM_LOC_GRID, 1, glm::value_ptr(pos));
-
-
-            glBindVertexArray(vao_2d2.vao);
+            gl_bind_vertex_array(vao_2d2.vao);
 
             glDrawElements(GL_TRIANGLES, tri_data.i_count, GL_UNSIGNED_INT, 0);
 
@@ -2588,7 +2727,7 @@ int main(int argc, char* argv[])
             // if (drawing) {
             //     printf("DRAWING\n");
             // }
-            glClear(GL_DEPTH_BUFFER_BIT);
+            sd::Render_Context_layer_next(&render_ctx);
 
 
 
@@ -2601,24 +2740,19 @@ int main(int argc, char* argv[])
             if (mouse_is_toggled(&input, MOUSE_BUTTON::RIGHT, &deletion)) {
                 drawing = false;
 
-                existing.begin();
-                existing.transform_matrix = cam;
+                sd::Static_Mesh_draw(&existing, &render_ctx, cam);
 
-                existing.draw_type = sd::LINES;
-                //existing.transform_matrix = cam;
-                existing.end_no_reset();
-
-                glClear(GL_DEPTH_BUFFER_BIT);
+                sd::Render_Context_layer_next(&render_ctx);
 
                 if (mouse_is_pressed(&input, MOUSE_BUTTON::LEFT)) {
-                    in_prog.begin();
+                    in_prog_shapes.begin();
 
                     {
-                        in_prog.draw_type = sd::TRIANGLES;
-                        in_prog.transform_matrix = cam;
-                        in_prog.color = Color::RED;
+                        in_prog_shapes.draw_type = sd::TRIANGLES;
+                        in_prog_shapes.transform_matrix = cam;
+                        in_prog_shapes.color = Color::RED;
                         sd::circle(
-                            &in_prog,
+                            &in_prog_shapes,
                             10.0f * (1.0 / main_cam.scale),
                             Vec3(
                                 mouse.x, 
@@ -2629,7 +2763,7 @@ int main(int argc, char* argv[])
                         );
                     }
 
-                    in_prog.end();
+                    in_prog_shapes.end();
 
 
 
@@ -2664,17 +2798,17 @@ int main(int argc, char* argv[])
                         collision_map[selection] = collision_map[collision_map.count - 1];
                         collision_map.count -= 1;
 
-                        sd::remove_line_swap_end(&existing, selection);
+                        sd::Static_Mesh_remove_line_swap_end(&existing, selection);
                     }
                 } else {
-                    in_prog.begin();
+                    in_prog_shapes.begin();
 
                     {
-                        in_prog.draw_type = sd::TRIANGLES;
-                        in_prog.transform_matrix = cam;
-                        in_prog.color = Color::RED;
+                        in_prog_shapes.draw_type = sd::TRIANGLES;
+                        in_prog_shapes.transform_matrix = cam;
+                        in_prog_shapes.color = Color::RED;
                         sd::circle(
-                            &in_prog,
+                            &in_prog_shapes,
                             5.0f * (1.0 / main_cam.scale),
                             Vec3(
                                 mouse.x, 
@@ -2685,7 +2819,7 @@ int main(int argc, char* argv[])
                         );
                     }
 
-                    in_prog.end();                    
+                    in_prog_shapes.end();                    
                 }
 
             } else {
@@ -2712,13 +2846,15 @@ int main(int argc, char* argv[])
                     in_prog.transform_matrix = cam;
                     in_prog.color = Color::BLACK;
                     in_prog.line(in_progress_line[0], in_progress_line[1]);
+                    in_prog.end();
 
+                    in_prog_shapes.begin();
                     {
-                        in_prog.draw_type = sd::TRIANGLES;
-                        in_prog.transform_matrix = cam;
-                        in_prog.color = Color::BLUE;
+                        in_prog_shapes.draw_type = sd::TRIANGLES;
+                        in_prog_shapes.transform_matrix = cam;
+                        in_prog_shapes.color = Color::BLUE;
                         sd::circle(
-                            &in_prog,
+                            &in_prog_shapes,
                             5.0f * (1.0 / main_cam.scale),
                             Vec3(
                                 snap_to_grid(mouse.x, grid_len), 
@@ -2729,15 +2865,10 @@ int main(int argc, char* argv[])
                         );
                     }
 
-                    in_prog.end();
-
+                    in_prog_shapes.end();
 
-                    existing.begin();
-                    existing.transform_matrix = cam;
 
-                    existing.draw_type = sd::LINES;
-                    //existing.transform_matrix = cam;
-                    existing.end_no_reset();
+                    sd::Static_Mesh_draw(&existing, &render_ctx, cam);
 
                     break;
                 case TOGGLE_BRANCH::PRESSED_OFF:
@@ -2746,13 +2877,13 @@ int main(int argc, char* argv[])
 
                     collision_map.count += 1;
 
-                    in_prog.begin();
+                    in_prog_shapes.begin();
                     {
-                        in_prog.draw_type = sd::TRIANGLES;
-                        in_prog.transform_matrix = cam;
-                        in_prog.color = Color::GREEN;
+                        in_prog_shapes.draw_type = sd::TRIANGLES;
+                        in_prog_shapes.transform_matrix = cam;
+                        in_prog_shapes.color = Color::GREEN;
                         sd::circle(
-                            &in_prog,
+                            &in_prog_shapes,
                             10.0f * (1.0 / main_cam.scale),
                             Vec3(
                                 snap_to_grid(mouse.x, grid_len), 
@@ -2762,17 +2893,12 @@ int main(int argc, char* argv[])
                             32
                         );
                     }
-                    in_prog.end();
-
-                    existing.begin();
-                    existing.transform_matrix = cam;
-
-                    existing.draw_type = sd::LINES;
-                    //existing.transform_matrix = cam;
+                    in_prog_shapes.end();
 
                     //sort_segment(in_progress_line);
                     
-                    existing.line(in_progress_line[0], in_progress_line[1]);
+                    // the new segment is baked by the draw below
+                    existing.geometry.line(in_progress_line[0], in_progress_line[1]);
 
                     // {
                     //     f64 dy = in_progress_line[1].y - in_progress_line[0].y;
@@ -2794,16 +2920,16 @@ int main(int argc, char* argv[])
 
                     // }
 
-                    existing.end_no_reset();
+                    sd::Static_Mesh_draw(&existing, &render_ctx, cam);
                     break;
                 case TOGGLE_BRANCH::OFF:
-                    in_prog.begin();
+                    in_prog_shapes.begin();
                     {
-                        in_prog.draw_type = sd::TRIANGLES;
-                        in_prog.transform_matrix = cam;
-                        in_prog.color = Color::BLUE;
+                        in_prog_shapes.draw_type = sd::TRIANGLES;
+                        in_prog_shapes.transform_matrix = cam;
+                        in_prog_shapes.color = Color::BLUE;
                         sd::circle(
-                            &in_prog,
+                            &in_prog_shapes,
                             5.0f * (1.0 / main_cam.scale),
                             Vec3(
                                 snap_to_grid(mouse.x, grid_len), 
@@ -2813,13 +2939,9 @@ int main(int argc, char* argv[])
                             32
                         );
                     }
-                    in_prog.end();
+                    in_prog_shapes.end();
 
-                    existing.begin();
-                    existing.transform_matrix = cam;
-                    existing.draw_type = sd::LINES;
-                    //existing.transform_matrix = cam;
-                    existing.end_no_reset();
+                    sd::Static_Mesh_draw(&existing, &render_ctx, cam);
                     break;
                 default:
                     break;
@@ -2828,7 +2950,7 @@ int main(int argc, char* argv[])
 
             drawctx.begin();
 
-            glClear(GL_DEPTH_BUFFER_BIT);
+            sd::Render_Context_layer_next(&render_ctx);
 
             drawctx.draw_type = sd::LINES;
 
@@ -2852,7 +2974,7 @@ int main(int argc, char* argv[])
 
             drawctx.begin();
 
-            glClear(GL_DEPTH_BUFFER_BIT);
+            sd::Render_Context_layer_next(&render_ctx);
 
             drawctx.color = Color::GREEN;
             drawctx.transform_matrix = cam;
@@ -2896,7 +3018,10 @@ int main(int argc, char* argv[])
 
             CollisionStatus status;
             CollisionStatus_init(&status);
-            for (auto it = collision_map.begin(); it != collision_map.next_free_slot(); it += 1)
+            // the editor may have added or removed colliders since
+            collider_spans[0].end = collision_map.next_free_slot();
+            for (usize span = 0; span < collider_span_count; span += 1)
+            for (Collider* it = collider_spans[span].begin; it != collider_spans[span].end; it += 1)
             {
                 //Collider_print(it);
                 
@@ -2937,16 +3062,15 @@ int main(int argc, char* argv[])
                         you.on_ground = false;
 
                         // temp move this
-                        // send data args as pointer to pre-allocated buffer
-                        AudioCommand* cmd = (AudioCommand*)xmalloc(sizeof(*cmd));
-                        cmd->type = AUDIO_COMMAND_TYPE::DELAY;
+                        AudioCommand* cmd = AudioCommand_alloc(&audio_args);
+                        if (cmd != nullptr) {
+                            cmd->type = AUDIO_COMMAND_TYPE::DELAY;
 
-                        cmd->delay.decay = 0.4;
-                        cmd->delay.channel_a_offset_percent = 0.0;
-                        cmd->delay.channel_b_offset_percent = 0.05;
+                            cmd->delay.decay = 0.4;
+                            cmd->delay.channel_a_offset_percent = 0.0;
+                            cmd->delay.channel_b_offset_percent = 0.05;
 
-                        if (ck_ring_enqueue_spsc(&audio_args.fifo.ring, audio_args.fifo.buffer, (void*)cmd) == false) {
-                            fprintf(stderr, "ERROR: OUT OF AUDIO QUEUE SPACE\n");
+                            AudioCommand_send(&audio_args, cmd);
                         }
                     } else {
                         you.velocity_air = Vec3(0.0);
@@ -2991,7 +3115,8 @@ int main(int argc, char* argv[])
 
             drawctx.end();
 
-            glDisable(GL_BLEND);
+            render_ctx.blend = false;
+            gl_set_blend(false);
 
             // if (collision_map.count > 0) {
             //     printf("{");
@@ -3007,9 +3132,12 @@ int main(int argc, char* argv[])
             //existing.render(&existing);
             //in_prog.transform_matrix = FreeCamera_calc_view_matrix(&main_cam);
             //in_prog.render(&in_prog);
-            sd::batch_render(&in_prog);
         }
 
+        sd::Render_Context_execute(&render_ctx);
+
+        sd::batch_render(&in_prog);
+        sd::batch_render(&in_prog_shapes);
         //drawctx.transform_matrix = FreeCamera_calc_view_matrix(&main_cam);
         //drawctx.render(&drawctx);
         sd::batch_render(&drawctx);
@@ -3018,6 +3146,8 @@ int main(int argc, char* argv[])
 
         SDL_GL_SwapWindow(window);
 
+        gl_state_frame_end();
+
         #ifdef FPS_COUNT
         frame_count += 1;
         if (t_now_s - frame_time > 1.0) {
@@ -3025,6 +3155,7 @@ int main(int argc, char* argv[])
             frame_count = 0;
             frame_time = t_now_s;
             printf("%f\n", (double)fps);
+            printf("GL STATE CALLS: issued %u, elided %u\n", gl_state.issued_last_frame, gl_state.elided_last_frame);
         }
         #endif
     //////////////////
@@ -3039,15 +3170,29 @@ int main(int argc, char* argv[])
     
     VertexAttributeArray_delete(&vao_2d2);
     VertexBufferData_delete_inplace(&tri_data);
+    // the loader may still point into bg_layers
+    Texture_Loader_free(&texture_loader);
+    Parallax_Layers_free(&bg_layers);
     #ifdef SD
     sd::free(&drawctx);
+    sd::unit_polygon_cache_free();
+    if (world_streaming) {
+        World_free(&world);
+    }
     #endif
     #ifdef EDITOR
     sd::free(&in_prog);
-    sd::free(&existing);
+    sd::free(&in_prog_shapes);
+    sd::Static_Mesh_free(&existing);
+    gl_state_forget_program(shader_grid);
     glDeleteProgram(shader_grid);
     #endif
+    gl_state_forget_program(shader_2d);
     glDeleteProgram(shader_2d);
+    Frame_Uniform_Buffer_delete(&frame_ubo);
+    #ifdef SHADER_HOT_RELOAD
+    Shader_hot_reload_shutdown();
+    #endif
 
     SDL_GL_DeleteContext(program_data.context);
     SDL_DestroyWindow(window);
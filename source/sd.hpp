@@ -49,6 +49,10 @@ enum struct BATCH_TYPE {
 
 }
 
+#ifdef SD_IMPLEMENTATION
+#define SD_NULL_IMPLEMENTATION
+#endif
+
 #if defined(SD_RENDERER_VULKAN)
     #error VULKAN RENDERER NOT IMPLEMENTED
 #elif defined(SD_RENDERER_OPENGL)
@@ -57,4 +61,7 @@ enum struct BATCH_TYPE {
     #error SD RENDERER NOT DEFINED
 #endif
 
+// recording batches that build next to the selected backend
+#include "sd_null.hpp"
+
 #endif // SD_HPP
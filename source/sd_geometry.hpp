@@ -0,0 +1,787 @@
+#ifndef SD_GEOMETRY_HPP
+#define SD_GEOMETRY_HPP
+
+#if !(UNITY_BUILD)
+#include "common_utils_cpp.hpp"
+
+#include "opengl.hpp"
+#include "sdl.hpp"
+#endif
+
+// the backend-independent part of strato-draw: vertex layouts, the CPU-side geometry
+// that fills a Render_Batch's buffers, culling bounds and the threaded builder,
+// each backend defines Render_Batch itself and includes this first
+namespace sd {
+
+template <usize SD_RENDER_BATCH_SIZE> struct Render_Batch;
+
+struct Vertex_Default {
+    Vec3 position;
+    Vec4 color;
+};
+typedef Vertex_Default Vertex;
+
+struct Vertex_Textured {
+    Vec3 position;
+    Vec4 color;
+    Vec2 uv;
+};
+typedef Vertex_Textured Vertex_Tex;
+
+struct Vertex_LineSegment {
+    Vec4 segment;
+    Vec4 color;
+    float32 z_layer;
+};
+typedef Vertex_LineSegment Vertex_LS;
+
+static constexpr GLenum TRIANGLES = GL_TRIANGLES;
+static constexpr GLenum LINES     = GL_LINES;
+
+struct Shader_Vertex {
+    Vec3_ua position;
+    Vec4_ua color;
+    Vec2_ua uv;
+};
+
+#define SD_UNIT_POLYGON_PREPARED_SIDES (64)
+
+// unit-radius regular polygons, (cos, sin) pairs per point,
+// computed once per side count on first use
+struct Unit_Polygon_Cache {
+    // up to SD_UNIT_POLYGON_PREPARED_SIDES, published once and read without the lock
+    GLfloat* prepared[SD_UNIT_POLYGON_PREPARED_SIDES + 1];
+    // larger side counts, grown and looked up under the lock
+    GLfloat** tables;
+    usize     cap;
+    SDL_SpinLock lock;
+};
+
+extern Unit_Polygon_Cache unit_polygon_cache;
+
+// safe from any thread, misses and side counts above SD_UNIT_POLYGON_PREPARED_SIDES take a lock,
+// tables stay valid until unit_polygon_cache_free, nullptr for fewer than 3 sides
+const GLfloat* unit_polygon(const usize count_sides);
+// creates the tables up to max_sides ahead of time
+void unit_polygon_cache_prepare(const usize max_sides);
+void unit_polygon_cache_free(void);
+
+// bounds of a run of CULL_CHUNK_INDICES indices in the batch's untransformed space,
+// whole off-screen runs are skipped without looking at each primitive
+struct Cull_Chunk {
+    Vec2 min;
+    Vec2 max;
+};
+
+// a multiple of 2 and 3 so no line or triangle straddles two chunks
+static constexpr usize CULL_CHUNK_INDICES = 384;
+
+// recomputes the bounds of the chunks from the one containing index bounded up to the end of the buffer,
+// returns the new bounded count
+usize cull_chunks_update(Cull_Chunk* chunks, const VertexBufferData* vbd, const usize attribute_stride, const usize bounded);
+
+// walks the runs of consecutive visible chunks in the indices [begin, end)
+struct Cull_Run_Iterator {
+    const Cull_Chunk* chunks;
+    usize i;
+    usize end;
+    Vec2  view_min;
+    Vec2  view_max;
+};
+
+inline Cull_Run_Iterator cull_runs(const Cull_Chunk* chunks, const usize begin, const usize end, const Vec2 view_min, const Vec2 view_max)
+{
+    return Cull_Run_Iterator{chunks, begin, end, view_min, view_max};
+}
+// returns false once there are no more visible runs
+bool cull_runs_next(Cull_Run_Iterator* it, usize* run_begin, usize* run_end);
+
+// builds geometry on worker threads, each filling its own CPU-only Render_Batch
+// through the usual sd::line / sd::circle / sd::vertex calls,
+// the main thread then appends the results into a GL batch with sd::append.
+// meant for bulk geometry, the frame loop only draws a few debug lines per frame
+// (level lines are baked into static meshes) and still builds them on the main thread
+template <usize SD_RENDER_BATCH_SIZE = 2048>
+struct Render_Batch_Builder {
+    static constexpr usize MAX_WORKERS = 16;
+
+    // called once per worker per build
+    typedef void (*Proc)(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* batch, usize worker_index, usize count_workers, void* data);
+
+    struct Worker {
+        SDL_Thread*                            thread;
+        SDL_sem*                               start;
+        sd::Render_Batch<SD_RENDER_BATCH_SIZE>* batch;
+        Render_Batch_Builder*                  builder;
+        usize                                  index;
+    };
+
+    Worker   workers[MAX_WORKERS];
+    usize    count_workers;
+    SDL_sem* done;
+
+    Proc  proc;
+    void* data;
+    bool  running;
+};
+
+
+template<usize SD_RENDER_BATCH_SIZE> bool line(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec3 a, Vec3 b);
+template<usize SD_RENDER_BATCH_SIZE> bool line(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec2 a, Vec2 b);
+template<usize SD_RENDER_BATCH_SIZE> bool remove_line_swap_end(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, usize idx);
+template<usize SD_RENDER_BATCH_SIZE> bool quad(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec3, Vec3, Vec3, Vec3);
+template<usize SD_RENDER_BATCH_SIZE> bool quad(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec2, Vec2, Vec2, Vec2);
+template<usize SD_RENDER_BATCH_SIZE> bool polygon_convex_regular(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, GLfloat radius, Vec3 center, const usize count_sides);
+template<usize SD_RENDER_BATCH_SIZE> bool polygon_convex_regular(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, GLfloat radius, Vec2 center, const usize count_sides);
+template<usize SD_RENDER_BATCH_SIZE> bool circle(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, GLfloat radius, Vec3 center, usize detail = 37);
+template<usize SD_RENDER_BATCH_SIZE> bool circle(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, GLfloat radius, Vec2 center, usize detail = 37);
+template<usize SD_RENDER_BATCH_SIZE> bool vertex(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec3 v);
+template<usize SD_RENDER_BATCH_SIZE> bool vertex(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec2 v);
+// template<usize SD_RENDER_BATCH_SIZE, usize N> bool polygon(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Buffer<Vec3, N>* vs);
+// template<usize SD_RENDER_BATCH_SIZE, usize N> bool polygon(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Buffer<Vec2, N>* vs);
+// template<usize SD_RENDER_BATCH_SIZE> bool polygon(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, DynamicBuffer<Vec3>* vs);
+// template<usize SD_RENDER_BATCH_SIZE> bool polygon(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, DynamicBuffer<Vec2>* vs);
+template<usize SD_RENDER_BATCH_SIZE> bool polygon(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec3* vs, const usize count);
+template<usize SD_RENDER_BATCH_SIZE> bool polygon(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec2* vs, const usize count);
+template<usize SD_RENDER_BATCH_SIZE> bool polygon(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Array_Slice<Vec3> slice);
+template<usize SD_RENDER_BATCH_SIZE> bool polygon(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Array_Slice<Vec2>* slice);
+
+template<usize SD_RENDER_BATCH_SIZE> inline void color(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec4 color);
+template<usize SD_RENDER_BATCH_SIZE> inline void push_context(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx);
+
+// subsequent submissions are culled against the rectangle, given in the batch's untransformed space
+template<usize SD_RENDER_BATCH_SIZE> inline void cull_rect_set(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec2 min, Vec2 max);
+
+// sets up the CPU-side buffers only, no GL objects are created
+template<usize SD_RENDER_BATCH_SIZE> void cpu_init(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx);
+// copies the geometry of src to the end of dst, rebasing the indices
+template<usize SD_RENDER_BATCH_SIZE, usize SD_RENDER_BATCH_SIZE_SRC> bool append(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* dst, const sd::Render_Batch<SD_RENDER_BATCH_SIZE_SRC>* src);
+
+template<usize SD_RENDER_BATCH_SIZE> bool Render_Batch_Builder_init(sd::Render_Batch_Builder<SD_RENDER_BATCH_SIZE>* builder, usize count_workers);
+// runs proc on every worker and waits for all of them, the worker batches are reset first
+template<usize SD_RENDER_BATCH_SIZE> void Render_Batch_Builder_build(sd::Render_Batch_Builder<SD_RENDER_BATCH_SIZE>* builder, typename sd::Render_Batch_Builder<SD_RENDER_BATCH_SIZE>::Proc proc, void* data);
+// appends the worker batches into dst in worker order, main thread only
+template<usize SD_RENDER_BATCH_SIZE, usize SD_RENDER_BATCH_SIZE_DST> bool Render_Batch_Builder_merge(sd::Render_Batch_Builder<SD_RENDER_BATCH_SIZE>* builder, sd::Render_Batch<SD_RENDER_BATCH_SIZE_DST>* dst);
+template<usize SD_RENDER_BATCH_SIZE> void Render_Batch_Builder_free(sd::Render_Batch_Builder<SD_RENDER_BATCH_SIZE>* builder);
+
+}
+
+#endif // SD_GEOMETRY_HPP
+
+#ifdef SD_GEOMETRY_IMPLEMENTATION
+#undef SD_GEOMETRY_IMPLEMENTATION
+
+namespace sd {
+
+Unit_Polygon_Cache unit_polygon_cache = {};
+
+static GLfloat* unit_polygon_make(const usize count_sides)
+{
+    GLfloat* table = (GLfloat*)xmalloc(count_sides * 2 * sizeof(GLfloat));
+    const GLdouble angle_turn = -(TAU) / count_sides;
+    for (usize p = 0; p < count_sides; ++p) {
+        table[2 * p]     = glm::cos(p * angle_turn);
+        table[2 * p + 1] = glm::sin(p * angle_turn);
+    }
+    return table;
+}
+
+const GLfloat* unit_polygon(const usize count_sides)
+{
+    if (count_sides < 3) {
+        SD_LOG_ERR("%s\n", "ERROR: unit_polygon FEWER THAN 3 SIDES");
+        return nullptr;
+    }
+
+    Unit_Polygon_Cache* cache = &unit_polygon_cache;
+
+    if (count_sides <= SD_UNIT_POLYGON_PREPARED_SIDES) {
+        GLfloat* table = (GLfloat*)SDL_AtomicGetPtr((void**)&cache->prepared[count_sides]);
+        if (table != nullptr) {
+            return table;
+        }
+    }
+
+    SDL_AtomicLock(&cache->lock);
+
+    GLfloat* table;
+    if (count_sides <= SD_UNIT_POLYGON_PREPARED_SIDES) {
+        // another thread may have published it since
+        table = cache->prepared[count_sides];
+        if (table == nullptr) {
+            table = unit_polygon_make(count_sides);
+            SDL_AtomicSetPtr((void**)&cache->prepared[count_sides], table);
+        }
+    } else {
+        if (count_sides >= cache->cap) {
+            usize cap = (cache->cap == 0) ? 128 : cache->cap;
+            while (cap <= count_sides) {
+                cap *= 2;
+            }
+            cache->tables = (GLfloat**)xrealloc(cache->tables, cap * sizeof(GLfloat*));
+            memset(cache->tables + cache->cap, 0x00, (cap - cache->cap) * sizeof(GLfloat*));
+            cache->cap = cap;
+        }
+
+        table = cache->tables[count_sides];
+        if (table == nullptr) {
+            table = unit_polygon_make(count_sides);
+            cache->tables[count_sides] = table;
+        }
+    }
+
+    SDL_AtomicUnlock(&cache->lock);
+
+    return table;
+}
+
+usize cull_chunks_update(Cull_Chunk* chunks, const VertexBufferData* vbd, const usize attribute_stride, const usize bounded)
+{
+    const usize count = vbd->i_count;
+
+    // the chunk containing bounded may be partially stale, start over from its first index
+    for (usize i = (bounded / CULL_CHUNK_INDICES) * CULL_CHUNK_INDICES; i < count; ++i) {
+        const GLfloat* v = &vbd->vertices[vbd->indices[i] * attribute_stride];
+        const Vec2 p(v[0], v[1]);
+
+        Cull_Chunk* chunk = &chunks[i / CULL_CHUNK_INDICES];
+        if (i % CULL_CHUNK_INDICES == 0) {
+            chunk->min = p;
+            chunk->max = p;
+        } else {
+            chunk->min = glm::min(chunk->min, p);
+            chunk->max = glm::max(chunk->max, p);
+        }
+    }
+
+    return count;
+}
+
+bool cull_runs_next(Cull_Run_Iterator* it, usize* run_begin, usize* run_end)
+{
+    bool in_run = false;
+
+    while (it->i < it->end) {
+        const Cull_Chunk* chunk = &it->chunks[it->i / CULL_CHUNK_INDICES];
+        const usize chunk_end = glm::min(((it->i / CULL_CHUNK_INDICES) + 1) * CULL_CHUNK_INDICES, it->end);
+
+        const bool visible =
+            chunk->max.x >= it->view_min.x && chunk->min.x <= it->view_max.x &&
+            chunk->max.y >= it->view_min.y && chunk->min.y <= it->view_max.y;
+
+        if (visible && !in_run) {
+            *run_begin = it->i;
+            in_run     = true;
+        } else if (!visible && in_run) {
+            *run_end = it->i;
+            return true;
+        }
+
+        it->i = chunk_end;
+    }
+
+    if (in_run) {
+        *run_end = it->end;
+        return true;
+    }
+
+    return false;
+}
+
+void unit_polygon_cache_prepare(const usize max_sides)
+{
+    for (usize sides = 3; sides <= max_sides; ++sides) {
+        sd::unit_polygon(sides);
+    }
+}
+
+void unit_polygon_cache_free(void)
+{
+    Unit_Polygon_Cache* cache = &unit_polygon_cache;
+    foreach (i, StaticArrayCount(cache->prepared)) {
+        ::free(cache->prepared[i]);
+        cache->prepared[i] = nullptr;
+    }
+    foreach (i, cache->cap) {
+        ::free(cache->tables[i]);
+    }
+    ::free(cache->tables);
+    cache->tables = nullptr;
+    cache->cap    = 0;
+}
+
+template<usize SD_RENDER_BATCH_SIZE> bool line(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec3 a, Vec3 b)
+{
+    const usize v_count = ctx->line_buffer.v_count;
+    const usize i_count = ctx->line_buffer.i_count;
+
+    const usize attribute_stride = ctx->vao_lines.stride;
+
+    if (v_count + (2 * attribute_stride) > (SD_RENDER_BATCH_SIZE * attribute_stride) || (i_count + 2 > SD_RENDER_BATCH_SIZE * 2)) {
+        SD_LOG_ERR("%s\n", "ERROR: add_line_segment MAX LINES EXCEEDED");
+        return false;
+    }
+
+    const usize v_idx = v_count;
+
+    // memcpy(&ctx->vertices_lines[v_idx], &a[0], sizeof(a[0]) * 3);
+    // memcpy(&ctx->vertices_lines[v_idx + 3], &ctx->color[0], sizeof(ctx->color[0]) * 4);
+
+    ctx->vertices_lines[v_idx]     = a.x;
+    ctx->vertices_lines[v_idx + 1] = a.y;
+    ctx->vertices_lines[v_idx + 2] = a.z;
+    ctx->vertices_lines[v_idx + 3] = ctx->color[0];
+    ctx->vertices_lines[v_idx + 4] = ctx->color[1];
+    ctx->vertices_lines[v_idx + 5] = ctx->color[2];
+    ctx->vertices_lines[v_idx + 6] = ctx->color[3];
+
+
+
+    // memcpy(&ctx->vertices_lines[v_idx + attribute_stride], &b[0], sizeof(b[0]) * 3);
+    // memcpy(&ctx->vertices_lines[v_idx + attribute_stride + 3], &ctx->color[0], sizeof(ctx->color[0]) * 4);
+
+
+    ctx->vertices_lines[v_idx + attribute_stride]     = b.x;
+    ctx->vertices_lines[v_idx + 1 + attribute_stride] = b.y;
+    ctx->vertices_lines[v_idx + 2 + attribute_stride] = b.z;
+    ctx->vertices_lines[v_idx + 3 + attribute_stride] = ctx->color[0];
+    ctx->vertices_lines[v_idx + 4 + attribute_stride] = ctx->color[1];
+    ctx->vertices_lines[v_idx + 5 + attribute_stride] = ctx->color[2];
+    ctx->vertices_lines[v_idx + 6 + attribute_stride] = ctx->color[3];
+
+    ctx->indices_lines[i_count]     = ctx->index_lines;
+    ctx->indices_lines[i_count + 1] = ctx->index_lines + 1;
+    ctx->index_lines += 2;
+
+    ctx->line_buffer.v_count += (2 * attribute_stride);
+    ctx->line_buffer.i_count += 2;
+
+    return true;
+}
+
+template<usize SD_RENDER_BATCH_SIZE> bool line(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec2 a, Vec2 b)
+{
+    return sd::line(ctx, Vec3(a, 1), Vec3(b, 1));
+}
+
+template<usize SD_RENDER_BATCH_SIZE> bool remove_line_swap_end(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, usize idx)
+{
+    const usize attribute_stride = ctx->vao_lines.stride;
+
+#ifdef SD_BOUNDS_CHECK
+    if ((idx * (2 * attribute_stride) > (SD_RENDER_BATCH_SIZE * attribute_stride)) || (idx * 2 > SD_RENDER_BATCH_SIZE * 2)) {
+        SD_LOG_ERR("%s\n", "ERROR: remove_line INDEX OUT-OF-BOUNDS");
+        return false;           
+    }
+#endif
+
+    // reduce counts
+    ctx->line_buffer.v_count -= (2 * attribute_stride);
+    ctx->line_buffer.i_count -= 2;
+
+    // overwrite the element-to-delete with the last element
+    memcpy(&ctx->vertices_lines[(2 * attribute_stride) * idx], &ctx->vertices_lines[ctx->line_buffer.v_count], sizeof(GLfloat) * 2 * attribute_stride);
+
+    // the moved segment's chunk is re-bounded on the next submission
+    ctx->line_bounded = glm::min(ctx->line_bounded, (usize)(idx * 2));
+
+    // move the line index back by 2 (for each point in the segment)
+    ctx->index_lines -= 2;
+
+    return true;
+}
+
+template<usize SD_RENDER_BATCH_SIZE> bool polygon_convex_regular(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, GLfloat radius, Vec3 center, const usize count_sides)
+{
+    if (count_sides < 3) {
+        SD_LOG_ERR("%s\n", "ERROR: polygon_convex_regular FEWER THAN 3 SIDES");
+        return false;
+    }
+
+    usize count_tris = count_sides - 2;
+
+    usize attribute_stride;
+    usize inc;
+
+    usize v_count = 0;
+    usize i_count = 0;
+    usize v_idx   = 0;
+    const GLfloat* unit = sd::unit_polygon(count_sides);
+
+    switch (ctx->draw_type) {
+    case GL_TRIANGLES:
+        attribute_stride = ctx->vao_triangles.stride;
+        inc = attribute_stride;
+
+        v_count = ctx->triangle_buffer.v_count;
+        i_count = ctx->triangle_buffer.i_count;
+        v_idx = v_count;
+#ifdef SD_BOUNDS_CHECK
+        if (v_count + (attribute_stride * count_sides) > SD_RENDER_BATCH_SIZE * attribute_stride || i_count + (3 * count_tris) > SD_RENDER_BATCH_SIZE * 2) {
+            SD_LOG_ERR("%s\n", "ERROR: polygon_convex_regular MAX TRIANGLES EXCEEDED");
+            return false;
+        }
+#endif
+
+        for (usize p = 0, idx_off = 0; p < count_tris; ++p, idx_off += 3) {
+            ctx->indices_triangles[i_count + idx_off]     = ctx->index_triangles + 0;
+            ctx->indices_triangles[i_count + idx_off + 1] = ctx->index_triangles + p + 1;
+            ctx->indices_triangles[i_count + idx_off + 2] = ctx->index_triangles + p + 2;
+        }
+        ctx->triangle_buffer.i_count += (3 * count_tris);
+
+
+        for (usize p = 0, off = 0; p < count_sides; ++p, off += inc) {
+            ctx->vertices_triangles[v_idx + off]     = (radius * unit[2 * p])     + center.x;
+            ctx->vertices_triangles[v_idx + off + 1] = (radius * unit[2 * p + 1]) + center.y;
+            ctx->vertices_triangles[v_idx + off + 2] = center.z;
+
+            memcpy(&ctx->vertices_triangles[v_idx + off + 3], &ctx->color[0], sizeof(ctx->color[0]) * 4);
+        }
+
+        ctx->triangle_buffer.v_count += (attribute_stride * count_sides);
+
+        ctx->index_triangles += count_sides;
+
+        break;
+    case GL_LINES:
+        attribute_stride = ctx->vao_lines.stride;
+        inc = attribute_stride;
+
+        v_count = ctx->line_buffer.v_count;
+        i_count = ctx->line_buffer.i_count;
+        v_idx = v_count;
+#ifdef SD_BOUNDS_CHECK
+        if (v_count + (attribute_stride * count_sides) > SD_RENDER_BATCH_SIZE * attribute_stride || i_count + (2 * count_sides) > SD_RENDER_BATCH_SIZE * 2) {
+            SD_LOG_ERR("%s\n", "ERROR: polygon_convex_regular MAX LINES EXCEEDED");
+            return false;
+        }
+#endif
+
+        for (usize p = 0, off = 0; p < count_sides; ++p, off += 2) {
+            ctx->indices_lines[i_count + off]     = ctx->index_lines + p;
+            ctx->indices_lines[i_count + off + 1] = ctx->index_lines + p + 1;
+        }
+        ctx->indices_lines[i_count + (count_sides * 2) - 1] = ctx->index_lines;
+
+        ctx->line_buffer.i_count += (2 * count_sides);
+
+        for (usize p = 0, off = 0; p < count_sides; ++p, off += inc) {
+            ctx->vertices_lines[v_idx + off]     = (radius * unit[2 * p])     + center.x;
+            ctx->vertices_lines[v_idx + off + 1] = (radius * unit[2 * p + 1]) + center.y;
+            ctx->vertices_lines[v_idx + off + 2] = center.z;
+
+            memcpy(&ctx->vertices_lines[v_idx + off + 3], &ctx->color[0], sizeof(ctx->color[0]) * 4);
+        }
+
+        ctx->line_buffer.v_count += (attribute_stride * count_sides);          
+
+        ctx->index_lines += count_sides; 
+
+        break;
+    }
+
+    return true;
+}
+
+template<usize SD_RENDER_BATCH_SIZE> bool polygon_convex_regular(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, GLfloat radius, Vec2 center, const usize count_sides)
+{
+    return sd::polygon_convex_regular(ctx, radius, Vec3(center, 1.0), count_sides);
+}
+
+template<usize SD_RENDER_BATCH_SIZE> bool circle(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, GLfloat radius, Vec3 center, usize detail)
+{
+    return sd::polygon_convex_regular(ctx, radius, center, detail);
+}
+
+template<usize SD_RENDER_BATCH_SIZE> bool circle(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, GLfloat radius, Vec2 center, usize detail)
+{
+    return sd::polygon_convex_regular(ctx, radius, center, detail);
+}
+
+template<usize SD_RENDER_BATCH_SIZE> bool vertex(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec3 v)
+{
+    usize v_count = 0;
+    usize i_count = 0;
+    usize v_idx = 0;
+
+    usize attribute_stride;
+
+    switch (ctx->draw_type) {
+    case GL_TRIANGLES:
+        attribute_stride = ctx->vao_triangles.stride;
+
+        v_count = ctx->triangle_buffer.v_count;
+        i_count = ctx->triangle_buffer.i_count;
+        v_idx = v_count;
+#ifdef SD_BOUNDS_CHECK
+        if (v_count + attribute_stride > SD_RENDER_BATCH_SIZE * attribute_stride || i_count + 1 > SD_RENDER_BATCH_SIZE * 2) {
+            SD_LOG_ERR("%s\n", "ERROR: vertex MAX TRIANGLES EXCEEDED");
+            return false;
+        }
+#endif
+
+        memcpy(&ctx->vertices_triangles[v_idx], &v[0], sizeof(v[0]) * 3);
+        memcpy(&ctx->vertices_triangles[v_idx + 3], &ctx->color[0], sizeof(ctx->color[0]) * 4);
+
+        ctx->indices_triangles[i_count] = ctx->index_triangles;
+        ctx->index_triangles += 1;
+
+        ctx->triangle_buffer.v_count += attribute_stride;
+        ctx->triangle_buffer.i_count += 1;
+
+        break;
+    case GL_LINES:
+        attribute_stride = ctx->vao_lines.stride;
+
+        v_count = ctx->line_buffer.v_count;
+        i_count = ctx->line_buffer.i_count;
+        v_idx = v_count;
+#ifdef SD_BOUNDS_CHECK
+        if (v_count + attribute_stride > SD_RENDER_BATCH_SIZE * attribute_stride || i_count + 1 > SD_RENDER_BATCH_SIZE * 2) {
+            SD_LOG_ERR("%s\n", "ERROR: vertex MAX LINES EXCEEDED");
+            return false;
+        }
+#endif
+
+        memcpy(&ctx->vertices_lines[v_idx], &v[0], sizeof(v[0]) * 3);
+        memcpy(&ctx->vertices_lines[v_idx + 3], &ctx->color[0], sizeof(ctx->color[0]) * 4);
+
+        ctx->indices_lines[i_count] = ctx->index_lines;
+        ctx->index_lines += 1;
+
+        ctx->line_buffer.v_count += attribute_stride;
+        ctx->line_buffer.i_count += 1;
+
+        break;
+    }
+
+    return true;      
+}
+
+template<usize SD_RENDER_BATCH_SIZE> bool vertex(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec2 v)
+{
+    return sd::vertex(ctx, Vec3(v, 1.0));
+}
+
+template<usize SD_RENDER_BATCH_SIZE> inline void color(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec4 color)
+{
+    ctx->color = color;
+}
+
+template<usize SD_RENDER_BATCH_SIZE> inline void push_context(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx)
+{
+    // TODO
+}
+
+template<usize SD_RENDER_BATCH_SIZE> inline void cull_rect_set(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec2 min, Vec2 max)
+{
+    ctx->cull     = true;
+    ctx->cull_min = min;
+    ctx->cull_max = max;
+}
+
+template<usize SD_RENDER_BATCH_SIZE> void cpu_init(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx)
+{
+    const usize attribute_stride = sd::Render_Batch<SD_RENDER_BATCH_SIZE>::DEFAULT_ATTRIBUTE_STRIDE;
+
+    ctx->begun = false;
+
+    ctx->render_context = nullptr;
+    ctx->triangle_begin = 0;
+    ctx->line_begin     = 0;
+
+    ctx->triangle_bounded = 0;
+    ctx->line_bounded     = 0;
+    ctx->cull = false;
+
+    ctx->draw_type = GL_TRIANGLES;
+    ctx->color = Vec4{0.0f, 0.0f, 0.0f, 1.0f};
+    ctx->transform_matrix = Mat4(1.0f);
+
+    ctx->vao_triangles.vao    = 0;
+    ctx->vao_triangles.stride = attribute_stride;
+    ctx->vao_lines.vao        = 0;
+    ctx->vao_lines.stride     = attribute_stride;
+
+    VertexBufferData* buffers[2] = {&ctx->triangle_buffer, &ctx->line_buffer};
+    GLfloat* vertices[2] = {ctx->vertices_triangles, ctx->vertices_lines};
+    GLuint* indices[2]   = {ctx->indices_triangles, ctx->indices_lines};
+    foreach (i, 2) {
+        buffers[i]->vbo      = 0;
+        buffers[i]->ebo      = 0;
+        buffers[i]->v_cap    = SD_RENDER_BATCH_SIZE * attribute_stride;
+        buffers[i]->v_count  = 0;
+        buffers[i]->vertices = vertices[i];
+        buffers[i]->i_cap    = SD_RENDER_BATCH_SIZE;
+        buffers[i]->i_count  = 0;
+        buffers[i]->indices  = indices[i];
+    }
+
+    ctx->index_triangles = 0;
+    ctx->index_lines     = 0;
+}
+
+template<usize SD_RENDER_BATCH_SIZE, usize SD_RENDER_BATCH_SIZE_SRC> bool append(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* dst, const sd::Render_Batch<SD_RENDER_BATCH_SIZE_SRC>* src)
+{
+    const usize attribute_stride = sd::Render_Batch<SD_RENDER_BATCH_SIZE>::DEFAULT_ATTRIBUTE_STRIDE;
+
+    const usize tri_v_count  = src->triangle_buffer.v_count;
+    const usize tri_i_count  = src->triangle_buffer.i_count;
+    const usize line_v_count = src->line_buffer.v_count;
+    const usize line_i_count = src->line_buffer.i_count;
+
+    if (dst->triangle_buffer.v_count + tri_v_count > SD_RENDER_BATCH_SIZE * attribute_stride || dst->triangle_buffer.i_count + tri_i_count > SD_RENDER_BATCH_SIZE * 2) {
+        SD_LOG_ERR("%s\n", "ERROR: append MAX TRIANGLES EXCEEDED");
+        return false;
+    }
+    if (dst->line_buffer.v_count + line_v_count > SD_RENDER_BATCH_SIZE * attribute_stride || dst->line_buffer.i_count + line_i_count > SD_RENDER_BATCH_SIZE * 2) {
+        SD_LOG_ERR("%s\n", "ERROR: append MAX LINES EXCEEDED");
+        return false;
+    }
+
+    memcpy(&dst->vertices_triangles[dst->triangle_buffer.v_count], src->vertices_triangles, tri_v_count * sizeof(GLfloat));
+    {
+        GLuint* out = &dst->indices_triangles[dst->triangle_buffer.i_count];
+        const GLuint base = dst->index_triangles;
+        foreach (i, tri_i_count) {
+            out[i] = src->indices_triangles[i] + base;
+        }
+    }
+    dst->triangle_buffer.v_count += tri_v_count;
+    dst->triangle_buffer.i_count += tri_i_count;
+    dst->index_triangles         += src->index_triangles;
+
+    memcpy(&dst->vertices_lines[dst->line_buffer.v_count], src->vertices_lines, line_v_count * sizeof(GLfloat));
+    {
+        GLuint* out = &dst->indices_lines[dst->line_buffer.i_count];
+        const GLuint base = dst->index_lines;
+        foreach (i, line_i_count) {
+            out[i] = src->indices_lines[i] + base;
+        }
+    }
+    dst->line_buffer.v_count += line_v_count;
+    dst->line_buffer.i_count += line_i_count;
+    dst->index_lines         += src->index_lines;
+
+    return true;
+}
+
+template<usize SD_RENDER_BATCH_SIZE> static int SDLCALL Render_Batch_Builder_worker_proc(void* arg)
+{
+    auto* worker  = (typename sd::Render_Batch_Builder<SD_RENDER_BATCH_SIZE>::Worker*)arg;
+    auto* builder = worker->builder;
+
+    for (;;) {
+        SDL_SemWait(worker->start);
+        if (builder->running == false) {
+            break;
+        }
+
+        builder->proc(worker->batch, worker->index, builder->count_workers, builder->data);
+
+        SDL_SemPost(builder->done);
+    }
+
+    return 0;
+}
+
+template<usize SD_RENDER_BATCH_SIZE> bool Render_Batch_Builder_init(sd::Render_Batch_Builder<SD_RENDER_BATCH_SIZE>* builder, usize count_workers)
+{
+    typedef sd::Render_Batch_Builder<SD_RENDER_BATCH_SIZE> Builder;
+
+    if (count_workers == 0) {
+        count_workers = 1;
+    } else if (count_workers > Builder::MAX_WORKERS) {
+        count_workers = Builder::MAX_WORKERS;
+    }
+
+    // the common side counts are then read by the workers without the lock
+    sd::unit_polygon_cache_prepare(SD_UNIT_POLYGON_PREPARED_SIDES);
+
+    builder->count_workers = 0;
+    builder->proc    = nullptr;
+    builder->data    = nullptr;
+    builder->running = true;
+
+    builder->done = SDL_CreateSemaphore(0);
+    if (builder->done == nullptr) {
+        SD_LOG_ERR("ERROR: Render_Batch_Builder_init %s\n", SDL_GetError());
+        return false;
+    }
+
+    foreach (i, count_workers) {
+        typename Builder::Worker* worker = &builder->workers[i];
+
+        worker->builder = builder;
+        worker->index   = i;
+        worker->batch   = (sd::Render_Batch<SD_RENDER_BATCH_SIZE>*)xmalloc(sizeof(sd::Render_Batch<SD_RENDER_BATCH_SIZE>));
+        sd::cpu_init(worker->batch);
+
+        worker->start  = SDL_CreateSemaphore(0);
+        worker->thread = (worker->start == nullptr) ? nullptr :
+            SDL_CreateThread(Render_Batch_Builder_worker_proc<SD_RENDER_BATCH_SIZE>, "sd_batch_builder", (void*)worker);
+
+        if (worker->thread == nullptr) {
+            SD_LOG_ERR("ERROR: Render_Batch_Builder_init %s\n", SDL_GetError());
+            if (worker->start != nullptr) {
+                SDL_DestroySemaphore(worker->start);
+            }
+            ::free(worker->batch);
+            sd::Render_Batch_Builder_free(builder);
+            return false;
+        }
+
+        builder->count_workers += 1;
+    }
+
+    return true;
+}
+
+template<usize SD_RENDER_BATCH_SIZE> void Render_Batch_Builder_build(sd::Render_Batch_Builder<SD_RENDER_BATCH_SIZE>* builder, typename sd::Render_Batch_Builder<SD_RENDER_BATCH_SIZE>::Proc proc, void* data)
+{
+    builder->proc = proc;
+    builder->data = data;
+
+    foreach (i, builder->count_workers) {
+        builder->workers[i].batch->reset(builder->workers[i].batch);
+        SDL_SemPost(builder->workers[i].start);
+    }
+    foreach (i, builder->count_workers) {
+        SDL_SemWait(builder->done);
+    }
+}
+
+template<usize SD_RENDER_BATCH_SIZE, usize SD_RENDER_BATCH_SIZE_DST> bool Render_Batch_Builder_merge(sd::Render_Batch_Builder<SD_RENDER_BATCH_SIZE>* builder, sd::Render_Batch<SD_RENDER_BATCH_SIZE_DST>* dst)
+{
+    foreach (i, builder->count_workers) {
+        if (sd::append(dst, builder->workers[i].batch) == false) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template<usize SD_RENDER_BATCH_SIZE> void Render_Batch_Builder_free(sd::Render_Batch_Builder<SD_RENDER_BATCH_SIZE>* builder)
+{
+    builder->running = false;
+
+    foreach (i, builder->count_workers) {
+        SDL_SemPost(builder->workers[i].start);
+    }
+    foreach (i, builder->count_workers) {
+        SDL_WaitThread(builder->workers[i].thread, nullptr);
+        SDL_DestroySemaphore(builder->workers[i].start);
+        ::free(builder->workers[i].batch);
+    }
+
+    if (builder->done != nullptr) {
+        SDL_DestroySemaphore(builder->done);
+    }
+    builder->count_workers = 0;
+}
+
+}
+
+#endif
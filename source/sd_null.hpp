@@ -0,0 +1,188 @@
+#ifndef SD_NULL_HPP
+#define SD_NULL_HPP
+
+// headless strato-draw next to the GL backend: Null_Render_Batch builds its vertex and index
+// buffers with the shared geometry code and end() records the draws the GL backend would issue,
+// nothing touches a GL context, the GL headers are only needed for the types and enums
+#if !(UNITY_BUILD)
+#include "common_utils_cpp.hpp"
+
+#include "opengl.hpp"
+#include "sd.hpp"
+#endif
+
+namespace sd {
+
+// one would-be glDrawElements
+struct Null_Draw_Record {
+    GLenum primitive;
+    usize  count;
+    // buffer bytes the GL backend uploads before the draw
+    usize  vertex_bytes;
+    usize  index_bytes;
+};
+
+struct Null_Recorder {
+    static constexpr usize MAX_RECORDS = 4096;
+
+    // draws past MAX_RECORDS are only counted in the totals
+    Array<Null_Draw_Record, MAX_RECORDS> records;
+
+    usize draw_calls;
+    usize index_count;
+    usize vertex_bytes;
+    usize index_bytes;
+};
+
+extern Null_Recorder null_recorder;
+
+void Null_Recorder_reset(Null_Recorder* rec);
+void null_record_draw(const GLenum primitive, const usize count, const VertexBufferData* vbd);
+// records one draw per visible run, see sd::cull_rect_set
+void null_record_draw_culled(const GLenum primitive, const VertexBufferData* vbd, const Cull_Chunk* chunks, const Vec2 view_min, const Vec2 view_max);
+
+template <usize SD_RENDER_BATCH_SIZE = 2048>
+struct Null_Render_Batch {
+    // set up with sd::cpu_init, no GL objects are created,
+    // use the sd:: functions on it for anything the wrappers below do not cover
+    sd::Render_Batch<SD_RENDER_BATCH_SIZE> geometry;
+
+    void begin(void)
+    {
+        geometry.begin();
+    }
+
+    void record(void)
+    {
+        sd::Render_Batch<SD_RENDER_BATCH_SIZE>* g = &geometry;
+
+        if (g->triangle_buffer.i_count > 0) {
+            if (g->cull) {
+                g->triangle_bounded = cull_chunks_update(g->triangle_chunks, &g->triangle_buffer, g->vao_triangles.stride, g->triangle_bounded);
+                null_record_draw_culled(GL_TRIANGLES, &g->triangle_buffer, g->triangle_chunks, g->cull_min, g->cull_max);
+            } else {
+                null_record_draw(GL_TRIANGLES, g->triangle_buffer.i_count, &g->triangle_buffer);
+            }
+        }
+
+        if (g->line_buffer.i_count > 0) {
+            if (g->cull) {
+                g->line_bounded = cull_chunks_update(g->line_chunks, &g->line_buffer, g->vao_lines.stride, g->line_bounded);
+                null_record_draw_culled(GL_LINES, &g->line_buffer, g->line_chunks, g->cull_min, g->cull_max);
+            } else {
+                null_record_draw(GL_LINES, g->line_buffer.i_count, &g->line_buffer);
+            }
+        }
+    }
+
+    void end(void)
+    {
+        assert(geometry.begun == true);
+
+        record();
+        geometry.reset(&geometry);
+
+        geometry.begun = false;
+    }
+
+    void end_no_reset(void)
+    {
+        assert(geometry.begun == true);
+
+        record();
+
+        geometry.begun = false;
+    }
+
+    bool init(void)
+    {
+        sd::cpu_init(&geometry);
+
+        return true;
+    }
+
+    void free(void)
+    {
+    }
+
+    bool line(Vec3 a, Vec3 b)
+    {
+        return sd::line(&geometry, a, b);
+    }
+
+    bool line(Vec2 a, Vec2 b)
+    {
+        return sd::line(&geometry, a, b);
+    }
+
+    bool polygon_convex_regular(GLfloat radius, Vec3 center, const usize count_sides)
+    {
+        return sd::polygon_convex_regular(&geometry, radius, center, count_sides);
+    }
+
+    bool circle(GLfloat radius, Vec3 center, usize detail = 37)
+    {
+        return polygon_convex_regular(radius, center, detail);
+    }
+
+    bool vertex(Vec3 v)
+    {
+        return sd::vertex(&geometry, v);
+    }
+};
+
+}
+
+#endif // SD_NULL_HPP
+
+#ifdef SD_NULL_IMPLEMENTATION
+#undef SD_NULL_IMPLEMENTATION
+
+namespace sd {
+
+Null_Recorder null_recorder;
+
+void Null_Recorder_reset(Null_Recorder* rec)
+{
+    rec->records.count = 0;
+
+    rec->draw_calls   = 0;
+    rec->index_count  = 0;
+    rec->vertex_bytes = 0;
+    rec->index_bytes  = 0;
+}
+
+void null_record_draw(const GLenum primitive, const usize count, const VertexBufferData* vbd)
+{
+    Null_Recorder* rec = &null_recorder;
+
+    Null_Draw_Record record;
+    record.primitive    = primitive;
+    record.count        = count;
+    record.vertex_bytes = vbd->v_count * sizeof(GLfloat);
+    record.index_bytes  = vbd->i_count * sizeof(GLuint);
+
+    if (rec->records.count < Null_Recorder::MAX_RECORDS) {
+        rec->records.push_back(record);
+    }
+
+    rec->draw_calls   += 1;
+    rec->index_count  += count;
+    rec->vertex_bytes += record.vertex_bytes;
+    rec->index_bytes  += record.index_bytes;
+}
+
+void null_record_draw_culled(const GLenum primitive, const VertexBufferData* vbd, const Cull_Chunk* chunks, const Vec2 view_min, const Vec2 view_max)
+{
+    Cull_Run_Iterator it = cull_runs(chunks, 0, vbd->i_count, view_min, view_max);
+
+    usize run_begin;
+    usize run_end;
+    while (cull_runs_next(&it, &run_begin, &run_end)) {
+        null_record_draw(primitive, run_end - run_begin, vbd);
+    }
+}
+
+}
+
+#endif
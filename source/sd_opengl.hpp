@@ -10,6 +10,11 @@
 #include "sdl.hpp"
 #endif
 
+#ifdef SD_IMPLEMENTATION
+#define SD_GEOMETRY_IMPLEMENTATION
+#endif
+#include "sd_geometry.hpp"
+
 // strato-draw
 namespace sd {
 // inline void log(const bool log_if_false, FILE * stream, const char * format, ...)
@@ -69,35 +74,38 @@ namespace sd {
 // }
 // }
 
-struct Vertex_Default {
-    Vec3 position;
-    Vec4 color;
-};
-typedef Vertex_Default Vertex;
 
-struct Vertex_Textured {
-    Vec3 position;
-    Vec4 color;
-    Vec2 uv;
+enum struct DRAW_COMMAND_TYPE : u8 {
+    ELEMENTS,
+    ARRAYS_INSTANCED,
 };
-typedef Vertex_Textured Vertex_Tex;
 
-struct Vertex_LineSegment {
-    Vec4 segment;
-    Vec4 color;
-    float32 z_layer;
+// one deferred draw, executed by sd::Render_Context_execute
+struct Draw_Command {
+    DRAW_COMMAND_TYPE type;
+    GLuint            program;
+    VAO               vao;
+    GLenum            primitive;
+    GLsizei           count;
+    // byte offset into the element buffer, or the first vertex for instanced draws
+    usize             offset;
+    Texture           texture;
+    UniformLocation   mat_loc;
+    u32               matrix_index;
+
+    VBO               instance_buffer;
+    GLsizei           instance_count;
+    usize             instance_offset;
 };
-typedef Vertex_LineSegment Vertex_LS;
 
-static constexpr GLenum TRIANGLES = GL_TRIANGLES;
-static constexpr GLenum LINES     = GL_LINES;
+struct Render_Context;
 
-struct Shader_Vertex {
-    Vec3_ua position;
-    Vec4_ua color;
-    Vec2_ua uv;
-};
+u32 Render_Context_push_matrix(Render_Context* ctx, const Mat4& matrix);
+void Render_Context_upload(Render_Context* ctx, VertexBufferData* vbd);
+void Render_Context_submit(Render_Context* ctx, const Draw_Command* cmd);
 
+// submits the indices [begin, end) that fall in visible chunks, merging adjacent visible chunks into one draw
+void cull_chunks_submit(Render_Context* ctx, Draw_Command* cmd, const Cull_Chunk* chunks, const usize begin, const usize end, const Vec2 view_min, const Vec2 view_max);
 
 
 template <usize SD_RENDER_BATCH_SIZE = 2048>
@@ -118,12 +126,10 @@ struct Render_Batch {
 
     UniformLocation MAT_LOC;
 
-    Mat4 projection_matrix;
     Mat4 transform_matrix;
 
     Vec4 color;
 
-    bool update_projection_matrix;
 
     GLenum draw_type;
 
@@ -133,6 +139,22 @@ struct Render_Batch {
 
     bool begun;
 
+    // when set, end() queues draws on the context instead of drawing immediately,
+    // the buffers are then reset with sd::batch_render after the context executes
+    Render_Context* render_context;
+    usize triangle_begin;
+    usize line_begin;
+
+    // when set, submit() drops the chunks outside [cull_min, cull_max], see sd::cull_rect_set
+    static constexpr usize CULL_CHUNK_COUNT = ((SD_RENDER_BATCH_SIZE * 2) + CULL_CHUNK_INDICES - 1) / CULL_CHUNK_INDICES;
+    Cull_Chunk triangle_chunks[CULL_CHUNK_COUNT];
+    Cull_Chunk line_chunks[CULL_CHUNK_COUNT];
+    usize triangle_bounded;
+    usize line_bounded;
+    bool cull;
+    Vec2 cull_min;
+    Vec2 cull_max;
+
     // TODO
     static usize next_id;
     static Dynamic_Array<usize> ids;
@@ -151,25 +173,66 @@ struct Render_Batch {
     //template<usize SD_RENDER_BATCH_SIZE>
     void render(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx)
     {
-        glUseProgram(ctx->shader);
+        gl_use_program(ctx->shader);
 
-        glUniformMatrix4fv(ctx->MAT_LOC, 1, GL_FALSE, glm::value_ptr(ctx->projection_matrix * ctx->transform_matrix));
+        gl_uniform_matrix4fv(ctx->MAT_LOC, glm::value_ptr(ctx->transform_matrix));
 
-        glBindVertexArray(ctx->vao_triangles);
+        gl_bind_vertex_array(ctx->vao_triangles);
         gl_bind_buffers_and_upload_sub_data(&ctx->triangle_buffer);
         if (ctx->triangle_buffer.i_count > 0) { 
             glDrawElements(GL_TRIANGLES, ctx->triangle_buffer.i_count, GL_UNSIGNED_INT, 0);
         }
 
-        glBindVertexArray(ctx->vao_lines);
+        gl_bind_vertex_array(ctx->vao_lines);
         gl_bind_buffers_and_upload_sub_data(&ctx->line_buffer);
         if (ctx->line_buffer.i_count > 0) { 
             glDrawElements(GL_LINES, ctx->line_buffer.i_count, GL_UNSIGNED_INT, 0);
         }
         
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
-        glUseProgram(0);
+    }
+
+    // queues the index ranges starting at triangle_begin and line_begin
+    void submit(void)
+    {
+        if (triangle_buffer.i_count == triangle_begin && line_buffer.i_count == line_begin) {
+            return;
+        }
+
+        Draw_Command cmd = {};
+        cmd.type         = DRAW_COMMAND_TYPE::ELEMENTS;
+        cmd.program      = shader;
+        cmd.mat_loc      = MAT_LOC;
+        cmd.matrix_index = Render_Context_push_matrix(render_context, transform_matrix);
+
+        if (triangle_buffer.i_count > triangle_begin) {
+            Render_Context_upload(render_context, &triangle_buffer);
+
+            cmd.vao       = vao_triangles;
+            cmd.primitive = GL_TRIANGLES;
+            if (cull) {
+                triangle_bounded = cull_chunks_update(triangle_chunks, &triangle_buffer, vao_triangles.stride, triangle_bounded);
+                cull_chunks_submit(render_context, &cmd, triangle_chunks, triangle_begin, triangle_buffer.i_count, cull_min, cull_max);
+            } else {
+                cmd.count     = triangle_buffer.i_count - triangle_begin;
+                cmd.offset    = triangle_begin * sizeof(GLuint);
+                Render_Context_submit(render_context, &cmd);
+            }
+        }
+
+        if (line_buffer.i_count > line_begin) {
+            Render_Context_upload(render_context, &line_buffer);
+
+            cmd.vao       = vao_lines;
+            cmd.primitive = GL_LINES;
+            if (cull) {
+                line_bounded = cull_chunks_update(line_chunks, &line_buffer, vao_lines.stride, line_bounded);
+                cull_chunks_submit(render_context, &cmd, line_chunks, line_begin, line_buffer.i_count, cull_min, cull_max);
+            } else {
+                cmd.count     = line_buffer.i_count - line_begin;
+                cmd.offset    = line_begin * sizeof(GLuint);
+                Render_Context_submit(render_context, &cmd);
+            }
+        }
     }
 
     void end(void) 
@@ -177,28 +240,34 @@ struct Render_Batch {
         //return;
         assert(begun == true);
 
-        glUseProgram(shader);
+        if (render_context != nullptr) {
+            submit();
+
+            // the queued ranges stay in the buffers until sd::batch_render
+            triangle_begin = triangle_buffer.i_count;
+            line_begin     = line_buffer.i_count;
 
-        if (update_projection_matrix || true) {
-            update_projection_matrix = false;
-            glUniformMatrix4fv(MAT_LOC, 1, GL_FALSE, glm::value_ptr(projection_matrix * transform_matrix));
+            begun = false;
+            return;
         }
 
-        glBindVertexArray(vao_triangles);
+        gl_use_program(shader);
+
+        // re-sent only when the product changes
+        gl_uniform_matrix4fv(MAT_LOC, glm::value_ptr(transform_matrix));
+
+        gl_bind_vertex_array(vao_triangles);
         gl_bind_buffers_and_upload_sub_data(&triangle_buffer);
         if (triangle_buffer.i_count > 0) { 
             glDrawElements(GL_TRIANGLES, triangle_buffer.i_count, GL_UNSIGNED_INT, 0);
         }
 
-        glBindVertexArray(vao_lines);
+        gl_bind_vertex_array(vao_lines);
         gl_bind_buffers_and_upload_sub_data(&line_buffer);
         if (line_buffer.i_count > 0) { 
             glDrawElements(GL_LINES, line_buffer.i_count, GL_UNSIGNED_INT, 0);
         }
         
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
-        glUseProgram(0);
 
 
         triangle_buffer.v_count = 0;
@@ -210,6 +279,9 @@ struct Render_Batch {
         index_triangles = 0;
         index_lines = 0;
 
+        triangle_bounded = 0;
+        line_bounded     = 0;
+
         begun = false;
     }
 
@@ -218,29 +290,30 @@ struct Render_Batch {
         //return;
         assert(begun == true);
 
+        if (render_context != nullptr) {
+            submit();
 
-        glUseProgram(shader);
-
-        if (update_projection_matrix || true) {
-            update_projection_matrix = false;
-            glUniformMatrix4fv(MAT_LOC, 1, GL_FALSE, glm::value_ptr(projection_matrix * transform_matrix));
+            begun = false;
+            return;
         }
 
-        glBindVertexArray(vao_triangles);
+        gl_use_program(shader);
+
+        // re-sent only when the product changes
+        gl_uniform_matrix4fv(MAT_LOC, glm::value_ptr(transform_matrix));
+
+        gl_bind_vertex_array(vao_triangles);
         gl_bind_buffers_and_upload_sub_data(&triangle_buffer);
         if (triangle_buffer.i_count > 0) { 
             glDrawElements(GL_TRIANGLES, triangle_buffer.i_count, GL_UNSIGNED_INT, 0);
         }
 
-        glBindVertexArray(vao_lines);
+        gl_bind_vertex_array(vao_lines);
         gl_bind_buffers_and_upload_sub_data(&line_buffer);
         if (line_buffer.i_count > 0) { 
             glDrawElements(GL_LINES, line_buffer.i_count, GL_UNSIGNED_INT, 0);
         }
         
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
-        glUseProgram(0);
 
         begun = false;        
     }
@@ -255,18 +328,31 @@ struct Render_Batch {
 
         ctx->index_triangles = 0;
         ctx->index_lines     = 0;        
+
+        ctx->triangle_begin = 0;
+        ctx->line_begin     = 0;
+
+        ctx->triangle_bounded = 0;
+        ctx->line_bounded     = 0;
     }
 
+    // the projection comes from the Frame_Data block, u_matrix is only the transform
     static constexpr const char* const SHADER_VERTEX_PATH = "shaders/default_2d/default_2d.vrts";
     static constexpr const char* const SHADER_FRAGMENT_PATH = "shaders/default_2d/default_2d.frgs";
 
 
-    bool init(Mat4 projection_matrix)
+    bool init(void)
     {
-        this->projection_matrix = projection_matrix;
-        update_projection_matrix = false;
         begun = false;
 
+        render_context = nullptr;
+        triangle_begin = 0;
+        line_begin     = 0;
+
+        triangle_bounded = 0;
+        line_bounded     = 0;
+        cull = false;
+
         index_triangles = 0;
         index_lines = 0;
 
@@ -274,7 +360,7 @@ struct Render_Batch {
 
         color = Vec4(0.0f, 0.0f, 0.0f, 1.0f);
 
-        if (false == Shader_load_from_file(
+        if (false == Shader_load_shared_from_file(
             &shader,
             SHADER_VERTEX_PATH,
             SHADER_FRAGMENT_PATH
@@ -287,7 +373,7 @@ struct Render_Batch {
 
         glUseProgram(shader);
         MAT_LOC = glGetUniformLocation(shader, "u_matrix");
-        glUniformMatrix4fv(MAT_LOC, 1, GL_FALSE, glm::value_ptr(projection_matrix));
+        glUniformMatrix4fv(MAT_LOC, 1, GL_FALSE, glm::value_ptr(Mat4(1.0f)));
         glUseProgram(0);
 
         VertexAttributeArray_init(&vao_triangles, attribute_stride);
@@ -345,7 +431,7 @@ struct Render_Batch {
         VertexAttributeArray_delete(&vao_lines);
         VertexBufferData_delete_inplace(&triangle_buffer);
         VertexBufferData_delete_inplace(&line_buffer);
-        glDeleteProgram(shader);
+        Shader_release(&shader);
     }
 
     void remove_triangle()
@@ -440,6 +526,11 @@ struct Render_Batch {
 
     void polygon_convex_regular(GLfloat radius, Vec3 center, const usize count_sides)
     {
+        if (count_sides < 3) {
+            SD_LOG_ERR("%s\n", "ERROR: polygon_convex_regular FEWER THAN 3 SIDES");
+            return;
+        }
+
         usize count_tris = count_sides - 2;
 
         usize attribute_stride;
@@ -448,7 +539,7 @@ struct Render_Batch {
         usize v_count = 0;
         usize i_count = 0;
         usize v_idx = 0;
-        GLdouble angle_turn = -(2 * PI) / count_sides;
+        const GLfloat* unit = sd::unit_polygon(count_sides);
 
         switch (draw_type) {
         case GL_TRIANGLES:
@@ -473,18 +564,9 @@ struct Render_Batch {
 
 
             for (usize p = 0, off = 0; p < count_sides; ++p, off += inc) {
-                Vec3 point = Vec3(Mat4(1.0f) * 
-                    Vec4(
-                        (radius * glm::cos(p * angle_turn)) + center.x,
-                        (radius * glm::sin(p * angle_turn)) + center.y,
-                        center.z,
-                        1.0f
-                    )
-                );
-
-                vertices_triangles[v_idx + off]     = point.x;
-                vertices_triangles[v_idx + off + 1] = point.y;
-                vertices_triangles[v_idx + off + 2] = point.z;
+                vertices_triangles[v_idx + off]     = (radius * unit[2 * p])     + center.x;
+                vertices_triangles[v_idx + off + 1] = (radius * unit[2 * p + 1]) + center.y;
+                vertices_triangles[v_idx + off + 2] = center.z;
 
                 memcpy(&vertices_triangles[v_idx + off + 3], &color[0], sizeof(color[0]) * 4);
             }
@@ -516,17 +598,9 @@ struct Render_Batch {
             line_buffer.i_count += (2 * count_sides);
 
             for (usize p = 0, off = 0; p < count_sides; ++p, off += inc) {
-                Vec3 point = Vec3(Mat4(1.0f) * 
-                    Vec4(
-                        (radius * glm::cos(p * angle_turn)) + center.x,
-                        (radius * glm::sin(p * angle_turn)) + center.y,
-                        center.z,
-                        1.0f
-                    )
-                );
-                vertices_lines[v_idx + off]     = point.x;
-                vertices_lines[v_idx + off + 1] = point.y;
-                vertices_lines[v_idx + off + 2] = point.z;
+                vertices_lines[v_idx + off]     = (radius * unit[2 * p])     + center.x;
+                vertices_lines[v_idx + off + 1] = (radius * unit[2 * p + 1]) + center.y;
+                vertices_lines[v_idx + off + 2] = center.z;
 
                 memcpy(&vertices_lines[v_idx + off + 3], &color[0], sizeof(color[0]) * 4);
             }
@@ -621,38 +695,751 @@ struct Render_Batch {
     }
 };
 
+// one record per circle / regular polygon, expanded on the GPU
+// from the unit polygon tables
+struct Shape_Instance {
+    Vec3_ua center;
+    GLfloat radius;
+    Vec4_ua color;
+};
+
+// points the per-instance attributes at the record starting at byte offset base
+// of the bound instance buffer
+inline void Shape_Instance_set_attribs(const usize base)
+{
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Shape_Instance), (GLvoid*)(base + offsetof(Shape_Instance, center)));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Shape_Instance), (GLvoid*)(base + offsetof(Shape_Instance, radius)));
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Shape_Instance), (GLvoid*)(base + offsetof(Shape_Instance, color)));
+}
+
+template <usize SD_INSTANCE_BATCH_SIZE = 1024>
+struct Render_Batch_Instanced {
+    static constexpr usize MAX_SHAPE_KINDS  = 16;
+    static constexpr usize MAX_UNIT_POINTS  = 1024;
+
+    struct Shape_Kind {
+        usize count_sides;
+        GLint first;
+    };
+
+    Shape_Instance instances[SD_INSTANCE_BATCH_SIZE];
+    // (kind index << 1) | is_lines
+    u8             instance_groups[SD_INSTANCE_BATCH_SIZE];
+    Shape_Instance staging[SD_INSTANCE_BATCH_SIZE];
+    usize          count;
+    // records already staged this frame when queued on a render context
+    usize          staged;
+
+    Shape_Kind kinds[MAX_SHAPE_KINDS];
+    usize      count_kinds;
+    GLfloat    unit_points[MAX_UNIT_POINTS * 2];
+    usize      count_unit_points;
+    usize      count_unit_points_uploaded;
+
+    VertexAttributeArray vao;
+    VBO vbo_unit;
+    VBO vbo_instances;
+    Shader shader;
+
+    UniformLocation MAT_LOC;
+
+    Mat4 transform_matrix;
+
+    Vec4 color;
+
+    GLenum draw_type;
+
+    bool begun;
+
+    Render_Context* render_context;
+
+    // when set, shapes outside [cull_min, cull_max] are dropped as they are added
+    bool cull;
+    Vec2 cull_min;
+    Vec2 cull_max;
+
+    static constexpr const char* const SHADER_VERTEX_PATH = "shaders/default_2d/instanced_polygon.vrts";
+    static constexpr const char* const SHADER_FRAGMENT_PATH = "shaders/default_2d/default_2d.frgs";
+
+    bool init(void)
+    {
+        transform_matrix = Mat4(1.0f);
+        begun = false;
+
+        count = 0;
+        staged = 0;
+        count_kinds = 0;
+        count_unit_points = 0;
+        count_unit_points_uploaded = 0;
+
+        draw_type = GL_TRIANGLES;
+
+        color = Vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+        render_context = nullptr;
+        cull = false;
+
+        if (false == Shader_load_shared_from_file(
+            &shader,
+            SHADER_VERTEX_PATH,
+            SHADER_FRAGMENT_PATH
+        )) {
+            SD_LOG_ERR("%s\n", "ERROR: sd::Render_Batch_Instanced initialization failed");
+            return false;
+        }
+
+        glUseProgram(shader);
+        MAT_LOC = glGetUniformLocation(shader, "u_matrix");
+        glUniformMatrix4fv(MAT_LOC, 1, GL_FALSE, glm::value_ptr(Mat4(1.0f)));
+        glUseProgram(0);
+
+        VertexAttributeArray_init(&vao, 2);
+        glBindVertexArray(vao);
+
+            glGenBuffers(1, &vbo_unit);
+            glBindBuffer(GL_ARRAY_BUFFER, vbo_unit);
+            glBufferData(GL_ARRAY_BUFFER, MAX_UNIT_POINTS * 2 * sizeof(GLfloat), NULL, GL_STATIC_DRAW);
+            // UNIT POSITION
+            gl_set_and_enable_vertex_attrib_ptr(0, 2, GL_FLOAT, GL_FALSE, 0, &vao);
+
+            glGenBuffers(1, &vbo_instances);
+            glBindBuffer(GL_ARRAY_BUFFER, vbo_instances);
+            glBufferData(GL_ARRAY_BUFFER, SD_INSTANCE_BATCH_SIZE * sizeof(Shape_Instance), NULL, GL_STREAM_DRAW);
+            // CENTER, RADIUS, COLOR (pointers are re-set per group in end())
+            glEnableVertexAttribArray(1);
+            glEnableVertexAttribArray(2);
+            glEnableVertexAttribArray(3);
+            glVertexAttribDivisor(1, 1);
+            glVertexAttribDivisor(2, 1);
+            glVertexAttribDivisor(3, 1);
+
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+
+        return true;
+    }
+
+    void free(void)
+    {
+        VertexAttributeArray_delete(&vao);
+        glDeleteBuffers(1, &vbo_unit);
+        glDeleteBuffers(1, &vbo_instances);
+        Shader_release(&shader);
+    }
+
+    void begin(void)
+    {
+        ASSERT(begun == false);
+
+        transform_matrix = Mat4(1.0f);
+
+        begun = true;
+    }
+
+    // returns the kind index for the side count, appending its unit points the first time,
+    // new points are uploaded in end()
+    isize kind_for(const usize count_sides)
+    {
+        foreach (k, count_kinds) {
+            if (kinds[k].count_sides == count_sides) {
+                return k;
+            }
+        }
+
+        if (count_kinds == MAX_SHAPE_KINDS || count_unit_points + count_sides > MAX_UNIT_POINTS) {
+            SD_LOG_ERR("%s\n", "ERROR: polygon_convex_regular MAX SHAPE KINDS EXCEEDED");
+            return -1;
+        }
+
+        Shape_Kind* kind = &kinds[count_kinds];
+        kind->count_sides = count_sides;
+        kind->first       = count_unit_points;
+
+        memcpy(&unit_points[count_unit_points * 2], sd::unit_polygon(count_sides), count_sides * 2 * sizeof(GLfloat));
+        count_unit_points += count_sides;
+
+        count_kinds += 1;
+        return count_kinds - 1;
+    }
+
+    bool polygon_convex_regular(GLfloat radius, Vec3 center, const usize count_sides)
+    {
+        if (count_sides < 3) {
+            SD_LOG_ERR("%s\n", "ERROR: polygon_convex_regular FEWER THAN 3 SIDES");
+            return false;
+        }
+
+        if (cull && (
+            center.x + radius < cull_min.x || center.x - radius > cull_max.x ||
+            center.y + radius < cull_min.y || center.y - radius > cull_max.y)) {
+            return true;
+        }
+
+        if (staged + count == SD_INSTANCE_BATCH_SIZE) {
+            SD_LOG_ERR("%s\n", "ERROR: polygon_convex_regular MAX INSTANCES EXCEEDED");
+            return false;
+        }
+
+        const isize kind = kind_for(count_sides);
+        if (kind < 0) {
+            return false;
+        }
+
+        Shape_Instance* inst = &instances[count];
+        inst->center = center;
+        inst->radius = radius;
+        inst->color  = color;
+
+        instance_groups[count] = (u8)((kind << 1) | ((draw_type == GL_LINES) ? 1 : 0));
+
+        count += 1;
+
+        return true;
+    }
+
+    bool circle(GLfloat radius, Vec3 center, usize detail = 37)
+    {
+        return polygon_convex_regular(radius, center, detail);
+    }
+
+    void end(void)
+    {
+        assert(begun == true);
+
+        if (count == 0) {
+            begun = false;
+            return;
+        }
+
+        // counting sort by group so each (side count, primitive) pair is one draw call
+        usize group_count[MAX_SHAPE_KINDS * 2] = {0};
+        usize group_begin[MAX_SHAPE_KINDS * 2];
+        usize group_next[MAX_SHAPE_KINDS * 2];
+        foreach (i, count) {
+            group_count[instance_groups[i]] += 1;
+        }
+        usize offset = staged;
+        foreach (g, MAX_SHAPE_KINDS * 2) {
+            group_begin[g] = offset;
+            group_next[g]  = offset;
+            offset += group_count[g];
+        }
+        foreach (i, count) {
+            staging[group_next[instance_groups[i]]] = instances[i];
+            group_next[instance_groups[i]] += 1;
+        }
+
+        if (count_unit_points_uploaded < count_unit_points) {
+            gl_bind_buffer(GL_ARRAY_BUFFER, vbo_unit);
+            glBufferSubData(
+                GL_ARRAY_BUFFER,
+                count_unit_points_uploaded * 2 * sizeof(GLfloat),
+                (count_unit_points - count_unit_points_uploaded) * 2 * sizeof(GLfloat),
+                &unit_points[count_unit_points_uploaded * 2]
+            );
+            count_unit_points_uploaded = count_unit_points;
+        }
+        gl_bind_buffer(GL_ARRAY_BUFFER, vbo_instances);
+        glBufferSubData(GL_ARRAY_BUFFER, staged * sizeof(Shape_Instance), count * sizeof(Shape_Instance), &staging[staged]);
+
+        if (render_context != nullptr) {
+            Draw_Command cmd = {};
+            cmd.type            = DRAW_COMMAND_TYPE::ARRAYS_INSTANCED;
+            cmd.program         = shader;
+            cmd.vao             = vao;
+            cmd.mat_loc         = MAT_LOC;
+            cmd.matrix_index    = Render_Context_push_matrix(render_context, transform_matrix);
+            cmd.instance_buffer = vbo_instances;
+
+            foreach (g, MAX_SHAPE_KINDS * 2) {
+                if (group_count[g] == 0) {
+                    continue;
+                }
+
+                const Shape_Kind* kind = &kinds[g >> 1];
+                cmd.primitive       = (g & 1) ? GL_LINE_LOOP : GL_TRIANGLE_FAN;
+                cmd.offset          = kind->first;
+                cmd.count           = kind->count_sides;
+                cmd.instance_count  = group_count[g];
+                cmd.instance_offset = group_begin[g] * sizeof(Shape_Instance);
+                Render_Context_submit(render_context, &cmd);
+            }
+
+            // the staged records must stay in the instance buffer until the context executes
+            staged += count;
+            count = 0;
+
+            begun = false;
+            return;
+        }
+
+        gl_use_program(shader);
+        gl_uniform_matrix4fv(MAT_LOC, glm::value_ptr(transform_matrix));
+
+        gl_bind_vertex_array(vao);
+
+        foreach (g, MAX_SHAPE_KINDS * 2) {
+            if (group_count[g] == 0) {
+                continue;
+            }
+
+            Shape_Instance_set_attribs(group_begin[g] * sizeof(Shape_Instance));
+
+            const Shape_Kind* kind = &kinds[g >> 1];
+            glDrawArraysInstanced(
+                (g & 1) ? GL_LINE_LOOP : GL_TRIANGLE_FAN,
+                kind->first,
+                kind->count_sides,
+                group_count[g]
+            );
+        }
+
+        count = 0;
+
+        begun = false;
+    }
+};
+
+// one textured quad, position is the top left corner, uv_min maps to the top left,
+// usually the rectangle of a Texture_Atlas_Region
+struct Sprite {
+    Vec3_ua position;
+    Vec2_ua size;
+    Vec2_ua uv_min;
+    Vec2_ua uv_max;
+    Vec4_ua color;
+};
+
+// textured quads as sd::Shader_Vertex with one static index buffer, a draw per texture:
+// sorted by texture when sort_by_texture is set (the default), in submission order otherwise,
+// where every texture change starts a new draw. Immediate batches flush themselves when full,
+// batches queued on a render context keep their vertices until sd::batch_render
+template <usize SD_SPRITE_BATCH_SIZE = 4096>
+struct Render_Batch_Sprite {
+    static constexpr usize MAX_TEXTURES = 64;
+    static constexpr usize MAX_RUNS     = 256;
+
+    // sprites [first, first + count) of the vertex buffer, all with one texture
+    struct Sprite_Run {
+        Texture texture;
+        usize   first;
+        usize   count;
+    };
+
+    Sprite        sprites[SD_SPRITE_BATCH_SIZE];
+    // index into textures
+    u8            sprite_slots[SD_SPRITE_BATCH_SIZE];
+    Shader_Vertex vertices[SD_SPRITE_BATCH_SIZE * 4];
+    usize         count;
+    // sprites already staged this frame when queued on a render context
+    usize         staged;
+
+    Texture textures[MAX_TEXTURES];
+    usize   count_textures;
+    // filled by build()
+    Sprite_Run runs[MAX_RUNS];
+    usize      count_runs;
+    // texture changes so far when not sorting
+    usize      count_open_runs;
+    Texture    last_texture;
+    // draws issued or submitted since cpu_init, flushes included
+    usize      count_draws;
+
+    bool sort_by_texture;
+
+    VertexAttributeArray vao;
+    VBO vbo;
+    EBO ebo;
+    Shader shader;
+
+    UniformLocation MAT_LOC;
+
+    Mat4 transform_matrix;
+
+    Vec4 color;
+
+    bool begun;
+
+    Render_Context* render_context;
+
+    // when set, sprites outside [cull_min, cull_max] are dropped as they are added
+    bool cull;
+    Vec2 cull_min;
+    Vec2 cull_max;
+
+    static constexpr const char* const SHADER_VERTEX_PATH = "shaders/default_2d/sprite.vrts";
+    static constexpr const char* const SHADER_FRAGMENT_PATH = "shaders/default_2d/sprite.frgs";
+
+    // the CPU side only, for building without a GL context
+    void cpu_init(void)
+    {
+        transform_matrix = Mat4(1.0f);
+        begun = false;
+
+        count = 0;
+        staged = 0;
+        count_textures = 0;
+        count_runs = 0;
+        count_open_runs = 0;
+        last_texture = 0;
+        count_draws = 0;
+        // stays 0 without init, end() then only builds
+        vbo = 0;
+
+        sort_by_texture = true;
+
+        color = Vec4(1.0f);
+
+        render_context = nullptr;
+        cull = false;
+    }
+
+    bool init(void)
+    {
+        cpu_init();
+
+        if (false == Shader_load_shared_from_file(
+            &shader,
+            SHADER_VERTEX_PATH,
+            SHADER_FRAGMENT_PATH
+        )) {
+            SD_LOG_ERR("%s\n", "ERROR: sd::Render_Batch_Sprite initialization failed");
+            return false;
+        }
+
+        glUseProgram(shader);
+        MAT_LOC = glGetUniformLocation(shader, "u_matrix");
+        glUniformMatrix4fv(MAT_LOC, 1, GL_FALSE, glm::value_ptr(Mat4(1.0f)));
+        // sprites are drawn from unit 0, as render contexts bind textures
+        glUniform1i(glGetUniformLocation(shader, "u_texture"), 0);
+        glUseProgram(0);
+
+        // every quad is 0 1 2, 2 3 0 from its first vertex, written once
+        GLuint* indices = (GLuint*)xmalloc(SD_SPRITE_BATCH_SIZE * 6 * sizeof(GLuint));
+        foreach (q, SD_SPRITE_BATCH_SIZE) {
+            const GLuint v = (GLuint)(q * 4);
+            GLuint* i = &indices[q * 6];
+            i[0] = v;
+            i[1] = v + 1;
+            i[2] = v + 2;
+            i[3] = v + 2;
+            i[4] = v + 3;
+            i[5] = v;
+        }
+
+        VertexAttributeArray_init(&vao, sizeof(Shader_Vertex) / sizeof(GLfloat));
+        glBindVertexArray(vao);
+
+            glGenBuffers(1, &vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glBufferData(GL_ARRAY_BUFFER, SD_SPRITE_BATCH_SIZE * 4 * sizeof(Shader_Vertex), NULL, GL_STREAM_DRAW);
+
+            glGenBuffers(1, &ebo);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, SD_SPRITE_BATCH_SIZE * 6 * sizeof(GLuint), indices, GL_STATIC_DRAW);
+
+            // POSITION
+            gl_set_and_enable_vertex_attrib_ptr(0, 3, GL_FLOAT, GL_FALSE, 0, &vao);
+            // COLOR
+            gl_set_and_enable_vertex_attrib_ptr(1, 4, GL_FLOAT, GL_FALSE, 3, &vao);
+            // UV
+            gl_set_and_enable_vertex_attrib_ptr(2, 2, GL_FLOAT, GL_FALSE, 7, &vao);
+
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+        gl_state_invalidate();
+
+        ::free(indices);
+
+        return true;
+    }
+
+    void free(void)
+    {
+        VertexAttributeArray_delete(&vao);
+        glDeleteBuffers(1, &vbo);
+        glDeleteBuffers(1, &ebo);
+        Shader_release(&shader);
+    }
+
+    void begin(void)
+    {
+        ASSERT(begun == false);
+
+        transform_matrix = Mat4(1.0f);
+
+        begun = true;
+    }
+
+    // ends and begins again with the same transform, only without a render context,
+    // reason names the exhausted limit for the error
+    bool flush(const char* reason)
+    {
+        if (render_context != nullptr) {
+            SD_LOG_ERR("ERROR: sd::Render_Batch_Sprite %s EXCEEDED\n", reason);
+            return false;
+        }
+
+        const Mat4 transform = transform_matrix;
+        end();
+        begin();
+        transform_matrix = transform;
+        return true;
+    }
+
+    isize slot_for(const Texture texture)
+    {
+        foreach (t, count_textures) {
+            if (textures[t] == texture) {
+                return t;
+            }
+        }
+
+        if (count_textures == MAX_TEXTURES) {
+            return -1;
+        }
+
+        textures[count_textures] = texture;
+        count_textures += 1;
+        return count_textures - 1;
+    }
+
+    bool sprite(const Vec3 position, const Vec2 size, const Vec2 uv_min, const Vec2 uv_max, const Texture texture)
+    {
+        if (cull && (
+            position.x + size.x < cull_min.x || position.x > cull_max.x ||
+            position.y + size.y < cull_min.y || position.y > cull_max.y)) {
+            return true;
+        }
+
+        const bool new_run = !sort_by_texture && (count == 0 || texture != last_texture);
+        if (staged + count == SD_SPRITE_BATCH_SIZE) {
+            if (!flush("MAX SPRITES")) {
+                return false;
+            }
+        } else if (new_run && count_open_runs == MAX_RUNS) {
+            if (!flush("MAX RUNS")) {
+                return false;
+            }
+        }
+
+        isize slot = slot_for(texture);
+        if (slot < 0) {
+            if (!flush("MAX TEXTURES")) {
+                return false;
+            }
+            slot = slot_for(texture);
+        }
+
+        if (!sort_by_texture && (count == 0 || texture != last_texture)) {
+            count_open_runs += 1;
+        }
+        last_texture = texture;
+
+        Sprite* s = &sprites[count];
+        s->position = position;
+        s->size     = size;
+        s->uv_min   = uv_min;
+        s->uv_max   = uv_max;
+        s->color    = color;
+        sprite_slots[count] = (u8)slot;
+
+        count += 1;
+
+        return true;
+    }
+
+    static inline void write_quad(Shader_Vertex* v, const Sprite* s)
+    {
+        const f32 x0 = s->position.x;
+        const f32 y0 = s->position.y;
+        const f32 x1 = x0 + s->size.x;
+        const f32 y1 = y0 + s->size.y;
+        const f32 z  = s->position.z;
+
+        // top left, bottom left, bottom right, top right
+        v[0].position = Vec3_ua(x0, y0, z);
+        v[0].uv       = Vec2_ua(s->uv_min.x, s->uv_min.y);
+        v[1].position = Vec3_ua(x0, y1, z);
+        v[1].uv       = Vec2_ua(s->uv_min.x, s->uv_max.y);
+        v[2].position = Vec3_ua(x1, y1, z);
+        v[2].uv       = Vec2_ua(s->uv_max.x, s->uv_max.y);
+        v[3].position = Vec3_ua(x1, y0, z);
+        v[3].uv       = Vec2_ua(s->uv_max.x, s->uv_min.y);
+        v[0].color = s->color;
+        v[1].color = s->color;
+        v[2].color = s->color;
+        v[3].color = s->color;
+    }
+
+    // writes the vertices of the added sprites after the staged ones and fills runs, no GL calls
+    void build(void)
+    {
+        count_runs = 0;
+
+        if (!sort_by_texture) {
+            foreach (i, count) {
+                write_quad(&vertices[(staged + i) * 4], &sprites[i]);
+
+                const Texture texture = textures[sprite_slots[i]];
+                if (count_runs > 0 && runs[count_runs - 1].texture == texture) {
+                    runs[count_runs - 1].count += 1;
+                    continue;
+                }
+                runs[count_runs] = {texture, staged + i, 1};
+                count_runs += 1;
+            }
+            return;
+        }
+
+        // counting sort by texture, the order within a texture is kept
+        usize slot_count[MAX_TEXTURES] = {0};
+        usize slot_next[MAX_TEXTURES];
+        foreach (i, count) {
+            slot_count[sprite_slots[i]] += 1;
+        }
+        usize offset = staged;
+        foreach (t, count_textures) {
+            slot_next[t] = offset;
+            runs[count_runs] = {textures[t], offset, slot_count[t]};
+            count_runs += 1;
+            offset += slot_count[t];
+        }
+        foreach (i, count) {
+            write_quad(&vertices[slot_next[sprite_slots[i]] * 4], &sprites[i]);
+            slot_next[sprite_slots[i]] += 1;
+        }
+    }
+
+    void end(void)
+    {
+        assert(begun == true);
+
+        if (count == 0) {
+            count_textures  = 0;
+            count_open_runs = 0;
+            begun = false;
+            return;
+        }
+
+        build();
+        count_draws += count_runs;
+
+        if (vbo == 0) {
+            count           = 0;
+            count_textures  = 0;
+            count_open_runs = 0;
+            begun = false;
+            return;
+        }
+
+        gl_bind_buffer(GL_ARRAY_BUFFER, vbo);
+        // a fresh store at the start of a frame so the driver does not wait on the last one
+        if (staged == 0) {
+            glBufferData(GL_ARRAY_BUFFER, SD_SPRITE_BATCH_SIZE * 4 * sizeof(Shader_Vertex), NULL, GL_STREAM_DRAW);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, staged * 4 * sizeof(Shader_Vertex), count * 4 * sizeof(Shader_Vertex), &vertices[staged * 4]);
+
+        if (render_context != nullptr) {
+            Draw_Command cmd = {};
+            cmd.type         = DRAW_COMMAND_TYPE::ELEMENTS;
+            cmd.program      = shader;
+            cmd.vao          = vao;
+            cmd.primitive    = GL_TRIANGLES;
+            cmd.mat_loc      = MAT_LOC;
+            cmd.matrix_index = Render_Context_push_matrix(render_context, transform_matrix);
+
+            foreach (r, count_runs) {
+                cmd.texture = runs[r].texture;
+                cmd.count   = runs[r].count * 6;
+                cmd.offset  = runs[r].first * 6 * sizeof(GLuint);
+                Render_Context_submit(render_context, &cmd);
+            }
+
+            // the staged vertices must stay in the buffer until the context executes
+            staged += count;
+        } else {
+            gl_use_program(shader);
+            gl_uniform_matrix4fv(MAT_LOC, glm::value_ptr(transform_matrix));
+
+            gl_bind_vertex_array(vao);
+            gl_active_texture(GL_TEXTURE0);
+
+            foreach (r, count_runs) {
+                gl_bind_texture(GL_TEXTURE_2D, runs[r].texture);
+                glDrawElements(GL_TRIANGLES, runs[r].count * 6, GL_UNSIGNED_INT, (GLvoid*)(runs[r].first * 6 * sizeof(GLuint)));
+            }
+        }
+
+        count           = 0;
+        count_textures  = 0;
+        count_open_runs = 0;
+
+        begun = false;
+    }
+};
+
+// level geometry baked into GL_STATIC_DRAW buffers, drawing it only changes the matrix uniform,
+// edit `geometry` with the usual sd calls and the next draw uploads just the part that changed
+template <usize SD_RENDER_BATCH_SIZE = 2048>
+struct Static_Mesh {
+    // the CPU copy, its buffer objects are the baked ones and it is never begun or ended
+    sd::Render_Batch<SD_RENDER_BATCH_SIZE> geometry;
+
+    // float and index counts already in the buffers
+    usize triangle_v_baked;
+    usize triangle_i_baked;
+    usize line_v_baked;
+    usize line_i_baked;
+
+    // false when the program was passed to sd::Static_Mesh_init
+    bool owns_shader;
+};
+
+
 template<usize SD_RENDER_BATCH_SIZE> void begin(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx);
 template<usize SD_RENDER_BATCH_SIZE> void render(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx);
 template<usize SD_RENDER_BATCH_SIZE> void end(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx);
 template<usize SD_RENDER_BATCH_SIZE> void end_no_reset(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx);
 template<usize SD_RENDER_BATCH_SIZE> void batch_render(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx);
 
-template<usize SD_RENDER_BATCH_SIZE> inline bool layer_init(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Mat4 projection_matrix);
-template<usize SD_RENDER_BATCH_SIZE> sd::Render_Batch<SD_RENDER_BATCH_SIZE> Render_Batch_make(Mat4 projection_matrix);
+template<usize SD_RENDER_BATCH_SIZE> inline bool layer_init(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx);
+template<usize SD_RENDER_BATCH_SIZE> sd::Render_Batch<SD_RENDER_BATCH_SIZE> Render_Batch_make(void);
 template<usize SD_RENDER_BATCH_SIZE> void free(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx);
 
-template<usize SD_RENDER_BATCH_SIZE> bool line(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec3 a, Vec3 b);
-template<usize SD_RENDER_BATCH_SIZE> bool line(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec2 a, Vec2 b);
-template<usize SD_RENDER_BATCH_SIZE> bool remove_line_swap_end(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, usize idx);
-template<usize SD_RENDER_BATCH_SIZE> bool quad(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec3, Vec3, Vec3, Vec3);
-template<usize SD_RENDER_BATCH_SIZE> bool quad(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec2, Vec2, Vec2, Vec2);
-template<usize SD_RENDER_BATCH_SIZE> bool polygon_convex_regular(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, GLfloat radius, Vec3 center, const usize count_sides);
-template<usize SD_RENDER_BATCH_SIZE> bool polygon_convex_regular(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, GLfloat radius, Vec2 center, const usize count_sides);
-template<usize SD_RENDER_BATCH_SIZE> bool circle(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, GLfloat radius, Vec3 center, usize detail = 37);
-template<usize SD_RENDER_BATCH_SIZE> bool circle(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, GLfloat radius, Vec2 center, usize detail = 37);
-template<usize SD_RENDER_BATCH_SIZE> bool vertex(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec3 v);
-template<usize SD_RENDER_BATCH_SIZE> bool vertex(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec2 v);
-// template<usize SD_RENDER_BATCH_SIZE, usize N> bool polygon(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Buffer<Vec3, N>* vs);
-// template<usize SD_RENDER_BATCH_SIZE, usize N> bool polygon(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Buffer<Vec2, N>* vs);
-// template<usize SD_RENDER_BATCH_SIZE> bool polygon(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, DynamicBuffer<Vec3>* vs);
-// template<usize SD_RENDER_BATCH_SIZE> bool polygon(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, DynamicBuffer<Vec2>* vs);
-template<usize SD_RENDER_BATCH_SIZE> bool polygon(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec3* vs, const usize count);
-template<usize SD_RENDER_BATCH_SIZE> bool polygon(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec2* vs, const usize count);
-template<usize SD_RENDER_BATCH_SIZE> bool polygon(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Array_Slice<Vec3> slice);
-template<usize SD_RENDER_BATCH_SIZE> bool polygon(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Array_Slice<Vec2>* slice);
-
-template<usize SD_RENDER_BATCH_SIZE> inline void color(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec4 color);
-template<usize SD_RENDER_BATCH_SIZE> inline void push_context(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx);
+
+template<usize SD_INSTANCE_BATCH_SIZE> bool polygon_convex_regular(sd::Render_Batch_Instanced<SD_INSTANCE_BATCH_SIZE>* ctx, GLfloat radius, Vec3 center, const usize count_sides);
+template<usize SD_INSTANCE_BATCH_SIZE> bool polygon_convex_regular(sd::Render_Batch_Instanced<SD_INSTANCE_BATCH_SIZE>* ctx, GLfloat radius, Vec2 center, const usize count_sides);
+template<usize SD_INSTANCE_BATCH_SIZE> bool circle(sd::Render_Batch_Instanced<SD_INSTANCE_BATCH_SIZE>* ctx, GLfloat radius, Vec3 center, usize detail = 37);
+template<usize SD_INSTANCE_BATCH_SIZE> bool circle(sd::Render_Batch_Instanced<SD_INSTANCE_BATCH_SIZE>* ctx, GLfloat radius, Vec2 center, usize detail = 37);
+template<usize SD_INSTANCE_BATCH_SIZE> inline void color(sd::Render_Batch_Instanced<SD_INSTANCE_BATCH_SIZE>* ctx, Vec4 color);
+template<usize SD_INSTANCE_BATCH_SIZE> void free(sd::Render_Batch_Instanced<SD_INSTANCE_BATCH_SIZE>* ctx);
+template<usize SD_INSTANCE_BATCH_SIZE> void batch_render(sd::Render_Batch_Instanced<SD_INSTANCE_BATCH_SIZE>* ctx);
+
+// subsequent submissions are culled against the rectangle, given in the batch's untransformed space
+template<usize SD_INSTANCE_BATCH_SIZE> inline void cull_rect_set(sd::Render_Batch_Instanced<SD_INSTANCE_BATCH_SIZE>* ctx, Vec2 min, Vec2 max);
+
+template<usize SD_SPRITE_BATCH_SIZE> bool sprite(sd::Render_Batch_Sprite<SD_SPRITE_BATCH_SIZE>* ctx, Vec3 position, Vec2 size, Vec2 uv_min, Vec2 uv_max, Texture texture);
+// the whole texture
+template<usize SD_SPRITE_BATCH_SIZE> bool sprite(sd::Render_Batch_Sprite<SD_SPRITE_BATCH_SIZE>* ctx, Vec3 position, Vec2 size, Texture texture);
+template<usize SD_SPRITE_BATCH_SIZE> inline void color(sd::Render_Batch_Sprite<SD_SPRITE_BATCH_SIZE>* ctx, Vec4 color);
+template<usize SD_SPRITE_BATCH_SIZE> void free(sd::Render_Batch_Sprite<SD_SPRITE_BATCH_SIZE>* ctx);
+template<usize SD_SPRITE_BATCH_SIZE> void batch_render(sd::Render_Batch_Sprite<SD_SPRITE_BATCH_SIZE>* ctx);
+template<usize SD_SPRITE_BATCH_SIZE> inline void cull_rect_set(sd::Render_Batch_Sprite<SD_SPRITE_BATCH_SIZE>* ctx, Vec2 min, Vec2 max);
+
+// loads the default 2d program unless one is given, a given program is shared and outlives the mesh
+template<usize SD_RENDER_BATCH_SIZE> bool Static_Mesh_init(sd::Static_Mesh<SD_RENDER_BATCH_SIZE>* mesh, GLuint program = 0);
+// uploads what changed since the last bake, returns the number of bytes sent
+template<usize SD_RENDER_BATCH_SIZE> usize Static_Mesh_bake(sd::Static_Mesh<SD_RENDER_BATCH_SIZE>* mesh);
+// empties the geometry for a full rebake, use instead of resetting `geometry` directly
+template<usize SD_RENDER_BATCH_SIZE> void Static_Mesh_reset(sd::Static_Mesh<SD_RENDER_BATCH_SIZE>* mesh);
+// sd::remove_line_swap_end, marking the moved segment for the next bake
+template<usize SD_RENDER_BATCH_SIZE> bool Static_Mesh_remove_line_swap_end(sd::Static_Mesh<SD_RENDER_BATCH_SIZE>* mesh, usize idx);
+// bakes pending edits, then queues the baked ranges on ctx or draws them immediately when ctx is nullptr,
+// culled against sd::cull_rect_set(&mesh->geometry, ...)
+template<usize SD_RENDER_BATCH_SIZE> void Static_Mesh_draw(sd::Static_Mesh<SD_RENDER_BATCH_SIZE>* mesh, Render_Context* ctx, const Mat4& transform);
+template<usize SD_RENDER_BATCH_SIZE> void Static_Mesh_free(sd::Static_Mesh<SD_RENDER_BATCH_SIZE>* mesh);
+
 
 }
 
@@ -664,12 +1451,32 @@ template<usize SD_RENDER_BATCH_SIZE> inline void push_context(sd::Render_Batch<S
 namespace sd {
 
 
-template<usize SD_RENDER_BATCH_SIZE> inline bool layer_init(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Mat4 projection_matrix)
+void cull_chunks_submit(Render_Context* ctx, Draw_Command* cmd, const Cull_Chunk* chunks, const usize begin, const usize end, const Vec2 view_min, const Vec2 view_max)
+{
+    Cull_Run_Iterator it = cull_runs(chunks, begin, end, view_min, view_max);
+
+    usize run_begin;
+    usize run_end;
+    while (cull_runs_next(&it, &run_begin, &run_end)) {
+        cmd->count  = run_end - run_begin;
+        cmd->offset = run_begin * sizeof(GLuint);
+        Render_Context_submit(ctx, cmd);
+    }
+}
+
+
+template<usize SD_RENDER_BATCH_SIZE> inline bool layer_init(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx)
 {
-    ctx->projection_matrix = projection_matrix;
-    ctx->update_projection_matrix = false;
     ctx->begun = false;
 
+    ctx->render_context = nullptr;
+    ctx->triangle_begin = 0;
+    ctx->line_begin     = 0;
+
+    ctx->triangle_bounded = 0;
+    ctx->line_bounded     = 0;
+    ctx->cull = false;
+
     ctx->index_triangles = 0;
     ctx->index_lines = 0;
 
@@ -680,7 +1487,7 @@ template<usize SD_RENDER_BATCH_SIZE> inline bool layer_init(sd::Render_Batch<SD_
     const char *const SHADER_VERTEX_PATH = sd::Render_Batch<SD_RENDER_BATCH_SIZE>::SHADER_VERTEX_PATH;
     const char *const SHADER_FRAGMENT_PATH = sd::Render_Batch<SD_RENDER_BATCH_SIZE>::SHADER_FRAGMENT_PATH;
 
-    if (false == Shader_load_from_file(
+    if (false == Shader_load_shared_from_file(
         &ctx->shader,
         SHADER_VERTEX_PATH,
         SHADER_FRAGMENT_PATH
@@ -693,7 +1500,7 @@ template<usize SD_RENDER_BATCH_SIZE> inline bool layer_init(sd::Render_Batch<SD_
 
     glUseProgram(ctx->shader);
     ctx->MAT_LOC = glGetUniformLocation(ctx->shader, "u_matrix");
-    glUniformMatrix4fv(ctx->MAT_LOC, 1, GL_FALSE, glm::value_ptr(ctx->projection_matrix));
+    glUniformMatrix4fv(ctx->MAT_LOC, 1, GL_FALSE, glm::value_ptr(Mat4(1.0f)));
     glUseProgram(0);
 
     VertexAttributeArray_init(&ctx->vao_triangles, attribute_stride);
@@ -745,10 +1552,10 @@ template<usize SD_RENDER_BATCH_SIZE> inline bool layer_init(sd::Render_Batch<SD_
     return true;
 }
 
-template<usize SD_RENDER_BATCH_SIZE = 2048> sd::Render_Batch<SD_RENDER_BATCH_SIZE> Render_Batch_make(Mat4 projection_matrix)
+template<usize SD_RENDER_BATCH_SIZE = 2048> sd::Render_Batch<SD_RENDER_BATCH_SIZE> Render_Batch_make(void)
 {
     sd::Render_Batch<SD_RENDER_BATCH_SIZE> ctx;
-    if (sd::layer_init(&ctx, projection_matrix) == false) {
+    if (sd::layer_init(&ctx) == false) {
         SD_LOG_ERR("%s\n", "ERROR: Context creation failed");
     }
     return ctx;
@@ -756,25 +1563,22 @@ template<usize SD_RENDER_BATCH_SIZE = 2048> sd::Render_Batch<SD_RENDER_BATCH_SIZ
 
 template<usize N> void render(sd::Render_Batch<N>* ctx)
 {
-    glUseProgram(ctx->shader);
+    gl_use_program(ctx->shader);
 
-    glUniformMatrix4fv(ctx->MAT_LOC, 1, GL_FALSE, glm::value_ptr(ctx->projection_matrix * ctx->transform_matrix));
+    gl_uniform_matrix4fv(ctx->MAT_LOC, glm::value_ptr(ctx->transform_matrix));
 
-    glBindVertexArray(ctx->vao_triangles);
+    gl_bind_vertex_array(ctx->vao_triangles);
     gl_bind_buffers_and_upload_sub_data(&ctx->triangle_buffer);
     if (ctx->triangle_buffer.i_count > 0) { 
         glDrawElements(GL_TRIANGLES, ctx->triangle_buffer.i_count, GL_UNSIGNED_INT, 0);
     }
 
-    glBindVertexArray(ctx->vao_lines);
+    gl_bind_vertex_array(ctx->vao_lines);
     gl_bind_buffers_and_upload_sub_data(&ctx->line_buffer);
     if (ctx->line_buffer.i_count > 0) { 
         glDrawElements(GL_LINES, ctx->line_buffer.i_count, GL_UNSIGNED_INT, 0);
     }
     
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    glUseProgram(0);
 }
 
 template<usize N> void free(sd::Render_Batch<N>* ctx)
@@ -783,7 +1587,7 @@ template<usize N> void free(sd::Render_Batch<N>* ctx)
     VertexAttributeArray_delete(&ctx->vao_lines);
     VertexBufferData_delete_inplace(&ctx->triangle_buffer);
     VertexBufferData_delete_inplace(&ctx->line_buffer);
-    glDeleteProgram(ctx->shader);
+    Shader_release(&ctx->shader);
 }
 
 template<usize SD_RENDER_BATCH_SIZE> void batch_render(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx)
@@ -796,280 +1600,283 @@ template<usize SD_RENDER_BATCH_SIZE> void batch_render(sd::Render_Batch<SD_RENDE
 
     ctx->index_triangles = 0;
     ctx->index_lines     = 0;        
+
+    ctx->triangle_begin = 0;
+    ctx->line_begin     = 0;
+
+    ctx->triangle_bounded = 0;
+    ctx->line_bounded     = 0;
 }
 
 
-template<usize SD_RENDER_BATCH_SIZE> bool line(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec3 a, Vec3 b)
+template<usize SD_INSTANCE_BATCH_SIZE> bool polygon_convex_regular(sd::Render_Batch_Instanced<SD_INSTANCE_BATCH_SIZE>* ctx, GLfloat radius, Vec3 center, const usize count_sides)
 {
-    const usize v_count = ctx->line_buffer.v_count;
-    const usize i_count = ctx->line_buffer.i_count;
+    return ctx->polygon_convex_regular(radius, center, count_sides);
+}
 
-    const usize attribute_stride = ctx->vao_lines.stride;
+template<usize SD_INSTANCE_BATCH_SIZE> bool polygon_convex_regular(sd::Render_Batch_Instanced<SD_INSTANCE_BATCH_SIZE>* ctx, GLfloat radius, Vec2 center, const usize count_sides)
+{
+    return ctx->polygon_convex_regular(radius, Vec3(center, 1.0), count_sides);
+}
 
-    if (v_count + (2 * attribute_stride) > (SD_RENDER_BATCH_SIZE * attribute_stride) || (i_count + 2 > SD_RENDER_BATCH_SIZE * 2)) {
-        SD_LOG_ERR("%s\n", "ERROR: add_line_segment MAX LINES EXCEEDED");
-        return false;
-    }
+template<usize SD_INSTANCE_BATCH_SIZE> bool circle(sd::Render_Batch_Instanced<SD_INSTANCE_BATCH_SIZE>* ctx, GLfloat radius, Vec3 center, usize detail)
+{
+    return ctx->polygon_convex_regular(radius, center, detail);
+}
 
-    const usize v_idx = v_count;
+template<usize SD_INSTANCE_BATCH_SIZE> bool circle(sd::Render_Batch_Instanced<SD_INSTANCE_BATCH_SIZE>* ctx, GLfloat radius, Vec2 center, usize detail)
+{
+    return ctx->polygon_convex_regular(radius, Vec3(center, 1.0), detail);
+}
 
-    // memcpy(&ctx->vertices_lines[v_idx], &a[0], sizeof(a[0]) * 3);
-    // memcpy(&ctx->vertices_lines[v_idx + 3], &ctx->color[0], sizeof(ctx->color[0]) * 4);
+template<usize SD_INSTANCE_BATCH_SIZE> inline void color(sd::Render_Batch_Instanced<SD_INSTANCE_BATCH_SIZE>* ctx, Vec4 color)
+{
+    ctx->color = color;
+}
 
-    ctx->vertices_lines[v_idx]     = a.x;
-    ctx->vertices_lines[v_idx + 1] = a.y;
-    ctx->vertices_lines[v_idx + 2] = a.z;
-    ctx->vertices_lines[v_idx + 3] = ctx->color[0];
-    ctx->vertices_lines[v_idx + 4] = ctx->color[1];
-    ctx->vertices_lines[v_idx + 5] = ctx->color[2];
-    ctx->vertices_lines[v_idx + 6] = ctx->color[3];
+template<usize SD_INSTANCE_BATCH_SIZE> void free(sd::Render_Batch_Instanced<SD_INSTANCE_BATCH_SIZE>* ctx)
+{
+    ctx->free();
+}
 
+template<usize SD_INSTANCE_BATCH_SIZE> void batch_render(sd::Render_Batch_Instanced<SD_INSTANCE_BATCH_SIZE>* ctx)
+{
+    ctx->count  = 0;
+    ctx->staged = 0;
+}
 
 
-    // memcpy(&ctx->vertices_lines[v_idx + attribute_stride], &b[0], sizeof(b[0]) * 3);
-    // memcpy(&ctx->vertices_lines[v_idx + attribute_stride + 3], &ctx->color[0], sizeof(ctx->color[0]) * 4);
+template<usize SD_INSTANCE_BATCH_SIZE> inline void cull_rect_set(sd::Render_Batch_Instanced<SD_INSTANCE_BATCH_SIZE>* ctx, Vec2 min, Vec2 max)
+{
+    ctx->cull     = true;
+    ctx->cull_min = min;
+    ctx->cull_max = max;
+}
 
 
-    ctx->vertices_lines[v_idx + attribute_stride]     = b.x;
-    ctx->vertices_lines[v_idx + 1 + attribute_stride] = b.y;
-    ctx->vertices_lines[v_idx + 2 + attribute_stride] = b.z;
-    ctx->vertices_lines[v_idx + 3 + attribute_stride] = ctx->color[0];
-    ctx->vertices_lines[v_idx + 4 + attribute_stride] = ctx->color[1];
-    ctx->vertices_lines[v_idx + 5 + attribute_stride] = ctx->color[2];
-    ctx->vertices_lines[v_idx + 6 + attribute_stride] = ctx->color[3];
+template<usize SD_SPRITE_BATCH_SIZE> bool sprite(sd::Render_Batch_Sprite<SD_SPRITE_BATCH_SIZE>* ctx, Vec3 position, Vec2 size, Vec2 uv_min, Vec2 uv_max, Texture texture)
+{
+    return ctx->sprite(position, size, uv_min, uv_max, texture);
+}
 
-    ctx->indices_lines[i_count]     = ctx->index_lines;
-    ctx->indices_lines[i_count + 1] = ctx->index_lines + 1;
-    ctx->index_lines += 2;
+template<usize SD_SPRITE_BATCH_SIZE> bool sprite(sd::Render_Batch_Sprite<SD_SPRITE_BATCH_SIZE>* ctx, Vec3 position, Vec2 size, Texture texture)
+{
+    return ctx->sprite(position, size, Vec2(0.0f), Vec2(1.0f), texture);
+}
 
-    ctx->line_buffer.v_count += (2 * attribute_stride);
-    ctx->line_buffer.i_count += 2;
+template<usize SD_SPRITE_BATCH_SIZE> inline void color(sd::Render_Batch_Sprite<SD_SPRITE_BATCH_SIZE>* ctx, Vec4 color)
+{
+    ctx->color = color;
+}
 
-    return true;
+template<usize SD_SPRITE_BATCH_SIZE> void free(sd::Render_Batch_Sprite<SD_SPRITE_BATCH_SIZE>* ctx)
+{
+    ctx->free();
 }
 
-template<usize SD_RENDER_BATCH_SIZE> bool line(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec2 a, Vec2 b)
+template<usize SD_SPRITE_BATCH_SIZE> void batch_render(sd::Render_Batch_Sprite<SD_SPRITE_BATCH_SIZE>* ctx)
 {
-    return sd::line(ctx, Vec3(a, 1), Vec3(b, 1));
+    ctx->count  = 0;
+    ctx->staged = 0;
 }
 
-template<usize SD_RENDER_BATCH_SIZE> bool remove_line_swap_end(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, usize idx)
+template<usize SD_SPRITE_BATCH_SIZE> inline void cull_rect_set(sd::Render_Batch_Sprite<SD_SPRITE_BATCH_SIZE>* ctx, Vec2 min, Vec2 max)
 {
-    const usize attribute_stride = ctx->vao_lines.stride;
+    ctx->cull     = true;
+    ctx->cull_min = min;
+    ctx->cull_max = max;
+}
 
-#ifdef SD_BOUNDS_CHECK
-    if ((idx * (2 * attribute_stride) > (SD_RENDER_BATCH_SIZE * attribute_stride)) || (idx * 2 > SD_RENDER_BATCH_SIZE * 2)) {
-        SD_LOG_ERR("%s\n", "ERROR: remove_line INDEX OUT-OF-BOUNDS");
-        return false;           
-    }
-#endif
 
-    // reduce counts
-    ctx->line_buffer.v_count -= (2 * attribute_stride);
-    ctx->line_buffer.i_count -= 2;
+template<usize SD_RENDER_BATCH_SIZE> bool Static_Mesh_init(sd::Static_Mesh<SD_RENDER_BATCH_SIZE>* mesh, GLuint program)
+{
+    sd::Render_Batch<SD_RENDER_BATCH_SIZE>* g = &mesh->geometry;
 
-    // overwrite the element-to-delete with the last element
-    memcpy(&ctx->vertices_lines[(2 * attribute_stride) * idx], &ctx->vertices_lines[ctx->line_buffer.v_count], sizeof(GLfloat) * 2 * attribute_stride);
+    sd::cpu_init(g);
 
-    // move the line index back by 2 (for each point in the segment)
-    ctx->index_lines -= 2;
+    mesh->triangle_v_baked = 0;
+    mesh->triangle_i_baked = 0;
+    mesh->line_v_baked     = 0;
+    mesh->line_i_baked     = 0;
 
-    return true;
-}
+    mesh->owns_shader = (program == 0);
+    g->shader.program = program;
+    if (mesh->owns_shader && false == Shader_load_shared_from_file(
+        &g->shader,
+        sd::Render_Batch<SD_RENDER_BATCH_SIZE>::SHADER_VERTEX_PATH,
+        sd::Render_Batch<SD_RENDER_BATCH_SIZE>::SHADER_FRAGMENT_PATH
+    )) {
+        SD_LOG_ERR("%s\n", "ERROR: sd::Static_Mesh initialization failed");
+        return false;
+    }
 
-template<usize SD_RENDER_BATCH_SIZE> bool polygon_convex_regular(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, GLfloat radius, Vec3 center, const usize count_sides)
-{
-    usize count_tris = count_sides - 2;
-
-    usize attribute_stride;
-    usize inc;
-
-    usize v_count = 0;
-    usize i_count = 0;
-    usize v_idx   = 0;
-    GLdouble angle_turn = -(TAU) / count_sides;
-
-    switch (ctx->draw_type) {
-    case GL_TRIANGLES:
-        attribute_stride = ctx->vao_triangles.stride;
-        inc = attribute_stride;
-
-        v_count = ctx->triangle_buffer.v_count;
-        i_count = ctx->triangle_buffer.i_count;
-        v_idx = v_count;
-#ifdef SD_BOUNDS_CHECK
-        if (v_count + (attribute_stride * count_sides) > SD_RENDER_BATCH_SIZE * attribute_stride || i_count + (3 * count_tris) > SD_RENDER_BATCH_SIZE * 2) {
-            SD_LOG_ERR("%s\n", "ERROR: polygon_convex_regular MAX TRIANGLES EXCEEDED");
-            return false;
-        }
-#endif
+    glUseProgram(g->shader);
+    g->MAT_LOC = glGetUniformLocation(g->shader, "u_matrix");
+    glUniformMatrix4fv(g->MAT_LOC, 1, GL_FALSE, glm::value_ptr(Mat4(1.0f)));
+    glUseProgram(0);
 
-        for (usize p = 0, idx_off = 0; p < count_tris; ++p, idx_off += 3) {
-            ctx->indices_triangles[i_count + idx_off]     = ctx->index_triangles + 0;
-            ctx->indices_triangles[i_count + idx_off + 1] = ctx->index_triangles + p + 1;
-            ctx->indices_triangles[i_count + idx_off + 2] = ctx->index_triangles + p + 2;
-        }
-        ctx->triangle_buffer.i_count += (3 * count_tris);
+    VertexAttributeArray* vaos[2]    = {&g->vao_triangles, &g->vao_lines};
+    VertexBufferData*     buffers[2] = {&g->triangle_buffer, &g->line_buffer};
+    foreach (i, 2) {
+        VertexAttributeArray_init(vaos[i], vaos[i]->stride);
+        glBindVertexArray(vaos[i]->vao);
 
+            glGenBuffers(1, &buffers[i]->vbo);
+            glGenBuffers(1, &buffers[i]->ebo);
 
-        for (usize p = 0, off = 0; p < count_sides; ++p, off += inc) {
-            Vec3 point = Vec3(Mat4(1.0f) * 
-                Vec4(
-                    (radius * glm::cos(p * angle_turn)) + center.x,
-                    (radius * glm::sin(p * angle_turn)) + center.y,
-                    center.z,
-                    1.0f
-                )
-            );
+            // storage only, the contents arrive with the first bake
+            glBindBuffer(GL_ARRAY_BUFFER, buffers[i]->vbo);
+            glBufferData(GL_ARRAY_BUFFER, buffers[i]->v_cap * sizeof(GLfloat), NULL, GL_STATIC_DRAW);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[i]->ebo);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, buffers[i]->i_cap * sizeof(GLuint), NULL, GL_STATIC_DRAW);
 
-            ctx->vertices_triangles[v_idx + off]     = point.x;
-            ctx->vertices_triangles[v_idx + off + 1] = point.y;
-            ctx->vertices_triangles[v_idx + off + 2] = point.z;
+            glBindBuffer(GL_ARRAY_BUFFER, buffers[i]->vbo);
+            // POSITION
+            gl_set_and_enable_vertex_attrib_ptr(0, 3, GL_FLOAT, GL_FALSE, 0, vaos[i]);
+            // COLOR
+            gl_set_and_enable_vertex_attrib_ptr(1, 4, GL_FLOAT, GL_FALSE, 3, vaos[i]);
 
-            memcpy(&ctx->vertices_triangles[v_idx + off + 3], &ctx->color[0], sizeof(ctx->color[0]) * 4);
-        }
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
 
-        ctx->triangle_buffer.v_count += (attribute_stride * count_sides);
+    gl_state_invalidate();
 
-        ctx->index_triangles += count_sides;
+    return true;
+}
 
-        break;
-    case GL_LINES:
-        attribute_stride = ctx->vao_lines.stride;
-        inc = attribute_stride;
+// sends [v_begin, v_count) and [i_begin, i_count), the element buffer goes through
+// GL_ARRAY_BUFFER so the bound vertex array is left alone
+static usize static_mesh_upload(VertexBufferData* vbd, const usize v_begin, const usize i_begin)
+{
+    usize bytes = 0;
 
-        v_count = ctx->line_buffer.v_count;
-        i_count = ctx->line_buffer.i_count;
-        v_idx = v_count;
-#ifdef SD_BOUNDS_CHECK
-        if (v_count + (attribute_stride * count_sides) > SD_RENDER_BATCH_SIZE * attribute_stride || i_count + (2 * count_sides) > SD_RENDER_BATCH_SIZE * 2) {
-            SD_LOG_ERR("%s\n", "ERROR: polygon_convex_regular MAX LINES EXCEEDED");
-            return false;
-        }
-#endif
+    if (vbd->v_count > v_begin) {
+        const usize size = (vbd->v_count - v_begin) * sizeof(GLfloat);
+        gl_bind_buffer(GL_ARRAY_BUFFER, vbd->vbo);
+        glBufferSubData(GL_ARRAY_BUFFER, v_begin * sizeof(GLfloat), size, vbd->vertices + v_begin);
+        bytes += size;
+    }
+    if (vbd->i_count > i_begin) {
+        const usize size = (vbd->i_count - i_begin) * sizeof(GLuint);
+        gl_bind_buffer(GL_ARRAY_BUFFER, vbd->ebo);
+        glBufferSubData(GL_ARRAY_BUFFER, i_begin * sizeof(GLuint), size, vbd->indices + i_begin);
+        bytes += size;
+    }
 
-        for (usize p = 0, off = 0; p < count_sides; ++p, off += 2) {
-            ctx->indices_lines[i_count + off]     = ctx->index_lines + p;
-            ctx->indices_lines[i_count + off + 1] = ctx->index_lines + p + 1;
-        }
-        ctx->indices_lines[i_count + (count_sides * 2) - 1] = ctx->index_lines;
-
-        ctx->line_buffer.i_count += (2 * count_sides);
-
-        for (usize p = 0, off = 0; p < count_sides; ++p, off += inc) {
-            Vec3 point = Vec3(Mat4(1.0f) * 
-                Vec4(
-                    (radius * glm::cos(p * angle_turn)) + center.x,
-                    (radius * glm::sin(p * angle_turn)) + center.y,
-                    center.z,
-                    1.0f
-                )
-            );
-            ctx->vertices_lines[v_idx + off]     = point.x;
-            ctx->vertices_lines[v_idx + off + 1] = point.y;
-            ctx->vertices_lines[v_idx + off + 2] = point.z;
+    return bytes;
+}
 
-            memcpy(&ctx->vertices_lines[v_idx + off + 3], &ctx->color[0], sizeof(ctx->color[0]) * 4);
-        }
+template<usize SD_RENDER_BATCH_SIZE> usize Static_Mesh_bake(sd::Static_Mesh<SD_RENDER_BATCH_SIZE>* mesh)
+{
+    sd::Render_Batch<SD_RENDER_BATCH_SIZE>* g = &mesh->geometry;
 
-        ctx->line_buffer.v_count += (attribute_stride * count_sides);          
+    usize bytes = 0;
 
-        ctx->index_lines += count_sides; 
+    bytes += static_mesh_upload(&g->triangle_buffer, mesh->triangle_v_baked, mesh->triangle_i_baked);
+    bytes += static_mesh_upload(&g->line_buffer, mesh->line_v_baked, mesh->line_i_baked);
 
-        break;
-    }
+    mesh->triangle_v_baked = g->triangle_buffer.v_count;
+    mesh->triangle_i_baked = g->triangle_buffer.i_count;
+    mesh->line_v_baked     = g->line_buffer.v_count;
+    mesh->line_i_baked     = g->line_buffer.i_count;
 
-    return true;
+    return bytes;
 }
 
-template<usize SD_RENDER_BATCH_SIZE> bool polygon_convex_regular(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, GLfloat radius, Vec2 center, const usize count_sides)
+template<usize SD_RENDER_BATCH_SIZE> void Static_Mesh_reset(sd::Static_Mesh<SD_RENDER_BATCH_SIZE>* mesh)
 {
-    return sd::polygon_convex_regular(ctx, radius, Vec3(center, 1.0), count_sides);
-}
+    mesh->geometry.reset(&mesh->geometry);
 
-template<usize SD_RENDER_BATCH_SIZE> bool circle(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, GLfloat radius, Vec3 center, usize detail)
-{
-    return sd::polygon_convex_regular(ctx, radius, center, detail);
+    mesh->triangle_v_baked = 0;
+    mesh->triangle_i_baked = 0;
+    mesh->line_v_baked     = 0;
+    mesh->line_i_baked     = 0;
 }
 
-template<usize SD_RENDER_BATCH_SIZE> bool circle(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, GLfloat radius, Vec2 center, usize detail)
+template<usize SD_RENDER_BATCH_SIZE> bool Static_Mesh_remove_line_swap_end(sd::Static_Mesh<SD_RENDER_BATCH_SIZE>* mesh, usize idx)
 {
-    return sd::polygon_convex_regular(ctx, radius, center, detail);
+    if (!sd::remove_line_swap_end(&mesh->geometry, idx)) {
+        return false;
+    }
+
+    // only the overwritten segment is stale, the indices are sequential and stay valid
+    mesh->line_v_baked = glm::min(mesh->line_v_baked, (usize)(idx * 2 * mesh->geometry.vao_lines.stride));
+
+    return true;
 }
 
-template<usize SD_RENDER_BATCH_SIZE> bool vertex(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec3 v)
+template<usize SD_RENDER_BATCH_SIZE> void Static_Mesh_draw(sd::Static_Mesh<SD_RENDER_BATCH_SIZE>* mesh, Render_Context* ctx, const Mat4& transform)
 {
-    usize v_count = 0;
-    usize i_count = 0;
-    usize v_idx = 0;
-
-    usize attribute_stride;
-
-    switch (ctx->draw_type) {
-    case GL_TRIANGLES:
-        attribute_stride = ctx->vao_triangles.stride;
-
-        v_count = ctx->triangle_buffer.v_count;
-        i_count = ctx->triangle_buffer.i_count;
-        v_idx = v_count;
-#ifdef SD_BOUNDS_CHECK
-        if (v_count + attribute_stride > SD_RENDER_BATCH_SIZE * attribute_stride || i_count + 1 > SD_RENDER_BATCH_SIZE * 2) {
-            SD_LOG_ERR("%s\n", "ERROR: vertex MAX TRIANGLES EXCEEDED");
-            return false;
-        }
-#endif
-
-        memcpy(&ctx->vertices_triangles[v_idx], &v[0], sizeof(v[0]) * 3);
-        memcpy(&ctx->vertices_triangles[v_idx + 3], &ctx->color[0], sizeof(ctx->color[0]) * 4);
+    sd::Render_Batch<SD_RENDER_BATCH_SIZE>* g = &mesh->geometry;
 
-        ctx->indices_triangles[i_count] = ctx->index_triangles;
-        ctx->index_triangles += 1;
+    Static_Mesh_bake(mesh);
 
-        ctx->triangle_buffer.v_count += attribute_stride;
-        ctx->triangle_buffer.i_count += 1;
+    if (g->triangle_buffer.i_count == 0 && g->line_buffer.i_count == 0) {
+        return;
+    }
 
-        break;
-    case GL_LINES:
-        attribute_stride = ctx->vao_lines.stride;
+    if (ctx == nullptr) {
+        gl_use_program(g->shader);
+        gl_uniform_matrix4fv(g->MAT_LOC, glm::value_ptr(transform));
 
-        v_count = ctx->line_buffer.v_count;
-        i_count = ctx->line_buffer.i_count;
-        v_idx = v_count;
-#ifdef SD_BOUNDS_CHECK
-        if (v_count + attribute_stride > SD_RENDER_BATCH_SIZE * attribute_stride || i_count + 1 > SD_RENDER_BATCH_SIZE * 2) {
-            SD_LOG_ERR("%s\n", "ERROR: vertex MAX LINES EXCEEDED");
-            return false;
+        if (g->triangle_buffer.i_count > 0) {
+            gl_bind_vertex_array(g->vao_triangles);
+            glDrawElements(GL_TRIANGLES, g->triangle_buffer.i_count, GL_UNSIGNED_INT, 0);
+        }
+        if (g->line_buffer.i_count > 0) {
+            gl_bind_vertex_array(g->vao_lines);
+            glDrawElements(GL_LINES, g->line_buffer.i_count, GL_UNSIGNED_INT, 0);
         }
-#endif
-
-        memcpy(&ctx->vertices_lines[v_idx], &v[0], sizeof(v[0]) * 3);
-        memcpy(&ctx->vertices_lines[v_idx + 3], &ctx->color[0], sizeof(ctx->color[0]) * 4);
-
-        ctx->indices_lines[i_count] = ctx->index_lines;
-        ctx->index_lines += 1;
-
-        ctx->line_buffer.v_count += attribute_stride;
-        ctx->line_buffer.i_count += 1;
 
-        break;
+        return;
     }
 
-    return true;      
-}
-
-template<usize SD_RENDER_BATCH_SIZE> bool vertex(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec2 v)
-{
-    return sd::vertex(ctx, Vec3(v, 1.0));
-}
+    // no Render_Context_upload, the buffers already hold everything
+    Draw_Command cmd = {};
+    cmd.type         = DRAW_COMMAND_TYPE::ELEMENTS;
+    cmd.program      = g->shader;
+    cmd.mat_loc      = g->MAT_LOC;
+    cmd.matrix_index = Render_Context_push_matrix(ctx, transform);
+
+    if (g->triangle_buffer.i_count > 0) {
+        cmd.vao       = g->vao_triangles;
+        cmd.primitive = GL_TRIANGLES;
+        if (g->cull) {
+            g->triangle_bounded = cull_chunks_update(g->triangle_chunks, &g->triangle_buffer, g->vao_triangles.stride, g->triangle_bounded);
+            cull_chunks_submit(ctx, &cmd, g->triangle_chunks, 0, g->triangle_buffer.i_count, g->cull_min, g->cull_max);
+        } else {
+            cmd.count  = g->triangle_buffer.i_count;
+            cmd.offset = 0;
+            Render_Context_submit(ctx, &cmd);
+        }
+    }
 
-template<usize SD_RENDER_BATCH_SIZE> inline void color(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx, Vec4 color)
-{
-    ctx->color = color;
+    if (g->line_buffer.i_count > 0) {
+        cmd.vao       = g->vao_lines;
+        cmd.primitive = GL_LINES;
+        if (g->cull) {
+            g->line_bounded = cull_chunks_update(g->line_chunks, &g->line_buffer, g->vao_lines.stride, g->line_bounded);
+            cull_chunks_submit(ctx, &cmd, g->line_chunks, 0, g->line_buffer.i_count, g->cull_min, g->cull_max);
+        } else {
+            cmd.count  = g->line_buffer.i_count;
+            cmd.offset = 0;
+            Render_Context_submit(ctx, &cmd);
+        }
+    }
 }
 
-template<usize SD_RENDER_BATCH_SIZE> inline void push_context(sd::Render_Batch<SD_RENDER_BATCH_SIZE>* ctx)
+template<usize SD_RENDER_BATCH_SIZE> void Static_Mesh_free(sd::Static_Mesh<SD_RENDER_BATCH_SIZE>* mesh)
 {
-    // TODO
+    sd::Render_Batch<SD_RENDER_BATCH_SIZE>* g = &mesh->geometry;
+
+    VertexAttributeArray_delete(&g->vao_triangles);
+    VertexAttributeArray_delete(&g->vao_lines);
+    VertexBufferData_delete_inplace(&g->triangle_buffer);
+    VertexBufferData_delete_inplace(&g->line_buffer);
+    if (mesh->owns_shader) {
+        Shader_release(&g->shader);
+    }
 }
 
 
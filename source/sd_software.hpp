@@ -0,0 +1,107 @@
+#ifndef SD_SOFTWARE_HPP
+#define SD_SOFTWARE_HPP
+
+// strato-draw on the CPU next to the GL backend: Software_Render_Batch builds its buffers
+// with the shared geometry code and end() rasterizes them into a Software_Renderer,
+// see software_raster.hpp, the GL headers are only needed for the types
+#if !(UNITY_BUILD)
+#include "common_utils_cpp.hpp"
+
+#include "opengl.hpp"
+#include "sd.hpp"
+#include "software_raster.hpp"
+#endif
+
+namespace sd {
+
+template <usize SD_RENDER_BATCH_SIZE = 2048>
+struct Software_Render_Batch {
+    // set up with sd::cpu_init, no GL objects are created,
+    // use the sd:: functions on it for anything the wrappers below do not cover
+    sd::Render_Batch<SD_RENDER_BATCH_SIZE> geometry;
+
+    Software_Renderer* target;
+    // there is no Frame_Data block on the CPU, the projection is applied per batch
+    Mat4 projection;
+
+    void begin(void)
+    {
+        geometry.begin();
+    }
+
+    void draw(void)
+    {
+        sd::Render_Batch<SD_RENDER_BATCH_SIZE>* g = &geometry;
+
+        const Mat4 mvp = projection * g->transform_matrix;
+
+        // the rasterizer only visits covered tiles, so the cull rectangle is not used
+        if (g->triangle_buffer.i_count > 0) {
+            Software_Renderer_draw_colored(target, mvp, GL_TRIANGLES, g->vertices_triangles, g->vao_triangles.stride, g->indices_triangles, g->triangle_buffer.i_count);
+        }
+        if (g->line_buffer.i_count > 0) {
+            Software_Renderer_draw_colored(target, mvp, GL_LINES, g->vertices_lines, g->vao_lines.stride, g->indices_lines, g->line_buffer.i_count);
+        }
+    }
+
+    void end(void)
+    {
+        assert(geometry.begun == true);
+
+        draw();
+        geometry.reset(&geometry);
+
+        geometry.begun = false;
+    }
+
+    void end_no_reset(void)
+    {
+        assert(geometry.begun == true);
+
+        draw();
+
+        geometry.begun = false;
+    }
+
+    bool init(Software_Renderer* target, const Mat4& projection)
+    {
+        sd::cpu_init(&geometry);
+        this->target     = target;
+        this->projection = projection;
+
+        return true;
+    }
+
+    void free(void)
+    {
+    }
+
+    bool line(Vec3 a, Vec3 b)
+    {
+        return sd::line(&geometry, a, b);
+    }
+
+    bool line(Vec2 a, Vec2 b)
+    {
+        return sd::line(&geometry, a, b);
+    }
+
+    bool polygon_convex_regular(GLfloat radius, Vec3 center, const usize count_sides)
+    {
+        return sd::polygon_convex_regular(&geometry, radius, center, count_sides);
+    }
+
+    bool circle(GLfloat radius, Vec3 center, usize detail = 37)
+    {
+        return polygon_convex_regular(radius, center, detail);
+    }
+
+    bool vertex(Vec3 v)
+    {
+        return sd::vertex(&geometry, v);
+    }
+};
+
+}
+
+#endif // SD_SOFTWARE_HPP
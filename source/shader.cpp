@@ -2,30 +2,328 @@
     #include "shader.hpp"
 #endif
 
+#ifdef __linux__
+    #include <sys/inotify.h>
+#endif
+
 using namespace file_io;
 
-bool Shader_load_from_file(Shader* shader, const std::string& vertex_path, const std::string& fragment_path,
-                        const std::string& vert_addons,
-                        const std::string& frag_addons) 
+// SOURCE CACHE
+// every file read by the preprocessor stays cached so that shared includes are read once,
+// the index of a file is its bit in the dependency masks
+struct Shader_Source_File {
+    char        path[SHADER_PATH_MAX];
+    std::string text;
+    time_t      mtime;
+};
+
+static Shader_Source_File shader_files[SHADER_MAX_SOURCE_FILES];
+static u32                shader_file_count;
+
+// programs loaded from files, with the files they depend on
+struct Shader_Watched_Program {
+    GLuint      program;
+    char        vertex_path[SHADER_PATH_MAX];
+    char        fragment_path[SHADER_PATH_MAX];
+    std::string vert_addons;
+    std::string frag_addons;
+    u64         deps;
+
+    // a relink in flight, built in a scratch program so that a broken edit never touches the live one
+    GLuint      pending;
+    GLuint      pending_shaders[2];
+    u64         pending_cache_key;
+};
+
+static Shader_Watched_Program shader_programs[SHADER_MAX_WATCHED_PROGRAMS];
+
+#define SHADER_WATCH_MAX_DIRS (16)
+// frames between modification time scans where there is no inotify
+#define SHADER_WATCH_POLL_INTERVAL (30)
+
+struct Shader_Watcher {
+    bool active;
+    u32  poll_count;
+#ifdef __linux__
+    int  fd;
+    int  wds[SHADER_WATCH_MAX_DIRS];
+    char dirs[SHADER_WATCH_MAX_DIRS][SHADER_PATH_MAX];
+    u32  dir_count;
+#endif
+    bool parallel_compile;
+};
+
+static Shader_Watcher shader_watcher;
+
+static time_t shader_file_mtime(const char* path)
+{
+    struct stat info;
+    return (stat(path, &info) == 0) ? info.st_mtime : 0;
+}
+
+// collapses "." and "dir/.." so that every path to a file compares equal
+static void shader_path_normalize(char* out, const usize cap, const char* path)
+{
+    char buf[SHADER_PATH_MAX];
+    snprintf(buf, sizeof(buf), "%s", path);
+
+    const char* segments[64];
+    u32 count = 0;
+    for (char* seg = strtok(buf, "/"); seg != nullptr; seg = strtok(nullptr, "/")) {
+        if (strcmp(seg, ".") == 0) {
+            continue;
+        }
+        if (strcmp(seg, "..") == 0 && count > 0 && strcmp(segments[count - 1], "..") != 0) {
+            count -= 1;
+            continue;
+        }
+        if (count < StaticArrayCount(segments)) {
+            segments[count] = seg;
+            count += 1;
+        }
+    }
+
+    usize len = snprintf(out, cap, "%s", (path[0] == '/') ? "/" : "");
+    for (u32 i = 0; i < count && len < cap; i += 1) {
+        len += snprintf(out + len, cap - len, (i == 0) ? "%s" : "/%s", segments[i]);
+    }
+}
+
+static void shader_watch_dir_of(const char* path)
+{
+#ifdef __linux__
+    if (!shader_watcher.active) {
+        return;
+    }
+
+    char dir[SHADER_PATH_MAX];
+    const char* slash = strrchr(path, '/');
+    if (slash == nullptr) {
+        snprintf(dir, sizeof(dir), ".");
+    } else {
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+    }
+
+    foreach (i, shader_watcher.dir_count) {
+        if (strcmp(shader_watcher.dirs[i], dir) == 0) {
+            return;
+        }
+    }
+    if (shader_watcher.dir_count == SHADER_WATCH_MAX_DIRS) {
+        fprintf(stderr, "WARNING: shader hot reload watches at most %d directories, %s is not watched\n", SHADER_WATCH_MAX_DIRS, dir);
+        return;
+    }
+
+    // editors either rewrite the file or rename a new one over it
+    const int wd = inotify_add_watch(shader_watcher.fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0) {
+        fprintf(stderr, "WARNING: could not watch %s: %s\n", dir, strerror(errno));
+        return;
+    }
+    shader_watcher.wds[shader_watcher.dir_count] = wd;
+    strcpy(shader_watcher.dirs[shader_watcher.dir_count], dir);
+    shader_watcher.dir_count += 1;
+#else
+    (void)path;
+#endif
+}
+
+// index of the cached file, read on first use, -1 if it cannot be read
+static i32 shader_file_get(const char* path)
 {
+    char norm[SHADER_PATH_MAX];
+    shader_path_normalize(norm, sizeof(norm), path);
+
+    foreach (i, shader_file_count) {
+        if (strcmp(shader_files[i].path, norm) == 0) {
+            return (i32)i;
+        }
+    }
+
+    if (shader_file_count == SHADER_MAX_SOURCE_FILES) {
+        fprintf(stderr, "ERROR: the shader source cache holds at most %d files, %s\n", SHADER_MAX_SOURCE_FILES, norm);
+        return -1;
+    }
 
     bool status = false;
-    std::string vs = Shader_retrieve_src_from_file(vertex_path.c_str(), &status);
+    std::string text = Shader_retrieve_src_from_file(norm, &status);
     if (!status) {
+        fprintf(stderr, "ERROR: could not read shader source %s\n", norm);
+        return -1;
+    }
+
+    Shader_Source_File* file = &shader_files[shader_file_count];
+    strcpy(file->path, norm);
+    file->text.swap(text);
+    file->mtime = shader_file_mtime(norm);
+
+    shader_watch_dir_of(norm);
+
+    shader_file_count += 1;
+    return (i32)(shader_file_count - 1);
+}
+
+// expands #include "path" lines, the path is relative to the including file,
+// a file already pulled into this stage is skipped, every file read is added to *deps.
+// #line directives name the file by its cache index, printed alongside compile errors
+static bool shader_preprocess(const i32 file, std::string* out, u64* deps, const u32 depth)
+{
+    if (depth > SHADER_MAX_INCLUDE_DEPTH) {
+        fprintf(stderr, "ERROR: %s, #include nested deeper than %d\n", shader_files[file].path, SHADER_MAX_INCLUDE_DEPTH);
         return false;
     }
-    std::string fs = Shader_retrieve_src_from_file(fragment_path.c_str(), &status);
-    if (!status) {
+
+    *deps |= (1ull << file);
+
+    const char* path = shader_files[file].path;
+    const std::string& text = shader_files[file].text;
+
+    usize line_begin  = 0;
+    u32   line_number = 1;
+    while (line_begin < text.size()) {
+        usize line_end = text.find('\n', line_begin);
+        if (line_end == std::string::npos) {
+            line_end = text.size();
+        }
+
+        usize k = line_begin;
+        while (k < line_end && (text[k] == ' ' || text[k] == '\t')) {
+            k += 1;
+        }
+
+        if (text.compare(k, 8, "#include") == 0) {
+            const usize q0 = text.find('"', k);
+            const usize q1 = (q0 == std::string::npos) ? std::string::npos : text.find('"', q0 + 1);
+            if (q1 == std::string::npos || q1 > line_end) {
+                fprintf(stderr, "ERROR: %s:%u malformed #include\n", path, line_number);
+                return false;
+            }
+
+            const char* slash = strrchr(path, '/');
+            const int dir_len = (slash == nullptr) ? 0 : (int)(slash - path + 1);
+            char include_path[SHADER_PATH_MAX];
+            snprintf(include_path, sizeof(include_path), "%.*s%.*s", dir_len, path, (int)(q1 - q0 - 1), text.c_str() + q0 + 1);
+
+            const i32 include = shader_file_get(include_path);
+            if (include < 0) {
+                fprintf(stderr, "ERROR: %s:%u could not include %s\n", path, line_number, include_path);
+                return false;
+            }
+
+            if ((*deps & (1ull << include)) == 0) {
+                *out += "#line 1 " + std::to_string(include) + "\n";
+                if (!shader_preprocess(include, out, deps, depth + 1)) {
+                    return false;
+                }
+                *out += "\n#line " + std::to_string(line_number + 1) + " " + std::to_string(file) + "\n";
+            }
+        } else {
+            out->append(text, line_begin, line_end - line_begin);
+            out->push_back('\n');
+
+            // nothing may come before #version
+            if (depth == 0 && text.compare(k, 8, "#version") == 0) {
+                *out += "#line " + std::to_string(line_number + 1) + " " + std::to_string(file) + "\n";
+            }
+        }
+
+        line_begin  = line_end + 1;
+        line_number += 1;
+    }
+
+    return true;
+}
+
+static bool shader_expand_files(const char* vertex_path, const char* fragment_path, std::string* vs, std::string* fs, u64* deps)
+{
+    const i32 vertex_file = shader_file_get(vertex_path);
+    if (vertex_file < 0) {
+        return false;
+    }
+    const i32 fragment_file = shader_file_get(fragment_path);
+    if (fragment_file < 0) {
+        return false;
+    }
+
+    u64 vertex_deps   = 0;
+    u64 fragment_deps = 0;
+    if (!shader_preprocess(vertex_file, vs, &vertex_deps, 0) ||
+        !shader_preprocess(fragment_file, fs, &fragment_deps, 0)) {
+        return false;
+    }
+
+    *deps = vertex_deps | fragment_deps;
+    return true;
+}
+
+// inserts the addons in front of main, as Shader_load_from_src does
+static bool shader_insert_addons(std::string* src, const std::string& addons)
+{
+    if (addons.length() == 0) {
+        return true;
+    }
+
+    std::string::size_type main_idx = src->find("void main(");
+    if (main_idx == std::string::npos) {
         return false;
-    } 
+    }
+    src->insert(main_idx, addons);
+    return true;
+}
+
+static void shader_watch_program(const GLuint program, const char* vertex_path, const char* fragment_path,
+                        const std::string& vert_addons, const std::string& frag_addons, const u64 deps)
+{
+    Shader_Watched_Program* slot = nullptr;
+    foreach (i, SHADER_MAX_WATCHED_PROGRAMS) {
+        Shader_Watched_Program* entry = &shader_programs[i];
+        // a deleted program's name can be handed out again
+        if (entry->program == program) {
+            slot = entry;
+            break;
+        }
+        if (slot == nullptr && entry->program == 0) {
+            slot = entry;
+        }
+    }
+    if (slot == nullptr) {
+        return;
+    }
+
+    slot->program = program;
+    snprintf(slot->vertex_path, sizeof(slot->vertex_path), "%s", vertex_path);
+    snprintf(slot->fragment_path, sizeof(slot->fragment_path), "%s", fragment_path);
+    slot->vert_addons = vert_addons;
+    slot->frag_addons = frag_addons;
+    slot->deps        = deps;
+    slot->pending     = 0;
+}
+
+static void shader_unwatch_program(const GLuint program);
+
+bool Shader_load_from_file(Shader* shader, const std::string& vertex_path, const std::string& fragment_path,
+                        const std::string& vert_addons,
+                        const std::string& frag_addons) 
+{
+    std::string vs;
+    std::string fs;
+    u64 deps = 0;
+    if (!shader_expand_files(vertex_path.c_str(), fragment_path.c_str(), &vs, &fs, &deps)) {
+        return false;
+    }
     
-    return Shader_load_from_src(
+    if (!Shader_load_from_src(
         shader,
         vs,
         fs,
         vert_addons,
         frag_addons
-    );
+    )) {
+        return false;
+    }
+
+    shader_watch_program(shader->program, vertex_path.c_str(), fragment_path.c_str(), vert_addons, frag_addons, deps);
+    return true;
 }
 
 bool Shader_load_from_src(Shader* shader, const std::string& vertex_src, const std::string& fragment_src,
@@ -37,19 +335,15 @@ bool Shader_load_from_src(Shader* shader, const std::string& vertex_src, const s
     
     if (vert_addons.length() > 0) {
         vertex_combined = vertex_src;
-        std::string::size_type main_idx = vertex_combined.find("void main(");
-        if (main_idx == std::string::npos) {
+        if (!shader_insert_addons(&vertex_combined, vert_addons)) {
             return false;
         }
-        vertex_combined.insert(main_idx, vert_addons);
     }
     if (frag_addons.length() > 0) {
         fragment_combined = fragment_src;
-        std::string::size_type main_idx = fragment_combined.find("void main(");
-        if (main_idx == std::string::npos) {
+        if (!shader_insert_addons(&fragment_combined, frag_addons)) {
             return false;
         }
-        fragment_combined.insert(main_idx, frag_addons);
     }
         
     return Shader_init_program(
@@ -59,8 +353,125 @@ bool Shader_load_from_src(Shader* shader, const std::string& vertex_src, const s
     );
 }
 
+// -1 unknown, 0 no binary formats, 1 usable
+static i32 shader_cache_state = -1;
+static u64 shader_cache_driver_hash;
+
+static bool shader_cache_enabled(void)
+{
+    if (shader_cache_state == -1) {
+        GLint format_count = 0;
+        if (GLEW_ARB_get_program_binary) {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+        }
+        shader_cache_state = (format_count > 0) ? 1 : 0;
+
+        const GLenum names[3] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+        shader_cache_driver_hash = 0;
+        foreach (i, 3) {
+            const char* str = (const char*)glGetString(names[i]);
+            if (str != nullptr) {
+                shader_cache_driver_hash = hash_mix(shader_cache_driver_hash, hash_bytes(str, strlen(str)));
+            }
+        }
+    }
+
+    return shader_cache_state == 1;
+}
+
+static void shader_cache_path(char* out, const usize cap, const u64 key)
+{
+    snprintf(out, cap, SHADER_CACHE_DIR "%016llx.bin", (unsigned long long)key);
+}
+
+static bool shader_cache_load(Shader* shader, const u64 key)
+{
+    char path[128];
+    shader_cache_path(path, sizeof(path), key);
+
+    FILE* in = fopen(path, "rb");
+    if (in == nullptr) {
+        return false;
+    }
+
+    Shader_Cache_File_Header header;
+    if (fread(&header, sizeof(header), 1, in) != 1 ||
+        header.magic != SHADER_CACHE_MAGIC || header.key != key || header.length == 0) {
+        fclose(in);
+        return false;
+    }
+
+    void* binary = xmalloc(header.length);
+    const bool read = fread(binary, header.length, 1, in) == 1;
+    fclose(in);
+    if (!read) {
+        ::free(binary);
+        return false;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, binary, header.length);
+    ::free(binary);
+
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success != GL_TRUE) {
+        gl_state_forget_program(program);
+        glDeleteProgram(program);
+        return false;
+    }
+
+    shader->program = program;
+    return true;
+}
+
+static void shader_cache_store(Shader* shader, const u64 key)
+{
+    GLint length = 0;
+    glGetProgramiv(shader->program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    void* binary = xmalloc(length);
+    Shader_Cache_File_Header header = {};
+    header.magic = SHADER_CACHE_MAGIC;
+    header.key   = key;
+    GLsizei written = 0;
+    glGetProgramBinary(shader->program, length, &written, &header.format, binary);
+    header.length = (u32)written;
+
+    char path[128];
+    shader_cache_path(path, sizeof(path), key);
+
+    FILE* out = (written > 0) ? fopen(path, "wb") : nullptr;
+    if (out != nullptr) {
+        const bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+                        fwrite(binary, written, 1, out) == 1;
+        fclose(out);
+        if (!ok) {
+            fprintf(stderr, "WARNING: could not write the program binary %s\n", path);
+            remove(path);
+        }
+    }
+
+    ::free(binary);
+}
+
+static u64 shader_source_key(const GLchar* vertex_src, const GLchar* fragment_src)
+{
+    return hash_mix(hash_bytes(vertex_src, strlen(vertex_src)), hash_bytes(fragment_src, strlen(fragment_src)));
+}
+
 bool Shader_init_program(Shader* shader, const GLchar* vertex_src, const GLchar* fragment_src)
 {	
+    const bool use_cache = shader_cache_enabled();
+    const u64  cache_key = hash_mix(shader_source_key(vertex_src, fragment_src), shader_cache_driver_hash);
+    if (use_cache && shader_cache_load(shader, cache_key)) {
+        Shader_bind_frame_data(shader);
+        return true;
+    }
+
     // for error checking:
     GLchar info_log[512];
     GLint success = GL_FALSE;
@@ -104,6 +515,9 @@ bool Shader_init_program(Shader* shader, const GLchar* vertex_src, const GLchar*
     glAttachShader(shader->program, vertex_shader);
     // attach fragment shader
     glAttachShader(shader->program, fragment_shader);
+    if (use_cache) {
+        glProgramParameteri(shader->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     // link the program
     glLinkProgram(shader->program);
     
@@ -120,10 +534,90 @@ bool Shader_init_program(Shader* shader, const GLchar* vertex_src, const GLchar*
     
     glDeleteShader(vertex_shader);
     glDeleteShader(fragment_shader);
+
+    if (use_cache) {
+        shader_cache_store(shader, cache_key);
+    }
+
+    Shader_bind_frame_data(shader);
     
     return true;  
 }
 
+#define SHADER_SHARED_MAX (32)
+
+struct Shader_Shared_Entry {
+    u64    key;
+    GLuint program;
+    u32    ref_count;
+};
+
+static Shader_Shared_Entry shader_shared[SHADER_SHARED_MAX];
+
+bool Shader_load_shared_from_file(Shader* shader, const std::string& vertex_path, const std::string& fragment_path)
+{
+    std::string vs;
+    std::string fs;
+    u64 deps = 0;
+    if (!shader_expand_files(vertex_path.c_str(), fragment_path.c_str(), &vs, &fs, &deps)) {
+        return false;
+    }
+
+    const u64 key = shader_source_key(vs.c_str(), fs.c_str());
+
+    Shader_Shared_Entry* free_entry = nullptr;
+    foreach (i, SHADER_SHARED_MAX) {
+        Shader_Shared_Entry* entry = &shader_shared[i];
+        if (entry->ref_count == 0) {
+            free_entry = (free_entry == nullptr) ? entry : free_entry;
+        } else if (entry->key == key) {
+            entry->ref_count += 1;
+            shader->program = entry->program;
+            return true;
+        }
+    }
+
+    if (!Shader_load_from_src(shader, vs, fs)) {
+        return false;
+    }
+    shader_watch_program(shader->program, vertex_path.c_str(), fragment_path.c_str(), "", "", deps);
+
+    // a full table just means this program is not shared
+    if (free_entry != nullptr) {
+        free_entry->key       = key;
+        free_entry->program   = shader->program;
+        free_entry->ref_count = 1;
+    }
+
+    return true;
+}
+
+void Shader_release(Shader* shader)
+{
+    if (shader->program == 0) {
+        return;
+    }
+
+    foreach (i, SHADER_SHARED_MAX) {
+        Shader_Shared_Entry* entry = &shader_shared[i];
+        if (entry->ref_count != 0 && entry->program == shader->program) {
+            entry->ref_count -= 1;
+            if (entry->ref_count == 0) {
+                shader_unwatch_program(entry->program);
+                gl_state_forget_program(entry->program);
+                glDeleteProgram(entry->program);
+            }
+            shader->program = 0;
+            return;
+        }
+    }
+
+    shader_unwatch_program(shader->program);
+    gl_state_forget_program(shader->program);
+    glDeleteProgram(shader->program);
+    shader->program = 0;
+}
+
 std::string Shader_retrieve_src_from_file(const GLchar* path, bool* is_valid)
 {
     FILE* shader_fd = fopen(path, "r");
@@ -142,3 +636,448 @@ std::string Shader_retrieve_src_from_file(const GLchar* path, bool* is_valid)
 
     return out;
 }
+
+void Shader_bind_frame_data(Shader* shader)
+{
+    GLuint block_index = glGetUniformBlockIndex(shader->program, "Frame_Data");
+    if (block_index == GL_INVALID_INDEX) {
+        return;
+    }
+
+    glUniformBlockBinding(shader->program, block_index, FRAME_DATA_BINDING);
+}
+
+bool Frame_Uniform_Buffer_init(Frame_Uniform_Buffer* buffer)
+{
+    glGenBuffers(1, &buffer->ubo);
+    if (buffer->ubo == 0) {
+        fprintf(stderr, "%s\n", "ERROR: FRAME UNIFORM BUFFER CREATION FAILED");
+        return false;
+    }
+
+    gl_bind_buffer(GL_UNIFORM_BUFFER, buffer->ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Frame_Data), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, buffer->ubo);
+
+    return true;
+}
+
+void Frame_Uniform_Buffer_update(Frame_Uniform_Buffer* buffer, const Frame_Data* data)
+{
+    gl_bind_buffer(GL_UNIFORM_BUFFER, buffer->ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Frame_Data), data);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, buffer->ubo);
+}
+
+void Frame_Uniform_Buffer_delete(Frame_Uniform_Buffer* buffer)
+{
+    glDeleteBuffers(1, &buffer->ubo);
+    buffer->ubo = 0;
+}
+
+// HOT RELOAD
+
+static void shader_unwatch_program(const GLuint program)
+{
+    foreach (i, SHADER_MAX_WATCHED_PROGRAMS) {
+        Shader_Watched_Program* entry = &shader_programs[i];
+        if (entry->program != program) {
+            continue;
+        }
+
+        if (entry->pending != 0) {
+            gl_state_forget_program(entry->pending);
+            glDeleteProgram(entry->pending);
+            glDeleteShader(entry->pending_shaders[0]);
+            glDeleteShader(entry->pending_shaders[1]);
+            entry->pending = 0;
+        }
+        entry->program = 0;
+        return;
+    }
+}
+
+// uniform values are reset by a relink, they are read back before and set again after by name
+#define SHADER_MAX_SAVED_UNIFORMS (256)
+
+struct Shader_Saved_Uniform {
+    char    name[64];
+    GLenum  type;
+    GLint   i[4];
+    GLfloat f[16];
+};
+
+static Shader_Saved_Uniform shader_saved_uniforms[SHADER_MAX_SAVED_UNIFORMS];
+
+// 0 not carried over, 1 float data, 2 integer data
+static u32 shader_uniform_kind(const GLenum type)
+{
+    switch (type) {
+    case GL_FLOAT:
+    case GL_FLOAT_VEC2:
+    case GL_FLOAT_VEC3:
+    case GL_FLOAT_VEC4:
+    case GL_FLOAT_MAT3:
+    case GL_FLOAT_MAT4:
+        return 1;
+    case GL_INT:
+    case GL_BOOL:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+static u32 shader_uniforms_save(const GLuint program)
+{
+    GLint active = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &active);
+
+    u32 count = 0;
+    for (GLint u = 0; u < active; u += 1) {
+        char   name[64];
+        GLint  size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, u, sizeof(name), nullptr, &size, &type, name);
+
+        const u32 kind = shader_uniform_kind(type);
+        if (kind == 0) {
+            continue;
+        }
+
+        // arrays are listed once as name[0]
+        char* bracket = strchr(name, '[');
+        if (bracket != nullptr) {
+            *bracket = '\0';
+        }
+
+        for (GLint e = 0; e < size && count < SHADER_MAX_SAVED_UNIFORMS; e += 1) {
+            Shader_Saved_Uniform* saved = &shader_saved_uniforms[count];
+            if (bracket != nullptr) {
+                snprintf(saved->name, sizeof(saved->name), "%s[%d]", name, e);
+            } else {
+                snprintf(saved->name, sizeof(saved->name), "%s", name);
+            }
+
+            // members of uniform blocks have no location
+            const GLint location = glGetUniformLocation(program, saved->name);
+            if (location < 0) {
+                continue;
+            }
+
+            saved->type = type;
+            if (kind == 1) {
+                glGetUniformfv(program, location, saved->f);
+            } else {
+                glGetUniformiv(program, location, saved->i);
+            }
+            count += 1;
+        }
+    }
+
+    return count;
+}
+
+// program must be in use
+static void shader_uniforms_restore(const GLuint program, const u32 count)
+{
+    foreach (u, count) {
+        const Shader_Saved_Uniform* saved = &shader_saved_uniforms[u];
+
+        const GLint location = glGetUniformLocation(program, saved->name);
+        if (location < 0) {
+            continue;
+        }
+
+        switch (saved->type) {
+        case GL_FLOAT:      glUniform1fv(location, 1, saved->f);                  break;
+        case GL_FLOAT_VEC2: glUniform2fv(location, 1, saved->f);                  break;
+        case GL_FLOAT_VEC3: glUniform3fv(location, 1, saved->f);                  break;
+        case GL_FLOAT_VEC4: glUniform4fv(location, 1, saved->f);                  break;
+        case GL_FLOAT_MAT3: glUniformMatrix3fv(location, 1, GL_FALSE, saved->f); break;
+        case GL_FLOAT_MAT4: glUniformMatrix4fv(location, 1, GL_FALSE, saved->f); break;
+        default:            glUniform1iv(location, 1, saved->i);                  break;
+        }
+    }
+}
+
+static void shader_reload_begin(Shader_Watched_Program* entry)
+{
+    // deleted without Shader_release
+    if (!glIsProgram(entry->program)) {
+        shader_unwatch_program(entry->program);
+        return;
+    }
+
+    std::string vs;
+    std::string fs;
+    u64 deps = 0;
+    if (!shader_expand_files(entry->vertex_path, entry->fragment_path, &vs, &fs, &deps) ||
+        !shader_insert_addons(&vs, entry->vert_addons) || !shader_insert_addons(&fs, entry->frag_addons)) {
+        fprintf(stderr, "ERROR: shader reload %s + %s, keeping the previous program\n", entry->vertex_path, entry->fragment_path);
+        return;
+    }
+
+    // a newer edit replaces a relink still in flight
+    if (entry->pending != 0) {
+        gl_state_forget_program(entry->pending);
+        glDeleteProgram(entry->pending);
+        glDeleteShader(entry->pending_shaders[0]);
+        glDeleteShader(entry->pending_shaders[1]);
+        entry->pending = 0;
+    }
+
+    entry->deps              = deps;
+    entry->pending_cache_key = hash_mix(shader_source_key(vs.c_str(), fs.c_str()), shader_cache_driver_hash);
+
+    const GLchar* sources[2] = {vs.c_str(), fs.c_str()};
+    const GLenum  types[2]   = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+
+    // no status queries here, with parallel compilation the driver works on it until Shader_hot_reload_poll asks
+    entry->pending = glCreateProgram();
+    foreach (i, 2) {
+        entry->pending_shaders[i] = glCreateShader(types[i]);
+        glShaderSource(entry->pending_shaders[i], 1, &sources[i], NULL);
+        glCompileShader(entry->pending_shaders[i]);
+        glAttachShader(entry->pending, entry->pending_shaders[i]);
+    }
+    glLinkProgram(entry->pending);
+}
+
+// returns true once the relinked program is live
+static bool shader_reload_finish(Shader_Watched_Program* entry)
+{
+#ifdef GL_ARB_parallel_shader_compile
+    if (shader_watcher.parallel_compile) {
+        GLint done = GL_FALSE;
+        glGetProgramiv(entry->pending, GL_COMPLETION_STATUS_ARB, &done);
+        if (done != GL_TRUE) {
+            return false;
+        }
+    }
+#endif
+
+    GLchar info_log[512];
+    GLint linked = GL_FALSE;
+    glGetProgramiv(entry->pending, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        const char* stages[2] = {"VERTEX", "FRAGMENT"};
+        bool compiled = true;
+        foreach (i, 2) {
+            GLint success = GL_FALSE;
+            glGetShaderiv(entry->pending_shaders[i], GL_COMPILE_STATUS, &success);
+            if (success != GL_TRUE) {
+                glGetShaderInfoLog(entry->pending_shaders[i], 512, NULL, info_log);
+                fprintf(stderr, "ERROR: %s SHADER COMPILATION FAILED %s", stages[i], info_log);
+                compiled = false;
+            }
+        }
+        if (compiled) {
+            glGetProgramInfoLog(entry->pending, 512, NULL, info_log);
+            fprintf(stderr, "%s %s", "ERROR: SHADER PROGRAM LINK FAILED", info_log);
+        }
+        foreach (f, shader_file_count) {
+            if ((entry->deps & (1ull << f)) != 0) {
+                fprintf(stderr, "    source %llu is %s\n", (unsigned long long)f, shader_files[f].path);
+            }
+        }
+        fprintf(stderr, "shader reload %s + %s failed, keeping the previous program\n", entry->vertex_path, entry->fragment_path);
+    } else {
+        // relinked in place, the program name is copied all over and stays valid
+        const u32 uniform_count = shader_uniforms_save(entry->program);
+
+        if (shader_cache_enabled()) {
+            glProgramParameteri(entry->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        foreach (i, 2) {
+            glDetachShader(entry->pending, entry->pending_shaders[i]);
+            glAttachShader(entry->program, entry->pending_shaders[i]);
+        }
+        glLinkProgram(entry->program);
+        foreach (i, 2) {
+            glDetachShader(entry->program, entry->pending_shaders[i]);
+        }
+
+        glGetProgramiv(entry->program, GL_LINK_STATUS, &linked);
+        if (linked != GL_TRUE) {
+            glGetProgramInfoLog(entry->program, 512, NULL, info_log);
+            fprintf(stderr, "%s %s", "ERROR: SHADER PROGRAM RELINK FAILED", info_log);
+        }
+
+        glUseProgram(entry->program);
+        shader_uniforms_restore(entry->program, uniform_count);
+
+        Shader shader = {entry->program};
+        Shader_bind_frame_data(&shader);
+        if (shader_cache_enabled()) {
+            shader_cache_store(&shader, entry->pending_cache_key);
+        }
+
+        printf("shader reloaded %s + %s\n", entry->vertex_path, entry->fragment_path);
+    }
+
+    gl_state_forget_program(entry->pending);
+    glDeleteProgram(entry->pending);
+    glDeleteShader(entry->pending_shaders[0]);
+    glDeleteShader(entry->pending_shaders[1]);
+    entry->pending = 0;
+
+    return linked == GL_TRUE;
+}
+
+// bit i set if cached file i changed on disk
+static u64 shader_watch_collect(void)
+{
+    u64 dirty = 0;
+
+#ifdef __linux__
+    alignas(struct inotify_event) char buf[4096];
+    for (;;) {
+        const ssize_t len = read(shader_watcher.fd, buf, sizeof(buf));
+        if (len <= 0) {
+            break;
+        }
+
+        for (char* p = buf; p < buf + len; ) {
+            const struct inotify_event* event = (const struct inotify_event*)p;
+            p += sizeof(struct inotify_event) + event->len;
+            if (event->len == 0) {
+                continue;
+            }
+
+            foreach (d, shader_watcher.dir_count) {
+                if (shader_watcher.wds[d] != event->wd) {
+                    continue;
+                }
+
+                char changed[SHADER_PATH_MAX];
+                char norm[SHADER_PATH_MAX];
+                snprintf(changed, sizeof(changed), "%s/%s", shader_watcher.dirs[d], event->name);
+                shader_path_normalize(norm, sizeof(norm), changed);
+                foreach (f, shader_file_count) {
+                    if (strcmp(shader_files[f].path, norm) == 0) {
+                        dirty |= (1ull << f);
+                    }
+                }
+            }
+        }
+    }
+#else
+    shader_watcher.poll_count += 1;
+    if (shader_watcher.poll_count % SHADER_WATCH_POLL_INTERVAL == 0) {
+        foreach (f, shader_file_count) {
+            if (shader_file_mtime(shader_files[f].path) != shader_files[f].mtime) {
+                dirty |= (1ull << f);
+            }
+        }
+    }
+#endif
+
+    return dirty;
+}
+
+bool Shader_hot_reload_init(void)
+{
+    shader_watcher.parallel_compile = false;
+#ifdef GL_ARB_parallel_shader_compile
+    if (GLEW_ARB_parallel_shader_compile) {
+        // let the driver pick the thread count
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        shader_watcher.parallel_compile = true;
+    }
+#endif
+
+#ifdef __linux__
+    shader_watcher.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (shader_watcher.fd < 0) {
+        fprintf(stderr, "WARNING: shader hot reload disabled, inotify: %s\n", strerror(errno));
+        return false;
+    }
+    shader_watcher.dir_count = 0;
+    shader_watcher.active = true;
+
+    // files cached before now
+    foreach (f, shader_file_count) {
+        shader_watch_dir_of(shader_files[f].path);
+    }
+#else
+    shader_watcher.active = true;
+#endif
+
+    return true;
+}
+
+u32 Shader_hot_reload_poll(void)
+{
+    if (!shader_watcher.active) {
+        return 0;
+    }
+
+    u64 dirty = shader_watch_collect();
+    if (dirty != 0) {
+        foreach (f, shader_file_count) {
+            if ((dirty & (1ull << f)) == 0) {
+                continue;
+            }
+
+            Shader_Source_File* file = &shader_files[f];
+            file->mtime = shader_file_mtime(file->path);
+
+            bool status = false;
+            std::string text = Shader_retrieve_src_from_file(file->path, &status);
+            if (!status) {
+                // gone for now, e.g. mid-save, the next change event brings it back
+                dirty &= ~(1ull << f);
+                continue;
+            }
+            file->text.swap(text);
+        }
+
+        foreach (i, SHADER_MAX_WATCHED_PROGRAMS) {
+            Shader_Watched_Program* entry = &shader_programs[i];
+            if (entry->program != 0 && (entry->deps & dirty) != 0) {
+                shader_reload_begin(entry);
+            }
+        }
+    }
+
+    u32 swapped = 0;
+    foreach (i, SHADER_MAX_WATCHED_PROGRAMS) {
+        Shader_Watched_Program* entry = &shader_programs[i];
+        if (entry->program != 0 && entry->pending != 0 && shader_reload_finish(entry)) {
+            swapped += 1;
+        }
+    }
+
+    // the relinked programs lost their uniform cache entries and the current program changed
+    if (swapped > 0) {
+        gl_state_invalidate();
+    }
+
+    return swapped;
+}
+
+void Shader_hot_reload_shutdown(void)
+{
+    foreach (i, SHADER_MAX_WATCHED_PROGRAMS) {
+        Shader_Watched_Program* entry = &shader_programs[i];
+        if (entry->pending != 0) {
+            gl_state_forget_program(entry->pending);
+            glDeleteProgram(entry->pending);
+            glDeleteShader(entry->pending_shaders[0]);
+            glDeleteShader(entry->pending_shaders[1]);
+            entry->pending = 0;
+        }
+    }
+
+#ifdef __linux__
+    if (shader_watcher.active) {
+        close(shader_watcher.fd);
+    }
+#endif
+    shader_watcher.active = false;
+}
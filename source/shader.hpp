@@ -59,6 +59,71 @@ bool Shader_load_from_src(Shader* shader, const std::string& vertex_src, const s
     
 std::string Shader_retrieve_src_from_file(const GLchar* path, bool* is_valid);
 
+// one program per distinct pair of sources, reference counted, e.g. every sd batch draws with default_2d
+bool Shader_load_shared_from_file(Shader* shader, const std::string& vertex_path, const std::string& fragment_path);
+// drops a reference to a shared program, any other program is deleted
+void Shader_release(Shader* shader);
+
+// PROGRAM BINARY CACHE
+// linked programs are kept in SHADER_CACHE_DIR as <hash>.bin, keyed by the final sources (addons included)
+// and the driver strings, a binary the driver refuses is recompiled from source and overwritten.
+// disabled where the driver offers no binary formats
+#define SHADER_CACHE_DIR "shaders/cache/"
+#define SHADER_CACHE_MAGIC (0x31435350) // "PSC1"
+
+struct Shader_Cache_File_Header {
+    u32 magic;
+    u32 format;
+    u64 key;
+    u32 length;
+    u32 pad_;
+};
+
+// per-frame data shared by every program through the std140 "Frame_Data" uniform block,
+// layout must match the block in shaders/frame_data.glsl, which every shader includes
+struct Frame_Data {
+    Mat4    projection;
+    Mat4    view;
+    Vec4    position_cam;
+    GLfloat scale;
+    GLfloat time;
+    GLfloat pad_[2];
+};
+static_assert(sizeof(Frame_Data) == 160, "Frame_Data must match the std140 block layout");
+
+#define FRAME_DATA_BINDING (0)
+
+struct Frame_Uniform_Buffer {
+    GLuint ubo;
+};
+
+bool Frame_Uniform_Buffer_init(Frame_Uniform_Buffer* buffer);
+// uploads the frame data and binds the buffer to FRAME_DATA_BINDING, once per frame
+void Frame_Uniform_Buffer_update(Frame_Uniform_Buffer* buffer, const Frame_Data* data);
+void Frame_Uniform_Buffer_delete(Frame_Uniform_Buffer* buffer);
+
+// called on link, programs without the block are left alone
+void Shader_bind_frame_data(Shader* shader);
+
+// INCLUDES AND HOT RELOAD
+// Shader_load_from_file expands #include "path" lines (relative to the including file, each file once per stage)
+// from a source cache and records every file a program pulls in. Shader_hot_reload_poll picks up edits,
+// through inotify on linux and modification times elsewhere, and relinks only the programs depending on
+// the changed files. A relink compiles into a scratch program first (in the driver's threads where
+// GL_ARB_parallel_shader_compile exists) and is then linked into the original program object,
+// so every copy of the GLuint stays valid, uniform values are carried over
+#define SHADER_PATH_MAX (256)
+// the dependency sets are u64 masks over the cache
+#define SHADER_MAX_SOURCE_FILES (64)
+#define SHADER_MAX_WATCHED_PROGRAMS (64)
+#define SHADER_MAX_INCLUDE_DEPTH (16)
+
+// after the GL context exists
+bool Shader_hot_reload_init(void);
+// once per frame, returns the number of programs swapped in, which also invalidates gl_state
+u32  Shader_hot_reload_poll(void);
+void Shader_hot_reload_shutdown(void);
+
 #ifdef SHADER_IMPLEMENTATION
 #undef SHADER_IMPLEMENTATION
 #include "shader.cpp"
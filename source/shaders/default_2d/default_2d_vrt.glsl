@@ -7,11 +7,14 @@ layout (location = 1) in vec4 a_color;
 out vec3 v_position;
 out vec4 v_color;
 
+// batch transform, the projection comes from Frame_Data
 uniform mat4 u_matrix;
 
+#include "../frame_data.glsl"
+
 void main(void) 
 {
-   gl_Position = u_matrix * vec4(a_position, 1.0);
+   gl_Position = u_projection * u_matrix * vec4(a_position, 1.0);
    v_position = a_position.xyz;
 
    v_color = a_color;
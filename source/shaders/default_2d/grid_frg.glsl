@@ -6,10 +6,8 @@ in vec4 v_color;
 in vec2 v_uv;
 in vec3 v_position_cam;
 
-uniform vec3 u_position_cam;
+#include "../frame_data.glsl"
 uniform float u_grid_square_pix;
-uniform float u_time;
-uniform float u_scale;
 
 out vec4 color;
 
@@ -9,11 +9,8 @@ out vec3 v_position_cam;
 out vec4 v_color;
 out vec2 v_uv;
 
-uniform mat4 u_matrix;
-uniform vec3 u_position_cam;
+#include "../frame_data.glsl"
 uniform vec4 u_color;
-uniform float u_time;
-uniform float u_scale;
 
 float sin01(float x)
 {
@@ -23,7 +20,7 @@ float sin01(float x)
 #define SCALE_TEST
 void main(void) 
 {
-   gl_Position = u_matrix * vec4(a_position, 1.0);
+   gl_Position = u_projection * vec4(a_position, 1.0);
    v_position =  a_position.xyz;
 
    vec2 c = vec2(640.0, 360.0);
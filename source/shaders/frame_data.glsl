@@ -0,0 +1,8 @@
+// per-frame data, bound to FRAME_DATA_BINDING, must match struct Frame_Data in shader.hpp
+layout (std140) uniform Frame_Data {
+   mat4  u_projection;
+   mat4  u_view;
+   vec4  u_position_cam;
+   float u_scale;
+   float u_time;
+};
@@ -6,7 +6,7 @@ in vec4 v_color;
 in vec2 v_uv;
 in vec3 v_position_cam;
 
-uniform float u_time;
+#include "../frame_data.glsl"
 uniform vec2 u_resolution;
 uniform sampler2D tex0;
 uniform sampler2D tex1;
@@ -0,0 +1,13 @@
+#version 330 core
+precision highp float;
+
+in vec3 v_uv;
+
+uniform sampler2DArray u_layers;
+
+out vec4 color;
+
+void main(void)
+{
+   color = texture(u_layers, v_uv);
+}
@@ -0,0 +1,17 @@
+#version 330 core
+precision highp float;
+
+// tiled quads built by Parallax_Layers_draw_tiles, already in screen space
+layout (location = 0) in vec3 a_position;
+// uv and layer slice
+layout (location = 1) in vec3 a_uv;
+
+out vec3 v_uv;
+
+#include "../frame_data.glsl"
+
+void main(void) 
+{
+   gl_Position = u_projection * vec4(a_position, 1.0);
+   v_uv = a_uv;
+}
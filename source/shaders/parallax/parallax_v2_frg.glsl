@@ -1,29 +1,36 @@
 #version 330 core
 precision highp float;
 
-in vec2 t0c, t1c, t2c, t3c, t4c;
+// must match PARALLAX_MAX_LAYERS in parallax.hpp
+#define MAX_LAYERS 16
 
-uniform sampler2D tex0;
-uniform sampler2D tex1;
-uniform sampler2D tex2;
-uniform sampler2D tex3;
-uniform sampler2D tex4;
+in vec2 v_uv;
+in vec2 v_off;
+in vec2 v_scaler;
+
+// slice i is layer i, back to front
+uniform sampler2DArray u_layers;
+uniform int u_count_layers;
+uniform vec2 u_scroll_divisors[MAX_LAYERS];
+// the layers were cooked with premultiplied alpha
+uniform bool u_premultiplied;
 
 out vec4 color;
 
-void main(void)
+vec2 scale(vec2 v, vec2 c, vec2 scaler)
 {
-    vec4 t0, t1, t2, t3, t4;
+    return (((v - (c + 0.5)) * scaler) + (c + 0.5));
+}
 
-    t0 = texture(tex0, t0c);
-    t1 = texture(tex1, t1c);
-    t2 = texture(tex2, t2c);
-    t3 = texture(tex3, t3c);    
-    t4 = texture(tex4, t4c);
+void main(void)
+{
+    // the back layer is opaque, the others are blended over it
+    vec2 c = v_off / u_scroll_divisors[0];
+    color = texture(u_layers, vec3(scale(v_uv + c, c, v_scaler), 0.0));
 
-    color = t0;
-    color = vec4(t1.a) * t1 + vec4(1.0 - t1.a) * color;
-    color = vec4(t2.a) * t2 + vec4(1.0 - t2.a) * color;
-    color = vec4(t3.a) * t3 + vec4(1.0 - t3.a) * color;
-    color = vec4(t4.a) * t4 + vec4(1.0 - t4.a) * color;
+    for (int i = 1; i < u_count_layers; i += 1) {
+        c = v_off / u_scroll_divisors[i];
+        vec4 t = texture(u_layers, vec3(scale(v_uv + c, c, v_scaler), float(i)));
+        color = ((u_premultiplied) ? t : vec4(t.a) * t) + vec4(1.0 - t.a) * color;
+    }
 }
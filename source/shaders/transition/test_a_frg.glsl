@@ -6,7 +6,7 @@ in vec4 v_color;
 in vec3 l_position;
 in vec2 v_uv;
 
-uniform float u_time;
+#include "../frame_data.glsl"
 uniform vec2 u_resolution;
 
 out vec4 color;
@@ -10,13 +10,12 @@ out vec4 v_color;
 out vec3 l_position;
 out vec2 v_uv;
 
-uniform mat4 u_matrix;
-uniform float u_time;
+#include "../frame_data.glsl"
 uniform vec2 u_resolution;
 
 void main(void) 
 {
-   gl_Position = u_matrix * vec4(a_position, 1.0);
+   gl_Position = u_projection * vec4(a_position, 1.0);
    v_position = a_position.xyz;//gl_Position.xyz;
    l_position = gl_Position.xyz;
    v_color = a_color;
@@ -7,7 +7,7 @@ in vec3 l_position;
 in vec2 v_uv;
 in vec3 v_position_cam;
 
-uniform float u_time;
+#include "../frame_data.glsl"
 uniform vec2 u_resolution;
 uniform sampler2D tex0;
 uniform sampler2D tex1;
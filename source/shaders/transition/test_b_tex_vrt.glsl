@@ -11,19 +11,17 @@ out vec3 l_position;
 out vec2 v_uv;
 out vec3 v_position_cam;
 
-uniform mat4 u_matrix;
-uniform float u_time;
+#include "../frame_data.glsl"
 uniform vec2 u_resolution;
-uniform vec3 u_position_cam;
 
 void main(void) 
 {
-   gl_Position = u_matrix * vec4(a_position, 1.0);
+   gl_Position = u_projection * vec4(a_position, 1.0);
    v_position = a_position.xyz;//gl_Position.xyz;
    l_position = gl_Position.xyz;
    v_color = a_color;
 
    // TODO animation
    v_uv = a_uv;
-   v_position_cam = u_position_cam;
+   v_position_cam = u_position_cam.xyz;
 }
\ No newline at end of file
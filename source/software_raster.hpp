@@ -0,0 +1,773 @@
+#ifndef SOFTWARE_RASTER_HPP
+#define SOFTWARE_RASTER_HPP
+
+#if !(UNITY_BUILD)
+#include "common_utils_cpp.hpp"
+
+#include "opengl.hpp"
+#include "sdl.hpp"
+#endif
+
+// CPU rasterizer for the sd primitives, no GL context is needed
+//
+// triangles and 1-pixel lines are drawn into an RGBA8 framebuffer with a depth buffer
+// (GL_LESS) and GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA blending. submissions are transformed
+// and binned into SOFTWARE_TILE_SIZE tiles, Software_Renderer_flush then rasterizes the tiles
+// across the worker threads, 4 pixels at a time. attributes are interpolated affinely,
+// which is exact for the orthographic projections sd draws with
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SOFTWARE_RASTER_SSE2
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+    #include <arm_neon.h>
+    #define SOFTWARE_RASTER_NEON
+#endif
+
+#define SOFTWARE_TILE_SIZE (64)
+#define SOFTWARE_MAX_WORKERS (16)
+
+// RGBA8, red in the lowest byte, rows top to bottom
+struct Software_Texture {
+    u32  width;
+    u32  height;
+    u32* pixels;
+    // GL_REPEAT when set, GL_CLAMP_TO_EDGE otherwise
+    bool repeat_u;
+    bool repeat_v;
+};
+
+bool Software_Texture_load(Software_Texture* tex, const char* path, const bool repeat_u, const bool repeat_v);
+void Software_Texture_free(Software_Texture* tex);
+
+// window space, y down, z in [0, 1]
+struct Software_Vertex {
+    f32 x, y, z;
+    f32 r, g, b, a;
+    f32 u, v;
+};
+
+enum SOFTWARE_TRIANGLE_FLAGS : u8 {
+    SOFTWARE_BLEND      = (1 << 0),
+    SOFTWARE_DEPTH_TEST = (1 << 1),
+};
+
+struct Software_Triangle {
+    Software_Vertex v[3];
+    const Software_Texture* texture;
+
+    // E_i(x, y) = a*x + b*y + c is 2 * the area opposite vertex i, positive inside
+    f32 edge_a[3];
+    f32 edge_b[3];
+    f32 edge_c[3];
+    bool edge_top_left[3];
+    f32 inv_area;
+
+    // inclusive pixel bounds, inside the framebuffer
+    i32 min_x, min_y;
+    i32 max_x, max_y;
+
+    u8 flags;
+};
+
+struct Software_Bin {
+    u32*  triangles;
+    usize count;
+    usize cap;
+};
+
+struct Software_Renderer {
+    u32 width;
+    u32 height;
+    // rows are padded to whole tiles so 4-wide loads never leave the buffers
+    u32 pitch;
+    u32* color;
+    f32* depth;
+
+    u32 tiles_x;
+    u32 tiles_y;
+    Software_Bin* bins;
+
+    Software_Triangle* triangles;
+    usize count_triangles;
+    usize cap_triangles;
+
+    // state captured by submissions
+    bool blend;
+    bool depth_test;
+
+    bool clear_pending;
+    u32  clear_color;
+
+    SDL_Thread*  workers[SOFTWARE_MAX_WORKERS];
+    usize        count_workers;
+    SDL_sem*     start;
+    SDL_sem*     done;
+    SDL_atomic_t next_tile;
+    bool         running;
+};
+
+// count_workers threads are started in addition to the calling thread, 0 rasterizes on the caller only
+bool Software_Renderer_init(Software_Renderer* r, const u32 width, const u32 height, usize count_workers);
+void Software_Renderer_free(Software_Renderer* r);
+// applied to every tile at the start of the next flush, as with glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT)
+void Software_Renderer_clear(Software_Renderer* r, const Vec4 color);
+// sd batch layout: position (3) then color (4) per vertex, primitive is GL_TRIANGLES or GL_LINES
+void Software_Renderer_draw_colored(Software_Renderer* r, const Mat4& mvp, const GLenum primitive, const GLfloat* vertices, const usize stride, const GLuint* indices, const usize count);
+// position (3) then uv (2) per vertex, the uvs are mapped through uv * uv_scale + uv_offset before sampling
+void Software_Renderer_draw_textured(Software_Renderer* r, const Mat4& mvp, const GLfloat* vertices, const usize stride, const GLuint* indices, const usize count, const Software_Texture* texture, const Vec2 uv_scale, const Vec2 uv_offset);
+void Software_Renderer_flush(Software_Renderer* r);
+bool Software_Renderer_save_png(Software_Renderer* r, const char* path);
+
+#endif // SOFTWARE_RASTER_HPP
+
+#ifdef SOFTWARE_RASTER_IMPLEMENTATION
+#undef SOFTWARE_RASTER_IMPLEMENTATION
+
+// 4-wide float lanes and lane masks
+#if defined(SOFTWARE_RASTER_SSE2)
+
+typedef __m128 Software_F4;
+typedef __m128 Software_M4;
+
+static inline Software_F4 software_f4(const f32 x) { return _mm_set1_ps(x); }
+static inline Software_F4 software_f4(const f32 x0, const f32 x1, const f32 x2, const f32 x3) { return _mm_setr_ps(x0, x1, x2, x3); }
+static inline Software_F4 software_load(const f32* p) { return _mm_loadu_ps(p); }
+static inline void software_store(f32* p, const Software_F4 x) { _mm_storeu_ps(p, x); }
+static inline Software_F4 software_add(const Software_F4 a, const Software_F4 b) { return _mm_add_ps(a, b); }
+static inline Software_F4 software_mul(const Software_F4 a, const Software_F4 b) { return _mm_mul_ps(a, b); }
+static inline Software_M4 software_gt(const Software_F4 a, const Software_F4 b) { return _mm_cmpgt_ps(a, b); }
+static inline Software_M4 software_ge(const Software_F4 a, const Software_F4 b) { return _mm_cmpge_ps(a, b); }
+static inline Software_M4 software_lt(const Software_F4 a, const Software_F4 b) { return _mm_cmplt_ps(a, b); }
+static inline Software_M4 software_le(const Software_F4 a, const Software_F4 b) { return _mm_cmple_ps(a, b); }
+static inline Software_M4 software_eq(const Software_F4 a, const Software_F4 b) { return _mm_cmpeq_ps(a, b); }
+static inline Software_M4 software_and(const Software_M4 a, const Software_M4 b) { return _mm_and_ps(a, b); }
+static inline Software_M4 software_or(const Software_M4 a, const Software_M4 b) { return _mm_or_ps(a, b); }
+static inline Software_M4 software_mask(const bool m0, const bool m1, const bool m2, const bool m3)
+{
+    return _mm_castsi128_ps(_mm_setr_epi32(-(i32)m0, -(i32)m1, -(i32)m2, -(i32)m3));
+}
+static inline Software_F4 software_select(const Software_M4 m, const Software_F4 a, const Software_F4 b)
+{
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+static inline u32 software_bits(const Software_M4 m) { return (u32)_mm_movemask_ps(m); }
+
+#elif defined(SOFTWARE_RASTER_NEON)
+
+typedef float32x4_t Software_F4;
+typedef uint32x4_t  Software_M4;
+
+static inline Software_F4 software_f4(const f32 x) { return vdupq_n_f32(x); }
+static inline Software_F4 software_f4(const f32 x0, const f32 x1, const f32 x2, const f32 x3)
+{
+    const f32 v[4] = {x0, x1, x2, x3};
+    return vld1q_f32(v);
+}
+static inline Software_F4 software_load(const f32* p) { return vld1q_f32(p); }
+static inline void software_store(f32* p, const Software_F4 x) { vst1q_f32(p, x); }
+static inline Software_F4 software_add(const Software_F4 a, const Software_F4 b) { return vaddq_f32(a, b); }
+static inline Software_F4 software_mul(const Software_F4 a, const Software_F4 b) { return vmulq_f32(a, b); }
+static inline Software_M4 software_gt(const Software_F4 a, const Software_F4 b) { return vcgtq_f32(a, b); }
+static inline Software_M4 software_ge(const Software_F4 a, const Software_F4 b) { return vcgeq_f32(a, b); }
+static inline Software_M4 software_lt(const Software_F4 a, const Software_F4 b) { return vcltq_f32(a, b); }
+static inline Software_M4 software_le(const Software_F4 a, const Software_F4 b) { return vcleq_f32(a, b); }
+static inline Software_M4 software_eq(const Software_F4 a, const Software_F4 b) { return vceqq_f32(a, b); }
+static inline Software_M4 software_and(const Software_M4 a, const Software_M4 b) { return vandq_u32(a, b); }
+static inline Software_M4 software_or(const Software_M4 a, const Software_M4 b) { return vorrq_u32(a, b); }
+static inline Software_M4 software_mask(const bool m0, const bool m1, const bool m2, const bool m3)
+{
+    const u32 v[4] = {0u - (u32)m0, 0u - (u32)m1, 0u - (u32)m2, 0u - (u32)m3};
+    return vld1q_u32(v);
+}
+static inline Software_F4 software_select(const Software_M4 m, const Software_F4 a, const Software_F4 b) { return vbslq_f32(m, a, b); }
+static inline u32 software_bits(const Software_M4 m)
+{
+    return (vgetq_lane_u32(m, 0) & 1) | ((vgetq_lane_u32(m, 1) & 1) << 1) |
+           ((vgetq_lane_u32(m, 2) & 1) << 2) | ((vgetq_lane_u32(m, 3) & 1) << 3);
+}
+
+#else
+
+struct Software_F4 { f32 v[4]; };
+struct Software_M4 { u32 v[4]; };
+
+#define SOFTWARE_LANES(T, expr__) T out; foreach (l, 4) { out.v[l] = (expr__); } return out
+
+static inline Software_F4 software_f4(const f32 x) { SOFTWARE_LANES(Software_F4, x); }
+static inline Software_F4 software_f4(const f32 x0, const f32 x1, const f32 x2, const f32 x3) { return Software_F4{{x0, x1, x2, x3}}; }
+static inline Software_F4 software_load(const f32* p) { SOFTWARE_LANES(Software_F4, p[l]); }
+static inline void software_store(f32* p, const Software_F4 x) { foreach (l, 4) { p[l] = x.v[l]; } }
+static inline Software_F4 software_add(const Software_F4 a, const Software_F4 b) { SOFTWARE_LANES(Software_F4, a.v[l] + b.v[l]); }
+static inline Software_F4 software_mul(const Software_F4 a, const Software_F4 b) { SOFTWARE_LANES(Software_F4, a.v[l] * b.v[l]); }
+static inline Software_M4 software_gt(const Software_F4 a, const Software_F4 b) { SOFTWARE_LANES(Software_M4, 0u - (u32)(a.v[l] >  b.v[l])); }
+static inline Software_M4 software_ge(const Software_F4 a, const Software_F4 b) { SOFTWARE_LANES(Software_M4, 0u - (u32)(a.v[l] >= b.v[l])); }
+static inline Software_M4 software_lt(const Software_F4 a, const Software_F4 b) { SOFTWARE_LANES(Software_M4, 0u - (u32)(a.v[l] <  b.v[l])); }
+static inline Software_M4 software_le(const Software_F4 a, const Software_F4 b) { SOFTWARE_LANES(Software_M4, 0u - (u32)(a.v[l] <= b.v[l])); }
+static inline Software_M4 software_eq(const Software_F4 a, const Software_F4 b) { SOFTWARE_LANES(Software_M4, 0u - (u32)(a.v[l] == b.v[l])); }
+static inline Software_M4 software_and(const Software_M4 a, const Software_M4 b) { SOFTWARE_LANES(Software_M4, a.v[l] & b.v[l]); }
+static inline Software_M4 software_or(const Software_M4 a, const Software_M4 b) { SOFTWARE_LANES(Software_M4, a.v[l] | b.v[l]); }
+static inline Software_M4 software_mask(const bool m0, const bool m1, const bool m2, const bool m3) { return Software_M4{{0u - (u32)m0, 0u - (u32)m1, 0u - (u32)m2, 0u - (u32)m3}}; }
+static inline Software_F4 software_select(const Software_M4 m, const Software_F4 a, const Software_F4 b) { SOFTWARE_LANES(Software_F4, m.v[l] ? a.v[l] : b.v[l]); }
+static inline u32 software_bits(const Software_M4 m) { return (m.v[0] & 1) | ((m.v[1] & 1) << 1) | ((m.v[2] & 1) << 2) | ((m.v[3] & 1) << 3); }
+
+#undef SOFTWARE_LANES
+
+#endif
+
+static inline u32 software_pack(const f32 r, const f32 g, const f32 b, const f32 a)
+{
+    return ((u32)(glm::clamp(r, 0.0f, 1.0f) * 255.0f + 0.5f))       |
+           ((u32)(glm::clamp(g, 0.0f, 1.0f) * 255.0f + 0.5f) << 8)  |
+           ((u32)(glm::clamp(b, 0.0f, 1.0f) * 255.0f + 0.5f) << 16) |
+           ((u32)(glm::clamp(a, 0.0f, 1.0f) * 255.0f + 0.5f) << 24);
+}
+
+bool Software_Texture_load(Software_Texture* tex, const char* path, const bool repeat_u, const bool repeat_v)
+{
+    SDL_Surface* img = IMG_Load(path);
+    if (img == nullptr) {
+        fprintf(stderr, "ERROR: Software_Texture_load %s, SDL_image Error: %s\n", path, IMG_GetError());
+        return false;
+    }
+
+    SDL_Surface* rgba = SDL_ConvertSurfaceFormat(img, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(img);
+    if (rgba == nullptr) {
+        fprintf(stderr, "ERROR: Software_Texture_load %s, SDL Error: %s\n", path, SDL_GetError());
+        return false;
+    }
+
+    tex->width    = rgba->w;
+    tex->height   = rgba->h;
+    tex->repeat_u = repeat_u;
+    tex->repeat_v = repeat_v;
+    tex->pixels   = (u32*)xmalloc(tex->width * tex->height * sizeof(u32));
+
+    SDL_LockSurface(rgba);
+    foreach (y, tex->height) {
+        memcpy(&tex->pixels[y * tex->width], (u8*)rgba->pixels + (y * rgba->pitch), tex->width * sizeof(u32));
+    }
+    SDL_UnlockSurface(rgba);
+    SDL_FreeSurface(rgba);
+
+    return true;
+}
+
+void Software_Texture_free(Software_Texture* tex)
+{
+    ::free(tex->pixels);
+    tex->pixels = nullptr;
+}
+
+// nearest texel
+static inline u32 Software_Texture_sample(const Software_Texture* tex, f32 u, f32 v)
+{
+    u = (tex->repeat_u) ? u - glm::floor(u) : glm::clamp(u, 0.0f, 1.0f);
+    v = (tex->repeat_v) ? v - glm::floor(v) : glm::clamp(v, 0.0f, 1.0f);
+
+    const u32 x = glm::min((u32)(u * tex->width),  tex->width - 1);
+    const u32 y = glm::min((u32)(v * tex->height), tex->height - 1);
+
+    return tex->pixels[y * tex->width + x];
+}
+
+static void software_rasterize_tiles(Software_Renderer* r);
+
+static int SDLCALL Software_Renderer_worker_proc(void* arg)
+{
+    Software_Renderer* r = (Software_Renderer*)arg;
+
+    for (;;) {
+        SDL_SemWait(r->start);
+        if (r->running == false) {
+            break;
+        }
+
+        software_rasterize_tiles(r);
+
+        SDL_SemPost(r->done);
+    }
+
+    return 0;
+}
+
+bool Software_Renderer_init(Software_Renderer* r, const u32 width, const u32 height, usize count_workers)
+{
+    r->width   = width;
+    r->height  = height;
+    r->tiles_x = (width  + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+    r->tiles_y = (height + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+    r->pitch   = r->tiles_x * SOFTWARE_TILE_SIZE;
+
+    const usize pixel_count = r->pitch * (r->tiles_y * SOFTWARE_TILE_SIZE);
+    r->color = (u32*)xcalloc(pixel_count, sizeof(u32));
+    r->depth = (f32*)xmalloc(pixel_count * sizeof(f32));
+    foreach (i, pixel_count) {
+        r->depth[i] = 1.0f;
+    }
+
+    r->bins = (Software_Bin*)xcalloc(r->tiles_x * r->tiles_y, sizeof(Software_Bin));
+
+    r->triangles       = nullptr;
+    r->count_triangles = 0;
+    r->cap_triangles   = 0;
+
+    r->blend         = false;
+    r->depth_test    = false;
+    r->clear_pending = false;
+    r->clear_color   = 0;
+
+    if (count_workers > SOFTWARE_MAX_WORKERS) {
+        count_workers = SOFTWARE_MAX_WORKERS;
+    }
+
+    r->count_workers = 0;
+    r->running       = true;
+    SDL_AtomicSet(&r->next_tile, 0);
+
+    r->start = SDL_CreateSemaphore(0);
+    r->done  = SDL_CreateSemaphore(0);
+    if (r->start == nullptr || r->done == nullptr) {
+        fprintf(stderr, "ERROR: Software_Renderer_init %s\n", SDL_GetError());
+        Software_Renderer_free(r);
+        return false;
+    }
+
+    foreach (i, count_workers) {
+        r->workers[i] = SDL_CreateThread(Software_Renderer_worker_proc, "sd_software_raster", (void*)r);
+        if (r->workers[i] == nullptr) {
+            fprintf(stderr, "ERROR: Software_Renderer_init %s\n", SDL_GetError());
+            Software_Renderer_free(r);
+            return false;
+        }
+        r->count_workers += 1;
+    }
+
+    return true;
+}
+
+void Software_Renderer_free(Software_Renderer* r)
+{
+    r->running = false;
+
+    foreach (i, r->count_workers) {
+        SDL_SemPost(r->start);
+    }
+    foreach (i, r->count_workers) {
+        SDL_WaitThread(r->workers[i], nullptr);
+    }
+    r->count_workers = 0;
+
+    if (r->start != nullptr) {
+        SDL_DestroySemaphore(r->start);
+        r->start = nullptr;
+    }
+    if (r->done != nullptr) {
+        SDL_DestroySemaphore(r->done);
+        r->done = nullptr;
+    }
+
+    foreach (i, r->tiles_x * r->tiles_y) {
+        ::free(r->bins[i].triangles);
+    }
+    ::free(r->bins);
+    ::free(r->triangles);
+    ::free(r->color);
+    ::free(r->depth);
+
+    r->bins      = nullptr;
+    r->triangles = nullptr;
+    r->color     = nullptr;
+    r->depth     = nullptr;
+}
+
+void Software_Renderer_clear(Software_Renderer* r, const Vec4 color)
+{
+    // anything submitted before would be cleared anyway
+    r->count_triangles = 0;
+
+    r->clear_pending = true;
+    r->clear_color   = software_pack(color.r, color.g, color.b, color.a);
+}
+
+// clip space to window space, false when the vertex is behind the eye
+static inline bool software_transform(Software_Renderer* r, const Mat4& mvp, const GLfloat* p, Software_Vertex* out)
+{
+    const Vec4 clip = mvp * Vec4(p[0], p[1], p[2], 1.0f);
+    if (clip.w <= 0.0f) {
+        return false;
+    }
+
+    const f32 inv_w = 1.0f / clip.w;
+    out->x = ((clip.x * inv_w) * 0.5f + 0.5f) * r->width;
+    out->y = (0.5f - (clip.y * inv_w) * 0.5f) * r->height;
+    out->z = (clip.z * inv_w) * 0.5f + 0.5f;
+
+    return true;
+}
+
+static void software_push_triangle(Software_Renderer* r, const Software_Vertex* a, const Software_Vertex* b, const Software_Vertex* c, const Software_Texture* texture)
+{
+    f32 area = (b->x - a->x) * (c->y - a->y) - (b->y - a->y) * (c->x - a->x);
+    if (area == 0.0f) {
+        return;
+    }
+    // both windings are drawn, as with GL_CULL_FACE disabled
+    if (area < 0.0f) {
+        const Software_Vertex* tmp = b;
+        b = c;
+        c = tmp;
+        area = -area;
+    }
+
+    const i32 min_x = glm::max((i32)glm::floor(glm::min(a->x, glm::min(b->x, c->x))), 0);
+    const i32 min_y = glm::max((i32)glm::floor(glm::min(a->y, glm::min(b->y, c->y))), 0);
+    const i32 max_x = glm::min((i32)glm::ceil(glm::max(a->x, glm::max(b->x, c->x))), (i32)r->width  - 1);
+    const i32 max_y = glm::min((i32)glm::ceil(glm::max(a->y, glm::max(b->y, c->y))), (i32)r->height - 1);
+    if (min_x > max_x || min_y > max_y) {
+        return;
+    }
+
+    if (r->count_triangles == r->cap_triangles) {
+        r->cap_triangles = (r->cap_triangles == 0) ? 1024 : r->cap_triangles * 2;
+        r->triangles = (Software_Triangle*)xrealloc(r->triangles, r->cap_triangles * sizeof(Software_Triangle));
+    }
+    Software_Triangle* tri = &r->triangles[r->count_triangles];
+    r->count_triangles += 1;
+
+    tri->v[0] = *a;
+    tri->v[1] = *b;
+    tri->v[2] = *c;
+    tri->texture  = texture;
+    tri->inv_area = 1.0f / area;
+
+    foreach (i, 3) {
+        const Software_Vertex* v1 = &tri->v[(i + 1) % 3];
+        const Software_Vertex* v2 = &tri->v[(i + 2) % 3];
+        const f32 dx = v2->x - v1->x;
+        const f32 dy = v2->y - v1->y;
+
+        tri->edge_a[i] = -dy;
+        tri->edge_b[i] = dx;
+        tri->edge_c[i] = (dy * v1->x) - (dx * v1->y);
+        // a pixel center exactly on an edge shared by two triangles belongs to only one of them
+        tri->edge_top_left[i] = (dy < 0.0f) || (dy == 0.0f && dx > 0.0f);
+    }
+
+    tri->min_x = min_x;
+    tri->min_y = min_y;
+    tri->max_x = max_x;
+    tri->max_y = max_y;
+
+    tri->flags = (r->blend      ? SOFTWARE_BLEND      : 0) |
+                 (r->depth_test ? SOFTWARE_DEPTH_TEST : 0);
+}
+
+void Software_Renderer_draw_colored(Software_Renderer* r, const Mat4& mvp, const GLenum primitive, const GLfloat* vertices, const usize stride, const GLuint* indices, const usize count)
+{
+    switch (primitive) {
+    case GL_TRIANGLES: {
+        for (usize i = 0; i + 3 <= count; i += 3) {
+            Software_Vertex v[3];
+            bool visible = true;
+            foreach (k, 3) {
+                const GLfloat* src = &vertices[indices[i + k] * stride];
+                visible = visible && software_transform(r, mvp, src, &v[k]);
+                v[k].r = src[3];
+                v[k].g = src[4];
+                v[k].b = src[5];
+                v[k].a = src[6];
+                v[k].u = 0.0f;
+                v[k].v = 0.0f;
+            }
+            if (visible) {
+                software_push_triangle(r, &v[0], &v[1], &v[2], nullptr);
+            }
+        }
+        break;
+    }
+    case GL_LINES: {
+        // each segment becomes a quad 1 pixel wide
+        for (usize i = 0; i + 2 <= count; i += 2) {
+            Software_Vertex v[2];
+            bool visible = true;
+            foreach (k, 2) {
+                const GLfloat* src = &vertices[indices[i + k] * stride];
+                visible = visible && software_transform(r, mvp, src, &v[k]);
+                v[k].r = src[3];
+                v[k].g = src[4];
+                v[k].b = src[5];
+                v[k].a = src[6];
+                v[k].u = 0.0f;
+                v[k].v = 0.0f;
+            }
+            if (!visible) {
+                continue;
+            }
+
+            const f32 dx = v[1].x - v[0].x;
+            const f32 dy = v[1].y - v[0].y;
+            const f32 len = glm::sqrt((dx * dx) + (dy * dy));
+            if (len == 0.0f) {
+                continue;
+            }
+            const f32 nx = (-dy / len) * 0.5f;
+            const f32 ny = ( dx / len) * 0.5f;
+
+            Software_Vertex q[4] = {v[0], v[0], v[1], v[1]};
+            q[0].x += nx; q[0].y += ny;
+            q[1].x -= nx; q[1].y -= ny;
+            q[2].x -= nx; q[2].y -= ny;
+            q[3].x += nx; q[3].y += ny;
+
+            software_push_triangle(r, &q[0], &q[1], &q[2], nullptr);
+            software_push_triangle(r, &q[2], &q[3], &q[0], nullptr);
+        }
+        break;
+    }
+    default:
+        fprintf(stderr, "ERROR: Software_Renderer_draw_colored unsupported primitive %u\n", (unsigned)primitive);
+        break;
+    }
+}
+
+void Software_Renderer_draw_textured(Software_Renderer* r, const Mat4& mvp, const GLfloat* vertices, const usize stride, const GLuint* indices, const usize count, const Software_Texture* texture, const Vec2 uv_scale, const Vec2 uv_offset)
+{
+    for (usize i = 0; i + 3 <= count; i += 3) {
+        Software_Vertex v[3];
+        bool visible = true;
+        foreach (k, 3) {
+            const GLfloat* src = &vertices[indices[i + k] * stride];
+            visible = visible && software_transform(r, mvp, src, &v[k]);
+            v[k].r = 1.0f;
+            v[k].g = 1.0f;
+            v[k].b = 1.0f;
+            v[k].a = 1.0f;
+            v[k].u = (src[3] * uv_scale.x) + uv_offset.x;
+            v[k].v = (src[4] * uv_scale.y) + uv_offset.y;
+        }
+        if (visible) {
+            software_push_triangle(r, &v[0], &v[1], &v[2], texture);
+        }
+    }
+}
+
+// covered pixels of one triangle in one tile
+static void software_rasterize_triangle(Software_Renderer* r, const Software_Triangle* tri, const i32 tile_x0, const i32 tile_y0, const i32 tile_x1, const i32 tile_y1)
+{
+    // tile_x0 is a multiple of 4, so the 4-pixel groups stay inside the tile
+    const i32 x0 = glm::max(tri->min_x, tile_x0) & ~3;
+    const i32 y0 = glm::max(tri->min_y, tile_y0);
+    const i32 x1 = glm::min(tri->max_x, tile_x1);
+    const i32 y1 = glm::min(tri->max_y, tile_y1);
+
+    const Software_F4 zero = software_f4(0.0f);
+    const Software_F4 one  = software_f4(1.0f);
+    const Software_F4 lane = software_f4(0.5f, 1.5f, 2.5f, 3.5f);
+
+    Software_F4 edge_a[3];
+    Software_M4 top_left[3];
+    foreach (i, 3) {
+        edge_a[i]   = software_f4(tri->edge_a[i]);
+        top_left[i] = software_mask(tri->edge_top_left[i], tri->edge_top_left[i], tri->edge_top_left[i], tri->edge_top_left[i]);
+    }
+
+    const Software_F4 z0 = software_f4(tri->v[0].z * tri->inv_area);
+    const Software_F4 z1 = software_f4(tri->v[1].z * tri->inv_area);
+    const Software_F4 z2 = software_f4(tri->v[2].z * tri->inv_area);
+
+    const bool depth_test = (tri->flags & SOFTWARE_DEPTH_TEST) != 0;
+    const bool blend      = (tri->flags & SOFTWARE_BLEND) != 0;
+
+    for (i32 y = y0; y <= y1; y += 1) {
+        const f32 py = (f32)y + 0.5f;
+
+        Software_F4 edge_row[3];
+        foreach (i, 3) {
+            edge_row[i] = software_f4((tri->edge_b[i] * py) + tri->edge_c[i]);
+        }
+
+        u32* color_row = &r->color[y * r->pitch];
+        f32* depth_row = &r->depth[y * r->pitch];
+
+        for (i32 x = x0; x <= x1; x += 4) {
+            const Software_F4 px = software_add(software_f4((f32)x), lane);
+
+            Software_F4 e[3];
+            Software_M4 inside = software_mask(x < (i32)r->width, x + 1 < (i32)r->width, x + 2 < (i32)r->width, x + 3 < (i32)r->width);
+            foreach (i, 3) {
+                e[i] = software_add(software_mul(edge_a[i], px), edge_row[i]);
+                inside = software_and(inside, software_or(
+                    software_gt(e[i], zero),
+                    software_and(software_eq(e[i], zero), top_left[i])
+                ));
+            }
+            if (software_bits(inside) == 0) {
+                continue;
+            }
+
+            // depth clipping against the near and far planes
+            const Software_F4 z = software_add(software_add(software_mul(e[0], z0), software_mul(e[1], z1)), software_mul(e[2], z2));
+            inside = software_and(inside, software_and(software_ge(z, zero), software_le(z, one)));
+
+            if (depth_test) {
+                const Software_F4 d = software_load(&depth_row[x]);
+                inside = software_and(inside, software_lt(z, d));
+                software_store(&depth_row[x], software_select(inside, z, d));
+            }
+
+            const u32 bits = software_bits(inside);
+            if (bits == 0) {
+                continue;
+            }
+
+            f32 e_lanes[3][4];
+            foreach (i, 3) {
+                software_store(e_lanes[i], e[i]);
+            }
+
+            foreach (l, 4) {
+                if ((bits & (1u << l)) == 0) {
+                    continue;
+                }
+
+                const f32 l0 = e_lanes[0][l] * tri->inv_area;
+                const f32 l1 = e_lanes[1][l] * tri->inv_area;
+                const f32 l2 = e_lanes[2][l] * tri->inv_area;
+
+                f32 cr = (tri->v[0].r * l0) + (tri->v[1].r * l1) + (tri->v[2].r * l2);
+                f32 cg = (tri->v[0].g * l0) + (tri->v[1].g * l1) + (tri->v[2].g * l2);
+                f32 cb = (tri->v[0].b * l0) + (tri->v[1].b * l1) + (tri->v[2].b * l2);
+                f32 ca = (tri->v[0].a * l0) + (tri->v[1].a * l1) + (tri->v[2].a * l2);
+
+                if (tri->texture != nullptr) {
+                    const f32 u = (tri->v[0].u * l0) + (tri->v[1].u * l1) + (tri->v[2].u * l2);
+                    const f32 v = (tri->v[0].v * l0) + (tri->v[1].v * l1) + (tri->v[2].v * l2);
+                    const u32 texel = Software_Texture_sample(tri->texture, u, v);
+
+                    cr *= (f32)( texel        & 0xFF) * (1.0f / 255.0f);
+                    cg *= (f32)((texel >> 8)  & 0xFF) * (1.0f / 255.0f);
+                    cb *= (f32)((texel >> 16) & 0xFF) * (1.0f / 255.0f);
+                    ca *= (f32)((texel >> 24) & 0xFF) * (1.0f / 255.0f);
+                }
+
+                u32* dst = &color_row[x + l];
+                if (blend) {
+                    const u32 d = *dst;
+                    const f32 inv_a = 1.0f - glm::clamp(ca, 0.0f, 1.0f);
+                    const f32 a     = 1.0f - inv_a;
+                    *dst = software_pack(
+                        (cr * a) + ((f32)( d        & 0xFF) * (1.0f / 255.0f) * inv_a),
+                        (cg * a) + ((f32)((d >> 8)  & 0xFF) * (1.0f / 255.0f) * inv_a),
+                        (cb * a) + ((f32)((d >> 16) & 0xFF) * (1.0f / 255.0f) * inv_a),
+                        (ca * a) + ((f32)((d >> 24) & 0xFF) * (1.0f / 255.0f) * inv_a)
+                    );
+                } else {
+                    *dst = software_pack(cr, cg, cb, ca);
+                }
+            }
+        }
+    }
+}
+
+static void software_rasterize_tile(Software_Renderer* r, const u32 tile)
+{
+    const i32 tile_x0 = (tile % r->tiles_x) * SOFTWARE_TILE_SIZE;
+    const i32 tile_y0 = (tile / r->tiles_x) * SOFTWARE_TILE_SIZE;
+    const i32 tile_x1 = tile_x0 + SOFTWARE_TILE_SIZE - 1;
+    const i32 tile_y1 = tile_y0 + SOFTWARE_TILE_SIZE - 1;
+
+    if (r->clear_pending) {
+        for (i32 y = tile_y0; y <= tile_y1; y += 1) {
+            u32* color_row = &r->color[y * r->pitch + tile_x0];
+            f32* depth_row = &r->depth[y * r->pitch + tile_x0];
+            foreach (x, SOFTWARE_TILE_SIZE) {
+                color_row[x] = r->clear_color;
+                depth_row[x] = 1.0f;
+            }
+        }
+    }
+
+    // submission order within the tile, so blending matches GL
+    const Software_Bin* bin = &r->bins[tile];
+    foreach (i, bin->count) {
+        software_rasterize_triangle(r, &r->triangles[bin->triangles[i]], tile_x0, tile_y0, tile_x1, tile_y1);
+    }
+}
+
+static void software_rasterize_tiles(Software_Renderer* r)
+{
+    const i32 count_tiles = r->tiles_x * r->tiles_y;
+
+    for (;;) {
+        const i32 tile = SDL_AtomicAdd(&r->next_tile, 1);
+        if (tile >= count_tiles) {
+            break;
+        }
+        software_rasterize_tile(r, tile);
+    }
+}
+
+void Software_Renderer_flush(Software_Renderer* r)
+{
+    foreach (i, r->count_triangles) {
+        const Software_Triangle* tri = &r->triangles[i];
+
+        const u32 tx0 = tri->min_x / SOFTWARE_TILE_SIZE;
+        const u32 ty0 = tri->min_y / SOFTWARE_TILE_SIZE;
+        const u32 tx1 = tri->max_x / SOFTWARE_TILE_SIZE;
+        const u32 ty1 = tri->max_y / SOFTWARE_TILE_SIZE;
+
+        for (u32 ty = ty0; ty <= ty1; ty += 1) {
+            for (u32 tx = tx0; tx <= tx1; tx += 1) {
+                Software_Bin* bin = &r->bins[ty * r->tiles_x + tx];
+                if (bin->count == bin->cap) {
+                    bin->cap = (bin->cap == 0) ? 256 : bin->cap * 2;
+                    bin->triangles = (u32*)xrealloc(bin->triangles, bin->cap * sizeof(u32));
+                }
+                bin->triangles[bin->count] = (u32)i;
+                bin->count += 1;
+            }
+        }
+    }
+
+    SDL_AtomicSet(&r->next_tile, 0);
+
+    foreach (i, r->count_workers) {
+        SDL_SemPost(r->start);
+    }
+    // the calling thread takes tiles too
+    software_rasterize_tiles(r);
+    foreach (i, r->count_workers) {
+        SDL_SemWait(r->done);
+    }
+
+    foreach (i, r->tiles_x * r->tiles_y) {
+        r->bins[i].count = 0;
+    }
+    r->count_triangles = 0;
+    r->clear_pending   = false;
+}
+
+bool Software_Renderer_save_png(Software_Renderer* r, const char* path)
+{
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(
+        r->color, r->width, r->height, 32, r->pitch * sizeof(u32), SDL_PIXELFORMAT_RGBA32
+    );
+    if (surface == nullptr) {
+        fprintf(stderr, "ERROR: Software_Renderer_save_png %s, SDL Error: %s\n", path, SDL_GetError());
+        return false;
+    }
+
+    const bool ok = (IMG_SavePNG(surface, path) == 0);
+    if (!ok) {
+        fprintf(stderr, "ERROR: Software_Renderer_save_png %s, SDL_image Error: %s\n", path, IMG_GetError());
+    }
+
+    SDL_FreeSurface(surface);
+
+    return ok;
+}
+
+#endif
@@ -1,7 +1,25 @@
 #include "texture.hpp"
 
+#include <sys/stat.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define TEXTURE_MIP_SSE2
+#endif
+#ifndef _WIN32
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
 GLboolean GL_texture_load(Texture* texture_id, const char* const path, const GLboolean alpha, const GLint param_edge_x, const GLint param_edge_y)
 {
+    char cooked_path[TEXTURE_LOADER_PATH_MAX];
+    // straight alpha only, a premultiplied cooked file falls back to the image
+    if (texture_cooked_find(cooked_path, sizeof(cooked_path), path) &&
+        GL_texture_load_cooked(texture_id, cooked_path, param_edge_x, param_edge_y, nullptr)) {
+        return GL_TRUE;
+    }
+
     // load image
     printf("loading %s\n", path);
     SDL_Surface* img = NULL; 
@@ -41,3 +59,1010 @@ GLboolean GL_texture_gen_and_load_1(Texture* texture_id, const char* const path,
     glGenTextures(1, texture_id);
     return GL_texture_load(texture_id, path, alpha, param_edge_x, param_edge_y);   
 }
+
+// FILTERING
+
+bool texture_filter_uses_mips(const TEXTURE_FILTER filter)
+{
+    return filter == TEXTURE_FILTER::NEAREST_MIPMAP || filter == TEXTURE_FILTER::TRILINEAR;
+}
+
+bool texture_filter_parse(const char* name, TEXTURE_FILTER* filter)
+{
+    static const char* const names[] = {"nearest", "nearest_mipmap", "linear", "trilinear"};
+    foreach (i, StaticArrayCount(names)) {
+        if (strcmp(name, names[i]) == 0) {
+            *filter = (TEXTURE_FILTER)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void GL_texture_apply_filter(const GLenum target, const TEXTURE_FILTER filter, const u32 mip_count)
+{
+    GLint min_filter = GL_NEAREST;
+    GLint mag_filter = GL_NEAREST;
+    switch (filter) {
+    case TEXTURE_FILTER::NEAREST: {
+        break;
+    }
+    case TEXTURE_FILTER::NEAREST_MIPMAP: {
+        min_filter = GL_NEAREST_MIPMAP_LINEAR;
+        break;
+    }
+    case TEXTURE_FILTER::LINEAR: {
+        min_filter = GL_LINEAR;
+        mag_filter = GL_LINEAR;
+        break;
+    }
+    case TEXTURE_FILTER::TRILINEAR: {
+        min_filter = GL_LINEAR_MIPMAP_LINEAR;
+        mag_filter = GL_LINEAR;
+        break;
+    }
+    }
+
+    const u32 levels = (texture_filter_uses_mips(filter)) ? glm::max(mip_count, 1u) : 1;
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, min_filter);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, mag_filter);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
+
+// MIP CHAINS
+
+// one texel from its 2x2 footprint a b / c d
+static inline void texture_mip_texel(const u8* a, const u8* b, const u8* c, const u8* d, u8* out, const bool premultiplied)
+{
+    const u32 alpha = a[3] + b[3] + c[3] + d[3];
+    // equal weights, the weighted average would be the same
+    if (premultiplied || alpha == 0 || alpha == 4 * 255) {
+        foreach (k, 4) {
+            out[k] = (u8)((a[k] + b[k] + c[k] + d[k] + 2) >> 2);
+        }
+        return;
+    }
+
+    foreach (k, 3) {
+        const u32 weighted = (a[k] * a[3]) + (b[k] * b[3]) + (c[k] * c[3]) + (d[k] * d[3]);
+        out[k] = (u8)((weighted + (alpha / 2)) / alpha);
+    }
+    out[3] = (u8)((alpha + 2) >> 2);
+}
+
+#ifdef TEXTURE_MIP_SSE2
+
+static inline __m128 texture_mip_load_texel(const u8* p)
+{
+    const __m128i zero = _mm_setzero_si128();
+    i32 v;
+    memcpy(&v, p, sizeof(v));
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zero), zero));
+}
+
+// two premultiplied texels from two rows of four, 16-bit sums
+static inline void texture_mip_texels2_premultiplied(const u8* row0, const u8* row1, u8* out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i r0 = _mm_loadu_si128((const __m128i*)row0);
+    const __m128i r1 = _mm_loadu_si128((const __m128i*)row1);
+
+    // columns 0 1 and 2 3 summed over both rows
+    const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(r0, zero), _mm_unpacklo_epi8(r1, zero));
+    const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(r0, zero), _mm_unpackhi_epi8(r1, zero));
+    // then the two columns of each pair
+    const __m128i sum_lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+    const __m128i sum_hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+    const __m128i sum = _mm_unpacklo_epi64(sum_lo, sum_hi);
+
+    const __m128i avg = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+    _mm_storel_epi64((__m128i*)out, _mm_packus_epi16(avg, zero));
+}
+
+static inline void texture_mip_texel_straight(const u8* a, const u8* b, const u8* c, const u8* d, u8* out)
+{
+    const __m128 pa = texture_mip_load_texel(a);
+    const __m128 pb = texture_mip_load_texel(b);
+    const __m128 pc = texture_mip_load_texel(c);
+    const __m128 pd = texture_mip_load_texel(d);
+    const __m128 wa = _mm_shuffle_ps(pa, pa, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128 wb = _mm_shuffle_ps(pb, pb, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128 wc = _mm_shuffle_ps(pc, pc, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128 wd = _mm_shuffle_ps(pd, pd, _MM_SHUFFLE(3, 3, 3, 3));
+
+    const __m128 alpha    = _mm_add_ps(_mm_add_ps(wa, wb), _mm_add_ps(wc, wd));
+    const __m128 average  = _mm_mul_ps(_mm_add_ps(_mm_add_ps(pa, pb), _mm_add_ps(pc, pd)), _mm_set1_ps(0.25f));
+    const __m128 weighted = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(pa, wa), _mm_mul_ps(pb, wb)),
+        _mm_add_ps(_mm_mul_ps(pc, wc), _mm_mul_ps(pd, wd))
+    );
+    const __m128 colour = _mm_div_ps(weighted, _mm_max_ps(alpha, _mm_set1_ps(1.0f)));
+
+    // colour weighted where there is any alpha, the plain average otherwise and always for alpha itself
+    const __m128 use_weighted = _mm_and_ps(
+        _mm_cmpgt_ps(alpha, _mm_setzero_ps()),
+        _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0))
+    );
+    const __m128 texel = _mm_or_ps(_mm_and_ps(use_weighted, colour), _mm_andnot_ps(use_weighted, average));
+
+    const __m128i packed = _mm_cvtps_epi32(texel);
+    const i32 v = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(packed, packed), _mm_setzero_si128()));
+    memcpy(out, &v, sizeof(v));
+}
+
+#endif
+
+void texture_mip_downsample(const u8* src, const u32 src_w, const u32 src_h, const usize src_pitch, u8* dst, const u32 dst_w, const u32 dst_h, const bool premultiplied)
+{
+    foreach (y, dst_h) {
+        // the last row or column repeats where the source is a single texel across
+        const u8* row0 = src + ((usize)glm::min((u32)y * 2, src_h - 1) * src_pitch);
+        const u8* row1 = src + ((usize)glm::min((u32)y * 2 + 1, src_h - 1) * src_pitch);
+        u8* out = dst + ((usize)y * dst_w * 4);
+
+        u32 x = 0;
+        #ifdef TEXTURE_MIP_SSE2
+        if (premultiplied) {
+            for (; (x * 2) + 3 < src_w; x += 2) {
+                texture_mip_texels2_premultiplied(row0 + (x * 8), row1 + (x * 8), out + (x * 4));
+            }
+        } else {
+            for (; x < dst_w && (x * 2) + 1 < src_w; x += 1) {
+                texture_mip_texel_straight(row0 + (x * 8), row0 + (x * 8) + 4, row1 + (x * 8), row1 + (x * 8) + 4, out + (x * 4));
+            }
+        }
+        #endif
+        for (; x < dst_w; x += 1) {
+            const u32 x0 = glm::min(x * 2, src_w - 1);
+            const u32 x1 = glm::min(x * 2 + 1, src_w - 1);
+            texture_mip_texel(row0 + (x0 * 4), row0 + (x1 * 4), row1 + (x0 * 4), row1 + (x1 * 4), out + (x * 4), premultiplied);
+        }
+    }
+}
+
+u32 texture_mip_levels(const u32 width, const u32 height, const u32 max_levels, const usize first_offset, const usize alignment, Texture_Cooked_File_Mip* levels, usize* end)
+{
+    const u32 limit = glm::clamp(max_levels, 1u, (u32)TEXTURE_COOKED_MAX_MIPS);
+    usize offset = first_offset;
+    u32 count = 0;
+    u32 w = width;
+    u32 h = height;
+    for (;;) {
+        Texture_Cooked_File_Mip* level = &levels[count];
+        level->width  = w;
+        level->height = h;
+        level->offset = offset;
+        level->size   = (u64)w * h * 4;
+        offset = (offset + level->size + (alignment - 1)) & ~(alignment - 1);
+        count += 1;
+
+        if ((w == 1 && h == 1) || count == limit) {
+            break;
+        }
+        w = glm::max(w / 2, 1u);
+        h = glm::max(h / 2, 1u);
+    }
+
+    *end = offset;
+    return count;
+}
+
+void Texture_Mip_Chain_make(Texture_Mip_Chain* chain, SDL_Surface* rgba, const Texture_Cooked* cooked, const u32 max_levels)
+{
+    chain->data          = nullptr;
+    chain->premultiplied = Texture_Cooked_premultiplied(cooked);
+
+    // cooked files carry every level
+    const Texture_Cooked_File_Header* header = cooked->header;
+    if (header != nullptr) {
+        chain->count = glm::clamp(header->mip_count, 1u, glm::max(max_levels, 1u));
+        memcpy(chain->levels, header->mips, chain->count * sizeof(Texture_Cooked_File_Mip));
+        chain->base = (const u8*)header;
+        return;
+    }
+
+    usize end;
+    chain->count = texture_mip_levels(rgba->w, rgba->h, max_levels, 0, TEXTURE_COOKED_ALIGNMENT, chain->levels, &end);
+    chain->base  = nullptr;
+    if (chain->count == 1) {
+        return;
+    }
+
+    // only the levels above 0 are stored
+    const usize skipped = chain->levels[1].offset;
+    for (u32 l = 1; l < chain->count; l += 1) {
+        chain->levels[l].offset -= skipped;
+    }
+    chain->data = (u8*)xmalloc(end - skipped);
+    chain->base = chain->data;
+
+    SDL_LockSurface(rgba);
+    // decoded images have straight alpha
+    for (u32 l = 1; l < chain->count; l += 1) {
+        const Texture_Cooked_File_Mip* src = &chain->levels[l - 1];
+        const Texture_Cooked_File_Mip* dst = &chain->levels[l];
+        const usize pitch = (l == 1) ? (usize)rgba->pitch : (usize)src->width * 4;
+        texture_mip_downsample(
+            Texture_Mip_Chain_level(chain, rgba, l - 1), src->width, src->height, pitch,
+            chain->data + dst->offset, dst->width, dst->height, false
+        );
+    }
+    SDL_UnlockSurface(rgba);
+}
+
+const u8* Texture_Mip_Chain_level(const Texture_Mip_Chain* chain, SDL_Surface* rgba, const u32 level)
+{
+    return (level == 0) ? (const u8*)rgba->pixels : chain->base + chain->levels[level].offset;
+}
+
+void Texture_Mip_Chain_free(Texture_Mip_Chain* chain)
+{
+    ::free(chain->data);
+    chain->data  = nullptr;
+    chain->base  = nullptr;
+    chain->count = 0;
+}
+
+// COOKED TEXTURES
+
+static usize texture_cooked_align(const usize offset)
+{
+    return (offset + (TEXTURE_COOKED_ALIGNMENT - 1)) & ~(usize)(TEXTURE_COOKED_ALIGNMENT - 1);
+}
+
+static void texture_cook_premultiply(u8* pixels, const usize count_pixels)
+{
+    foreach (i, count_pixels) {
+        u8* p = &pixels[i * 4];
+        const u32 a = p[3];
+        p[0] = (u8)((p[0] * a + 127) / 255);
+        p[1] = (u8)((p[1] * a + 127) / 255);
+        p[2] = (u8)((p[2] * a + 127) / 255);
+    }
+}
+
+bool texture_cook(const char* image_path, const char* out_path, const bool premultiply, const TEXTURE_FILTER filter)
+{
+    SDL_Surface* img = IMG_Load(image_path);
+    if (img == nullptr) {
+        fprintf(stderr, "SDL_image could not be loaded %s, SDL_image Error: %s\n", image_path, IMG_GetError());
+        return false;
+    }
+    SDL_Surface* rgba = SDL_ConvertSurfaceFormat(img, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(img);
+    if (rgba == nullptr) {
+        fprintf(stderr, "ERROR: %s, SDL Error: %s\n", image_path, SDL_GetError());
+        return false;
+    }
+
+    Texture_Cooked_File_Header header;
+    memset(&header, 0, sizeof(header));
+    header.magic   = TEXTURE_COOKED_MAGIC;
+    header.version = TEXTURE_COOKED_VERSION;
+    header.width   = rgba->w;
+    header.height  = rgba->h;
+    header.format  = TEXTURE_COOKED_FORMAT::RGBA8;
+    header.flags   = (premultiply) ? TEXTURE_COOKED_FLAG_PREMULTIPLIED : 0;
+    header.filter  = filter;
+
+    // every level whatever the filter, so that the policy can change at load time
+    usize size;
+    header.mip_count = texture_mip_levels(
+        header.width, header.height, TEXTURE_COOKED_MAX_MIPS,
+        texture_cooked_align(sizeof(header)), TEXTURE_COOKED_ALIGNMENT, header.mips, &size
+    );
+
+    u8* data = (u8*)xcalloc(size, 1);
+    memcpy(data, &header, sizeof(header));
+
+    u8* base = data + header.mips[0].offset;
+    SDL_LockSurface(rgba);
+    foreach (y, header.height) {
+        memcpy(base + (y * header.width * 4), (const u8*)rgba->pixels + (y * rgba->pitch), header.width * 4);
+    }
+    SDL_UnlockSurface(rgba);
+    SDL_FreeSurface(rgba);
+
+    // filtered after premultiplying so that transparent texels do not bleed their colour
+    if (premultiply) {
+        texture_cook_premultiply(base, (usize)header.width * header.height);
+    }
+    for (u32 l = 1; l < header.mip_count; l += 1) {
+        const Texture_Cooked_File_Mip* src = &header.mips[l - 1];
+        const Texture_Cooked_File_Mip* dst = &header.mips[l];
+        texture_mip_downsample(data + src->offset, src->width, src->height, (usize)src->width * 4, data + dst->offset, dst->width, dst->height, premultiply);
+    }
+
+    FILE* out = fopen(out_path, "wb");
+    if (out == nullptr) {
+        fprintf(stderr, "ERROR: could not open %s for writing\n", out_path);
+        ::free(data);
+        return false;
+    }
+    const bool written = fwrite(data, 1, size, out) == size;
+    fclose(out);
+    ::free(data);
+
+    if (!written) {
+        fprintf(stderr, "ERROR: could not write %s\n", out_path);
+        return false;
+    }
+
+    return true;
+}
+
+static f64 texture_cook_ms_since(const u64 begin)
+{
+    return (f64)((SDL_GetPerformanceCounter() - begin) * 1000) / (f64)SDL_GetPerformanceFrequency();
+}
+
+bool texture_cook_files(const char* const* paths, const usize count_paths, const bool premultiply, const TEXTURE_FILTER filter)
+{
+    usize cooked_count = 0;
+    f64 decode_ms = 0.0;
+    f64 map_ms    = 0.0;
+    // read back so that mapping pays for its page faults too
+    volatile u32 sink = 0;
+
+    foreach (i, count_paths) {
+        char out_path[TEXTURE_LOADER_PATH_MAX];
+        texture_cooked_path(out_path, sizeof(out_path), paths[i]);
+        if (!texture_cook(paths[i], out_path, premultiply, filter)) {
+            continue;
+        }
+        cooked_count += 1;
+
+        u64 begin = SDL_GetPerformanceCounter();
+        SDL_Surface* img = IMG_Load(paths[i]);
+        if (img != nullptr) {
+            SDL_Surface* rgba = SDL_ConvertSurfaceFormat(img, SDL_PIXELFORMAT_RGBA32, 0);
+            SDL_FreeSurface(img);
+            if (rgba != nullptr) {
+                sink += ((const u8*)rgba->pixels)[0];
+                SDL_FreeSurface(rgba);
+            }
+        }
+        decode_ms += texture_cook_ms_since(begin);
+
+        begin = SDL_GetPerformanceCounter();
+        Texture_Cooked cooked;
+        if (Texture_Cooked_open(&cooked, out_path)) {
+            const u8* level = Texture_Cooked_level(&cooked, 0);
+            const usize level_size = cooked.header->mips[0].size;
+            for (usize b = 0; b < level_size; b += 4096) {
+                sink += level[b];
+            }
+            Texture_Cooked_close(&cooked);
+        }
+        map_ms += texture_cook_ms_since(begin);
+
+        printf("cooked %s -> %s\n", paths[i], out_path);
+    }
+
+    printf("%llu of %llu images cooked\n", (unsigned long long)cooked_count, (unsigned long long)count_paths);
+    printf("%-40s %10.3lf ms\n", "before: IMG_Load + convert", decode_ms);
+    printf("%-40s %10.3lf ms\n", "after: map cooked level 0", map_ms);
+
+    return cooked_count == count_paths;
+}
+
+void texture_cooked_path(char* out, const usize cap, const char* image_path)
+{
+    const char* dot   = strrchr(image_path, '.');
+    const char* slash = strrchr(image_path, '/');
+    // a dot in a directory name is not an extension
+    const usize stem = (dot != nullptr && (slash == nullptr || dot > slash)) ? (usize)(dot - image_path) : strlen(image_path);
+    snprintf(out, cap, "%.*s%s", (int)stem, image_path, TEXTURE_COOKED_EXTENSION);
+}
+
+bool texture_cooked_find(char* out, const usize cap, const char* image_path)
+{
+    texture_cooked_path(out, cap, image_path);
+
+    struct stat cooked_info;
+    if (stat(out, &cooked_info) != 0) {
+        return false;
+    }
+    // a missing source is fine, only the cooked file may ship
+    struct stat image_info;
+    return stat(image_path, &image_info) != 0 || cooked_info.st_mtime >= image_info.st_mtime;
+}
+
+bool Texture_Cooked_open(Texture_Cooked* cooked, const char* path)
+{
+    cooked->header = nullptr;
+    cooked->size   = 0;
+
+    #ifdef _WIN32
+    FILE* in = fopen(path, "rb");
+    if (in == nullptr) {
+        fprintf(stderr, "ERROR: could not open %s\n", path);
+        return false;
+    }
+    fseek(in, 0, SEEK_END);
+    const long length = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    void* data = (length > 0) ? xmalloc(length) : nullptr;
+    if (data == nullptr || fread(data, 1, length, in) != (usize)length) {
+        fprintf(stderr, "ERROR: could not read %s\n", path);
+        ::free(data);
+        fclose(in);
+        return false;
+    }
+    fclose(in);
+    cooked->size = length;
+    #else
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: could not open %s\n", path);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        fprintf(stderr, "ERROR: could not stat %s\n", path);
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps the file alive
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "ERROR: could not map %s\n", path);
+        return false;
+    }
+    cooked->size = info.st_size;
+    #endif
+    cooked->header = (const Texture_Cooked_File_Header*)data;
+
+    const Texture_Cooked_File_Header* header = cooked->header;
+    bool valid = cooked->size >= sizeof(Texture_Cooked_File_Header) &&
+                 header->magic == TEXTURE_COOKED_MAGIC &&
+                 header->version == TEXTURE_COOKED_VERSION &&
+                 header->format == TEXTURE_COOKED_FORMAT::RGBA8 &&
+                 header->mip_count >= 1 && header->mip_count <= TEXTURE_COOKED_MAX_MIPS;
+    for (u32 l = 0; valid && l < header->mip_count; l += 1) {
+        const Texture_Cooked_File_Mip* mip = &header->mips[l];
+        valid = mip->size == (u64)mip->width * mip->height * 4 &&
+                mip->offset <= cooked->size && mip->size <= cooked->size - mip->offset;
+    }
+    if (!valid) {
+        fprintf(stderr, "ERROR: %s is not a cooked texture of version %u\n", path, TEXTURE_COOKED_VERSION);
+        Texture_Cooked_close(cooked);
+        return false;
+    }
+
+    return true;
+}
+
+const u8* Texture_Cooked_level(const Texture_Cooked* cooked, const u32 level)
+{
+    return (const u8*)cooked->header + cooked->header->mips[level].offset;
+}
+
+bool Texture_Cooked_premultiplied(const Texture_Cooked* cooked)
+{
+    return cooked->header != nullptr && (cooked->header->flags & TEXTURE_COOKED_FLAG_PREMULTIPLIED) != 0;
+}
+
+void Texture_Cooked_close(Texture_Cooked* cooked)
+{
+    if (cooked->header == nullptr) {
+        return;
+    }
+
+    #ifdef _WIN32
+    ::free((void*)cooked->header);
+    #else
+    munmap((void*)cooked->header, cooked->size);
+    #endif
+    cooked->header = nullptr;
+    cooked->size   = 0;
+}
+
+void GL_texture_blend_func(const bool premultiplied)
+{
+    if (premultiplied) {
+        gl_blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    } else {
+        gl_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+}
+
+GLboolean GL_texture_load_cooked(Texture* texture_id, const char* const path, const GLint param_edge_x, const GLint param_edge_y, bool* premultiplied)
+{
+    printf("loading %s\n", path);
+    Texture_Cooked cooked;
+    if (!Texture_Cooked_open(&cooked, path)) {
+        return GL_FALSE;
+    }
+    if (premultiplied != nullptr) {
+        *premultiplied = Texture_Cooked_premultiplied(&cooked);
+    } else if (Texture_Cooked_premultiplied(&cooked)) {
+        fprintf(stderr, "ERROR: %s is premultiplied, the caller blends straight alpha\n", path);
+        Texture_Cooked_close(&cooked);
+        return GL_FALSE;
+    }
+
+    const Texture_Cooked_File_Header* header = cooked.header;
+    const u32 levels = (texture_filter_uses_mips(header->filter)) ? header->mip_count : 1;
+    glBindTexture(GL_TEXTURE_2D, *texture_id);
+    for (u32 l = 0; l < levels; l += 1) {
+        glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, header->mips[l].width, header->mips[l].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, Texture_Cooked_level(&cooked, l));
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, param_edge_x);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, param_edge_y);
+    GL_texture_apply_filter(GL_TEXTURE_2D, header->filter, levels);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    Texture_Cooked_close(&cooked);
+
+    return GL_TRUE;
+}
+
+SDL_Surface* texture_rgba_load(const char* path, Texture_Cooked* cooked, bool* premultiplied)
+{
+    cooked->header = nullptr;
+    cooked->size   = 0;
+    *premultiplied = false;
+
+    char cooked_path[TEXTURE_LOADER_PATH_MAX];
+    if (texture_cooked_find(cooked_path, sizeof(cooked_path), path) && Texture_Cooked_open(cooked, cooked_path)) {
+        const Texture_Cooked_File_Header* header = cooked->header;
+        SDL_Surface* view = SDL_CreateRGBSurfaceWithFormatFrom(
+            (void*)Texture_Cooked_level(cooked, 0), header->width, header->height, 32, header->width * 4, SDL_PIXELFORMAT_RGBA32
+        );
+        if (view != nullptr) {
+            *premultiplied = Texture_Cooked_premultiplied(cooked);
+            return view;
+        }
+        Texture_Cooked_close(cooked);
+    }
+
+    SDL_Surface* img = IMG_Load(path);
+    if (img == nullptr) {
+        fprintf(stderr, "SDL_image could not be loaded %s, SDL_image Error: %s\n", path, IMG_GetError());
+        return nullptr;
+    }
+    SDL_Surface* rgba = SDL_ConvertSurfaceFormat(img, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(img);
+    if (rgba == nullptr) {
+        fprintf(stderr, "ERROR: %s, SDL Error: %s\n", path, SDL_GetError());
+    }
+    return rgba;
+}
+
+void texture_rgba_free(SDL_Surface* surface, Texture_Cooked* cooked)
+{
+    SDL_FreeSurface(surface);
+    Texture_Cooked_close(cooked);
+}
+
+// ASYNC LOADING
+
+static void texture_load_queue_push(Texture_Load_Queue* queue, const u32 slot)
+{
+    SDL_AtomicLock(&queue->lock);
+    queue->items[(queue->head + queue->count) % TEXTURE_LOADER_MAX_SLOTS] = slot;
+    queue->count += 1;
+    SDL_AtomicUnlock(&queue->lock);
+}
+
+static bool texture_load_queue_pop(Texture_Load_Queue* queue, u32* slot)
+{
+    bool popped = false;
+    SDL_AtomicLock(&queue->lock);
+    if (queue->count > 0) {
+        *slot = queue->items[queue->head];
+        queue->head = (queue->head + 1) % TEXTURE_LOADER_MAX_SLOTS;
+        queue->count -= 1;
+        popped = true;
+    }
+    SDL_AtomicUnlock(&queue->lock);
+    return popped;
+}
+
+static int texture_loader_worker(void* data)
+{
+    Texture_Loader* loader = (Texture_Loader*)data;
+
+    for (;;) {
+        SDL_SemWait(loader->jobs);
+        if (SDL_AtomicGet(&loader->quit)) {
+            break;
+        }
+
+        u32 index;
+        if (!texture_load_queue_pop(&loader->to_decode, &index)) {
+            continue;
+        }
+        Texture_Load_Slot* slot = &loader->slots[index];
+
+        SDL_Surface* rgba = nullptr;
+        slot->cooked.header = nullptr;
+        if (!SDL_AtomicGet(&slot->abandoned)) {
+            rgba = texture_rgba_load(slot->path, &slot->cooked, &slot->premultiplied);
+            if (rgba != nullptr) {
+                Texture_Mip_Chain_make(&slot->mips, rgba, &slot->cooked, (texture_filter_uses_mips(slot->filter)) ? TEXTURE_COOKED_MAX_MIPS : 1);
+            }
+        }
+
+        // published through the queue lock
+        slot->surface = rgba;
+        texture_load_queue_push(&loader->decoded, index);
+    }
+
+    return 0;
+}
+
+bool Texture_Loader_init(Texture_Loader* loader, const u32 worker_count, const usize bytes_per_frame)
+{
+    loader->slots = (Texture_Load_Slot*)xcalloc(TEXTURE_LOADER_MAX_SLOTS, sizeof(Texture_Load_Slot));
+    loader->to_decode.head  = 0;
+    loader->to_decode.count = 0;
+    loader->to_decode.lock  = 0;
+    loader->decoded.head    = 0;
+    loader->decoded.count   = 0;
+    loader->decoded.lock    = 0;
+
+    loader->uploading       = -1;
+    loader->pbo_next        = 0;
+    loader->bytes_per_frame = bytes_per_frame;
+    // at least one row of the widest texture GL allows
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    loader->pbo_size = glm::max(bytes_per_frame, (usize)max_size * 4);
+
+    glGenBuffers(TEXTURE_LOADER_PBO_COUNT, loader->pbos);
+    foreach (i, TEXTURE_LOADER_PBO_COUNT) {
+        gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, loader->pbos[i]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, loader->pbo_size, NULL, GL_STREAM_DRAW);
+    }
+    gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    const u8 grey[4] = {128, 128, 128, 255};
+    glGenTextures(1, &loader->placeholder);
+    glBindTexture(GL_TEXTURE_2D, loader->placeholder);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    gl_state_invalidate();
+
+    SDL_AtomicSet(&loader->quit, 0);
+    loader->jobs = SDL_CreateSemaphore(0);
+    loader->worker_count = 0;
+    if (loader->jobs == nullptr) {
+        fprintf(stderr, "ERROR: texture loader semaphore, SDL Error: %s\n", SDL_GetError());
+        Texture_Loader_free(loader);
+        return false;
+    }
+
+    const u32 count = glm::clamp(worker_count, 1u, (u32)TEXTURE_LOADER_MAX_WORKERS);
+    foreach (i, count) {
+        SDL_Thread* worker = SDL_CreateThread(texture_loader_worker, "texture_loader", (void*)loader);
+        if (worker == nullptr) {
+            break;
+        }
+        loader->workers[loader->worker_count] = worker;
+        loader->worker_count += 1;
+    }
+    if (loader->worker_count == 0) {
+        fprintf(stderr, "ERROR: texture loader threads, SDL Error: %s\n", SDL_GetError());
+        Texture_Loader_free(loader);
+        return false;
+    }
+
+    return true;
+}
+
+static Texture_Handle texture_loader_enqueue(Texture_Loader* loader, const char* path, const GLint edge_x, const GLint edge_y, const TEXTURE_FILTER filter, Texture_Array_Target* array, const u32 layer)
+{
+    if (strlen(path) >= TEXTURE_LOADER_PATH_MAX) {
+        fprintf(stderr, "ERROR: texture path too long: %s\n", path);
+        return 0;
+    }
+
+    foreach (i, TEXTURE_LOADER_MAX_SLOTS) {
+        Texture_Load_Slot* slot = &loader->slots[i];
+        if (slot->state != TEXTURE_LOAD_STATE::FREE) {
+            continue;
+        }
+
+        slot->state = TEXTURE_LOAD_STATE::QUEUED;
+        strcpy(slot->path, path);
+        slot->edge_x        = edge_x;
+        slot->edge_y        = edge_y;
+        slot->filter        = filter;
+        slot->array         = array;
+        slot->layer         = layer;
+        slot->surface       = nullptr;
+        slot->cooked.header = nullptr;
+        slot->mips.data     = nullptr;
+        slot->mips.count    = 0;
+        slot->texture       = 0;
+        slot->premultiplied = false;
+        slot->level         = 0;
+        slot->rows_uploaded = 0;
+        SDL_AtomicSet(&slot->abandoned, 0);
+
+        texture_load_queue_push(&loader->to_decode, (u32)i);
+        SDL_SemPost(loader->jobs);
+
+        return (Texture_Handle)(i + 1);
+    }
+
+    fprintf(stderr, "ERROR: texture loader has no free slot for %s\n", path);
+    return 0;
+}
+
+Texture_Handle Texture_Loader_request(Texture_Loader* loader, const char* path, const GLint edge_x, const GLint edge_y, const TEXTURE_FILTER filter)
+{
+    return texture_loader_enqueue(loader, path, edge_x, edge_y, filter, nullptr, 0);
+}
+
+Texture_Handle Texture_Loader_request_slice(Texture_Loader* loader, const char* path, Texture_Array_Target* array, const u32 layer)
+{
+    if (layer >= array->depth) {
+        fprintf(stderr, "ERROR: %s, slice %u of an array of %u\n", path, layer, array->depth);
+        return 0;
+    }
+    return texture_loader_enqueue(loader, path, array->edge_x, array->edge_y, array->filter, array, layer);
+}
+
+static void texture_loader_free_pixels(Texture_Load_Slot* slot)
+{
+    Texture_Mip_Chain_free(&slot->mips);
+    texture_rgba_free(slot->surface, &slot->cooked);
+    slot->surface = nullptr;
+}
+
+static void texture_loader_finish(Texture_Load_Slot* slot, const TEXTURE_LOAD_STATE state)
+{
+    texture_loader_free_pixels(slot);
+    slot->state = state;
+
+    if (slot->array != nullptr) {
+        if (state == TEXTURE_LOAD_STATE::READY) {
+            slot->array->slices_ready += 1;
+        } else {
+            slot->array->failed = true;
+        }
+    }
+}
+
+// allocates the destination, false if the slot failed
+static bool texture_loader_begin_upload(Texture_Load_Slot* slot)
+{
+    SDL_Surface* surface = slot->surface;
+    if (surface == nullptr) {
+        texture_loader_finish(slot, TEXTURE_LOAD_STATE::FAILED);
+        return false;
+    }
+
+    const Texture_Mip_Chain* mips = &slot->mips;
+    Texture_Array_Target* array = slot->array;
+    if (array == nullptr) {
+        glGenTextures(1, &slot->texture);
+        gl_bind_texture(GL_TEXTURE_2D, slot->texture);
+        for (u32 l = 0; l < mips->count; l += 1) {
+            glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, mips->levels[l].width, mips->levels[l].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, slot->edge_x);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, slot->edge_y);
+        GL_texture_apply_filter(GL_TEXTURE_2D, slot->filter, mips->count);
+    } else if (array->texture == 0) {
+        array->width     = surface->w;
+        array->height    = surface->h;
+        array->mip_count     = mips->count;
+        array->premultiplied = mips->premultiplied;
+        glGenTextures(1, &array->texture);
+        gl_bind_texture(GL_TEXTURE_2D_ARRAY, array->texture);
+        for (u32 l = 0; l < mips->count; l += 1) {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, l, GL_RGBA8, mips->levels[l].width, mips->levels[l].height, array->depth, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, array->edge_x);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, array->edge_y);
+        GL_texture_apply_filter(GL_TEXTURE_2D_ARRAY, array->filter, array->mip_count);
+    } else if ((u32)surface->w != array->width || (u32)surface->h != array->height || mips->count != array->mip_count) {
+        fprintf(stderr, "ERROR: %s is %dx%d with %u levels, the array is %ux%u with %u\n", slot->path, surface->w, surface->h, mips->count, array->width, array->height, array->mip_count);
+        texture_loader_finish(slot, TEXTURE_LOAD_STATE::FAILED);
+        return false;
+    } else if (mips->premultiplied != array->premultiplied) {
+        fprintf(stderr, "ERROR: %s does not match the alpha mode of the other slices\n", slot->path);
+        texture_loader_finish(slot, TEXTURE_LOAD_STATE::FAILED);
+        return false;
+    }
+
+    slot->level         = 0;
+    slot->rows_uploaded = 0;
+    slot->state = TEXTURE_LOAD_STATE::UPLOADING;
+    return true;
+}
+
+u32 Texture_Loader_update(Texture_Loader* loader)
+{
+    u32 completed = 0;
+    usize budget  = loader->bytes_per_frame;
+    bool  bound_pbo = false;
+
+    while (budget > 0) {
+        if (loader->uploading < 0) {
+            u32 index;
+            if (!texture_load_queue_pop(&loader->decoded, &index)) {
+                break;
+            }
+
+            Texture_Load_Slot* slot = &loader->slots[index];
+            if (SDL_AtomicGet(&slot->abandoned)) {
+                texture_loader_free_pixels(slot);
+                slot->state = TEXTURE_LOAD_STATE::FREE;
+                continue;
+            }
+            if (!texture_loader_begin_upload(slot)) {
+                continue;
+            }
+            loader->uploading = (i32)index;
+        }
+
+        Texture_Load_Slot* slot = &loader->slots[loader->uploading];
+        SDL_Surface* surface = slot->surface;
+        const Texture_Cooked_File_Mip* level = &slot->mips.levels[slot->level];
+
+        // whole rows, at least one so that progress is made whatever the budget
+        const usize row_bytes = (usize)level->width * 4;
+        const u32 rows_left   = level->height - slot->rows_uploaded;
+        const u32 rows        = (u32)glm::min((usize)rows_left, glm::max(budget, row_bytes) / row_bytes);
+        const usize bytes     = (usize)rows * row_bytes;
+
+        // a different buffer each time so the driver is not waiting on the one still being read
+        gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, loader->pbos[loader->pbo_next]);
+        loader->pbo_next = (loader->pbo_next + 1) % TEXTURE_LOADER_PBO_COUNT;
+        bound_pbo = true;
+
+        u8* dst = (u8*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (dst == nullptr) {
+            fprintf(stderr, "ERROR: texture loader could not map a pixel buffer for %s\n", slot->path);
+            if (slot->texture != 0) {
+                glDeleteTextures(1, &slot->texture);
+                slot->texture = 0;
+            }
+            texture_loader_finish(slot, TEXTURE_LOAD_STATE::FAILED);
+            loader->uploading = -1;
+            break;
+        }
+
+        // level 0 is the surface, the levels above are tightly packed
+        const usize pitch = (slot->level == 0) ? (usize)surface->pitch : row_bytes;
+        SDL_LockSurface(surface);
+        const u8* src = Texture_Mip_Chain_level(&slot->mips, surface, slot->level) + ((usize)slot->rows_uploaded * pitch);
+        foreach (r, rows) {
+            memcpy(dst + (r * row_bytes), src + (r * pitch), row_bytes);
+        }
+        SDL_UnlockSurface(surface);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        if (slot->array == nullptr) {
+            gl_bind_texture(GL_TEXTURE_2D, slot->texture);
+            glTexSubImage2D(GL_TEXTURE_2D, slot->level, 0, slot->rows_uploaded, level->width, rows, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+        } else {
+            gl_bind_texture(GL_TEXTURE_2D_ARRAY, slot->array->texture);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, slot->level, 0, slot->rows_uploaded, slot->layer, level->width, rows, 1, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+        }
+
+        slot->rows_uploaded += rows;
+        budget -= glm::min(budget, bytes);
+
+        if (slot->rows_uploaded == level->height) {
+            slot->level        += 1;
+            slot->rows_uploaded = 0;
+        }
+        if (slot->level == slot->mips.count) {
+            texture_loader_finish(slot, TEXTURE_LOAD_STATE::READY);
+            loader->uploading = -1;
+            completed += 1;
+        }
+    }
+
+    // everything else uploads from client memory
+    if (bound_pbo) {
+        gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    return completed;
+}
+
+bool Texture_Loader_is_ready(const Texture_Loader* loader, const Texture_Handle handle)
+{
+    return handle != 0 && loader->slots[handle - 1].state == TEXTURE_LOAD_STATE::READY;
+}
+
+Texture Texture_Loader_get(const Texture_Loader* loader, const Texture_Handle handle)
+{
+    if (!Texture_Loader_is_ready(loader, handle)) {
+        return loader->placeholder;
+    }
+
+    const Texture_Load_Slot* slot = &loader->slots[handle - 1];
+    return (slot->array == nullptr) ? slot->texture : slot->array->texture;
+}
+
+bool Texture_Loader_is_premultiplied(const Texture_Loader* loader, const Texture_Handle handle)
+{
+    if (!Texture_Loader_is_ready(loader, handle)) {
+        return false;
+    }
+
+    const Texture_Load_Slot* slot = &loader->slots[handle - 1];
+    return (slot->array == nullptr) ? slot->premultiplied : slot->array->premultiplied;
+}
+
+void Texture_Loader_release(Texture_Loader* loader, const Texture_Handle handle)
+{
+    if (handle == 0) {
+        return;
+    }
+
+    const u32 index = handle - 1;
+    Texture_Load_Slot* slot = &loader->slots[index];
+    switch (slot->state) {
+    case TEXTURE_LOAD_STATE::FREE: {
+        return;
+    }
+    case TEXTURE_LOAD_STATE::QUEUED: {
+        // freed once it comes back from the worker
+        SDL_AtomicSet(&slot->abandoned, 1);
+        return;
+    }
+    case TEXTURE_LOAD_STATE::UPLOADING: {
+        texture_loader_free_pixels(slot);
+        loader->uploading = -1;
+        break;
+    }
+    default: {
+        break;
+    }
+    }
+
+    if (slot->array == nullptr && slot->texture != 0) {
+        glDeleteTextures(1, &slot->texture);
+        gl_state_invalidate();
+    }
+    slot->texture = 0;
+    slot->state   = TEXTURE_LOAD_STATE::FREE;
+}
+
+void Texture_Loader_free(Texture_Loader* loader)
+{
+    if (loader->worker_count > 0) {
+        SDL_AtomicSet(&loader->quit, 1);
+        foreach (i, loader->worker_count) {
+            SDL_SemPost(loader->jobs);
+        }
+        foreach (i, loader->worker_count) {
+            SDL_WaitThread(loader->workers[i], nullptr);
+        }
+        loader->worker_count = 0;
+    }
+    if (loader->jobs != nullptr) {
+        SDL_DestroySemaphore(loader->jobs);
+        loader->jobs = nullptr;
+    }
+
+    if (loader->slots != nullptr) {
+        foreach (i, TEXTURE_LOADER_MAX_SLOTS) {
+            Texture_Load_Slot* slot = &loader->slots[i];
+            if (slot->surface != nullptr) {
+                texture_loader_free_pixels(slot);
+            }
+            if (slot->array == nullptr && slot->texture != 0) {
+                glDeleteTextures(1, &slot->texture);
+            }
+        }
+        ::free(loader->slots);
+        loader->slots = nullptr;
+    }
+
+    glDeleteBuffers(TEXTURE_LOADER_PBO_COUNT, loader->pbos);
+    glDeleteTextures(1, &loader->placeholder);
+    gl_state_invalidate();
+}
@@ -16,6 +16,225 @@ GLboolean GL_texture_load(Texture* texture_id, const char* const path, const GLb
 // generates one texture automatically
 GLboolean GL_texture_gen_and_load_1(Texture* texture_id, const char* const path, const GLboolean alpha, const GLint param_edge_x, const GLint param_edge_y);
 
+// FILTERING
+// chosen per texture: in the cooked header, per loader request or per array target.
+// the mipmapped policies keep large backgrounds from shimmering when the camera zooms out
+enum struct TEXTURE_FILTER : u32 {
+    // GL_NEAREST, no mip levels
+    NEAREST,
+    // GL_NEAREST up close, GL_NEAREST_MIPMAP_LINEAR when minified, texels stay sharp but distant views are filtered
+    NEAREST_MIPMAP,
+    // GL_LINEAR, no mip levels
+    LINEAR,
+    // GL_LINEAR_MIPMAP_LINEAR
+    TRILINEAR,
+};
+
+bool texture_filter_uses_mips(const TEXTURE_FILTER filter);
+// false for an unknown name, names are the enum names in lowercase
+bool texture_filter_parse(const char* name, TEXTURE_FILTER* filter);
+// sets the min and mag filters and the highest level sampled, the texture must be bound to target
+void GL_texture_apply_filter(const GLenum target, const TEXTURE_FILTER filter, const u32 mip_count);
+
+// COOKED TEXTURES
+// texture_cook runs offline (see TEXTURE_COOK in run.cpp) and writes an image as raw RGBA8 with its mip chain,
+// textures/a.png becomes textures/a.tex. At runtime the file is mapped and its levels go straight to GL,
+// GL_texture_load, the async loader and the parallax layers use the .tex when it is at least as new as the image
+#define TEXTURE_COOKED_MAGIC (0x31584554) // "TEX1"
+#define TEXTURE_COOKED_VERSION (2)
+#define TEXTURE_COOKED_EXTENSION ".tex"
+#define TEXTURE_COOKED_MAX_MIPS (16)
+// every level starts on a cache line
+#define TEXTURE_COOKED_ALIGNMENT (64)
+
+#define TEXTURE_COOKED_FLAG_PREMULTIPLIED (1u << 0)
+
+enum struct TEXTURE_COOKED_FORMAT : u32 {
+    RGBA8 = 1,
+};
+
+struct Texture_Cooked_File_Mip {
+    u32 width;
+    u32 height;
+    // from the start of the file
+    u64 offset;
+    u64 size;
+};
+
+// the .tex file: the header, then the levels at their offsets, rows tightly packed, native byte order
+struct Texture_Cooked_File_Header {
+    u32 magic;
+    u32 version;
+    u32 width;
+    u32 height;
+    TEXTURE_COOKED_FORMAT format;
+    u32 flags;
+    u32 mip_count;
+    TEXTURE_FILTER filter;
+    Texture_Cooked_File_Mip mips[TEXTURE_COOKED_MAX_MIPS];
+};
+
+// a read-only view of a .tex file, mapped where mmap exists and read into memory otherwise
+struct Texture_Cooked {
+    const Texture_Cooked_File_Header* header;
+    usize size;
+};
+
+bool texture_cook(const char* image_path, const char* out_path, const bool premultiply, const TEXTURE_FILTER filter);
+// cooks every image next to its source and compares decoding them against mapping the results
+bool texture_cook_files(const char* const* paths, const usize count_paths, const bool premultiply, const TEXTURE_FILTER filter);
+// textures/a.png -> textures/a.tex
+void texture_cooked_path(char* out, const usize cap, const char* image_path);
+// true and the cooked path in out when it exists and is not older than the image
+bool texture_cooked_find(char* out, const usize cap, const char* image_path);
+
+bool Texture_Cooked_open(Texture_Cooked* cooked, const char* path);
+const u8* Texture_Cooked_level(const Texture_Cooked* cooked, const u32 level);
+// cooked with -p, false for a decoded image
+bool Texture_Cooked_premultiplied(const Texture_Cooked* cooked);
+void Texture_Cooked_close(Texture_Cooked* cooked);
+
+// GL_ONE, GL_ONE_MINUS_SRC_ALPHA for premultiplied textures, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA otherwise
+void GL_texture_blend_func(const bool premultiplied);
+
+// uploads a .tex file with the filter it was cooked with, premultiplied receives its alpha mode,
+// without it the caller blends straight alpha and a premultiplied file is refused
+GLboolean GL_texture_load_cooked(Texture* texture_id, const char* const path, const GLint param_edge_x, const GLint param_edge_y, bool* premultiplied);
+
+// an RGBA32 surface for path, wrapping the mapping of its cooked file without a copy when there is one,
+// cooked->header stays nullptr when the image was decoded instead, premultiplied is set from the cooked file
+SDL_Surface* texture_rgba_load(const char* path, Texture_Cooked* cooked, bool* premultiplied);
+void texture_rgba_free(SDL_Surface* surface, Texture_Cooked* cooked);
+
+// MIP CHAINS
+// 2x2 box filter, SSE2 where available. Premultiplied levels are plain averages, straight alpha levels weight
+// each colour by its alpha so that transparent texels do not bleed their colour into the edges
+void texture_mip_downsample(const u8* src, const u32 src_w, const u32 src_h, const usize src_pitch, u8* dst, const u32 dst_w, const u32 dst_h, const bool premultiplied);
+// the sizes of every level down to 1x1, at most max_levels, packed from first_offset with each level aligned to alignment,
+// returns the level count and the end of the last level in end
+u32 texture_mip_levels(const u32 width, const u32 height, const u32 max_levels, const usize first_offset, const usize alignment, Texture_Cooked_File_Mip* levels, usize* end);
+
+// the levels of an RGBA32 surface, level 0 stays in the surface,
+// the rest point into its cooked file or are built on the CPU
+struct Texture_Mip_Chain {
+    Texture_Cooked_File_Mip levels[TEXTURE_COOKED_MAX_MIPS];
+    u32       count;
+    // levels[l].offset is from here
+    const u8* base;
+    // owned when the levels were built
+    u8*       data;
+    // from the cooked file, levels built here are straight alpha
+    bool      premultiplied;
+};
+
+void Texture_Mip_Chain_make(Texture_Mip_Chain* chain, SDL_Surface* rgba, const Texture_Cooked* cooked, const u32 max_levels);
+// level 0 is the surface
+const u8* Texture_Mip_Chain_level(const Texture_Mip_Chain* chain, SDL_Surface* rgba, const u32 level);
+void Texture_Mip_Chain_free(Texture_Mip_Chain* chain);
+
+// ASYNC LOADING
+// worker threads decode requested images with IMG_Load, Texture_Loader_update uploads the decoded rows
+// on the GL thread through a ring of pixel buffer objects, spending at most bytes_per_frame per call,
+// so a large image arrives over several frames. A handle resolves to a 1x1 placeholder until its texture is ready
+#define TEXTURE_LOADER_MAX_SLOTS (256)
+#define TEXTURE_LOADER_MAX_WORKERS (8)
+#define TEXTURE_LOADER_PATH_MAX (256)
+#define TEXTURE_LOADER_PBO_COUNT (3)
+
+// slot index + 1, 0 is no texture
+typedef u32 Texture_Handle;
+
+// a caller-owned GL_TEXTURE_2D_ARRAY filled slice by slice, created with the size of the first slice to arrive,
+// must outlive the requests that point at it
+struct Texture_Array_Target {
+    Texture texture;
+    u32     width;
+    u32     height;
+    u32     depth;
+    GLint   edge_x;
+    GLint   edge_y;
+    TEXTURE_FILTER filter;
+    // set with the storage, every slice must match
+    u32     mip_count;
+    bool    premultiplied;
+    u32     slices_ready;
+    bool    failed;
+};
+
+enum struct TEXTURE_LOAD_STATE {
+    FREE,
+    QUEUED,
+    UPLOADING,
+    READY,
+    FAILED,
+};
+
+struct Texture_Load_Slot {
+    TEXTURE_LOAD_STATE state;
+    char    path[TEXTURE_LOADER_PATH_MAX];
+    GLint   edge_x;
+    GLint   edge_y;
+    TEXTURE_FILTER filter;
+    // nullptr for a texture of its own
+    Texture_Array_Target* array;
+    u32     layer;
+
+    // written by a worker, RGBA32, nullptr if decoding failed
+    SDL_Surface*      surface;
+    Texture_Cooked    cooked;
+    Texture_Mip_Chain mips;
+    Texture           texture;
+    bool              premultiplied;
+    // uploaded level by level, rows_uploaded of the current one
+    u32               level;
+    u32               rows_uploaded;
+    // released before the worker was done with it
+    SDL_atomic_t      abandoned;
+};
+
+// slot indices, every slot is in a queue at most once
+struct Texture_Load_Queue {
+    u32          items[TEXTURE_LOADER_MAX_SLOTS];
+    u32          head;
+    u32          count;
+    SDL_SpinLock lock;
+};
+
+struct Texture_Loader {
+    Texture_Load_Slot* slots;
+
+    Texture_Load_Queue to_decode;
+    Texture_Load_Queue decoded;
+    SDL_sem*           jobs;
+    SDL_Thread*        workers[TEXTURE_LOADER_MAX_WORKERS];
+    u32                worker_count;
+    SDL_atomic_t       quit;
+
+    // slot being uploaded, carried over frames
+    i32    uploading;
+    GLuint pbos[TEXTURE_LOADER_PBO_COUNT];
+    u32    pbo_next;
+    usize  pbo_size;
+    usize  bytes_per_frame;
+
+    Texture placeholder;
+};
+
+bool Texture_Loader_init(Texture_Loader* loader, const u32 worker_count, const usize bytes_per_frame);
+Texture_Handle Texture_Loader_request(Texture_Loader* loader, const char* path, const GLint edge_x, const GLint edge_y, const TEXTURE_FILTER filter);
+// decodes into slice `layer` of the target, with the filter of the target
+Texture_Handle Texture_Loader_request_slice(Texture_Loader* loader, const char* path, Texture_Array_Target* array, const u32 layer);
+// once per frame on the GL thread, returns the number of textures completed
+u32  Texture_Loader_update(Texture_Loader* loader);
+bool Texture_Loader_is_ready(const Texture_Loader* loader, const Texture_Handle handle);
+// the texture once ready, the placeholder before that or if loading failed
+Texture Texture_Loader_get(const Texture_Loader* loader, const Texture_Handle handle);
+// whether the texture from Texture_Loader_get is blended with GL_texture_blend_func(true)
+bool Texture_Loader_is_premultiplied(const Texture_Loader* loader, const Texture_Handle handle);
+// deletes a texture of its own, slices stay with their array
+void Texture_Loader_release(Texture_Loader* loader, const Texture_Handle handle);
+void Texture_Loader_free(Texture_Loader* loader);
+
 #ifdef TEXTURE_IMPLEMENTATION
 #undef TEXTURE_IMPLEMENTATION
 #include "texture.cpp"
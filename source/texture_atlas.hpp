@@ -0,0 +1,523 @@
+#ifndef TEXTURE_ATLAS_HPP
+#define TEXTURE_ATLAS_HPP
+
+// many small textures packed into a few atlas pages so that differently textured sprites share one bind,
+// texture_atlas_pack runs offline (see TEXTURE_ATLAS_PACK in run.cpp) and writes
+// <prefix>_<page>.png plus the <prefix>.atlas region table, Texture_Atlas_load reads them back
+#if !(UNITY_BUILD)
+#define COMMON_UTILS_CPP_IMPLEMENTATION
+#include "common_utils_cpp.hpp"
+
+#include "opengl.hpp"
+#include "sdl.hpp"
+#include "texture.hpp"
+#endif
+
+#define TEXTURE_ATLAS_PAGE_SIZE (2048)
+// larger images stay separate textures
+#define TEXTURE_ATLAS_MAX_REGION_SIZE (TEXTURE_ATLAS_PAGE_SIZE / 2)
+#define TEXTURE_ATLAS_MAX_PAGES (16)
+// edge texels repeated around every region so filtering never reads a neighbour
+#define TEXTURE_ATLAS_PADDING (1)
+#define TEXTURE_ATLAS_NAME_MAX (48)
+#define TEXTURE_ATLAS_PATH_MAX (256)
+
+#define TEXTURE_ATLAS_MAGIC (0x314c5441) // "ATL1"
+#define TEXTURE_ATLAS_VERSION (1)
+
+// the .atlas file: the header, then region_count regions sorted by name, native byte order
+struct Texture_Atlas_File_Header {
+    u32 magic;
+    u32 version;
+    u32 page_size;
+    u32 page_count;
+    u32 region_count;
+};
+
+struct Texture_Atlas_File_Region {
+    // the file name without directory or extension
+    char name[TEXTURE_ATLAS_NAME_MAX];
+    u32  page;
+    // texels, without the padding
+    u32  x;
+    u32  y;
+    u32  w;
+    u32  h;
+};
+
+struct Texture_Atlas_Region {
+    Texture texture;
+    u32     page;
+    Vec2    uv_min;
+    Vec2    uv_max;
+    u32     w;
+    u32     h;
+};
+
+struct Texture_Atlas {
+    Texture pages[TEXTURE_ATLAS_MAX_PAGES];
+    u32     page_count;
+
+    // sorted by name, names[i] belongs to regions[i]
+    Texture_Atlas_Region* regions;
+    char (*names)[TEXTURE_ATLAS_NAME_MAX];
+    u32 region_count;
+};
+
+// packs the images at paths into pages, images over TEXTURE_ATLAS_MAX_REGION_SIZE are skipped
+bool texture_atlas_pack(const char* out_prefix, const char* const* paths, const usize count_paths);
+
+bool Texture_Atlas_load(Texture_Atlas* atlas, const char* prefix);
+// nullptr when name was not packed
+const Texture_Atlas_Region* Texture_Atlas_find(const Texture_Atlas* atlas, const char* name);
+void Texture_Atlas_free(Texture_Atlas* atlas);
+
+#endif
+
+#ifdef TEXTURE_ATLAS_IMPLEMENTATION
+#undef TEXTURE_ATLAS_IMPLEMENTATION
+
+// PACKER
+
+struct Texture_Atlas_Image {
+    char name[TEXTURE_ATLAS_NAME_MAX];
+    u32* pixels;
+    u32  w;
+    u32  h;
+};
+
+// the top edge of the filled area, one node per horizontal segment
+struct Skyline_Node {
+    u32 x;
+    u32 y;
+    u32 w;
+};
+
+struct Skyline {
+    Skyline_Node* nodes;
+    usize count;
+    u32*  pixels;
+};
+
+static void skyline_init(Skyline* sky)
+{
+    sky->nodes = (Skyline_Node*)xmalloc((TEXTURE_ATLAS_PAGE_SIZE + 1) * sizeof(Skyline_Node));
+    sky->nodes[0].x = 0;
+    sky->nodes[0].y = 0;
+    sky->nodes[0].w = TEXTURE_ATLAS_PAGE_SIZE;
+    sky->count = 1;
+    sky->pixels = (u32*)xcalloc(TEXTURE_ATLAS_PAGE_SIZE * TEXTURE_ATLAS_PAGE_SIZE, sizeof(u32));
+}
+
+static void skyline_free(Skyline* sky)
+{
+    ::free(sky->nodes);
+    ::free(sky->pixels);
+}
+
+// the lowest y at which a w-wide rectangle placed at node i clears the skyline, false if it leaves the page
+static bool skyline_fit(const Skyline* sky, const usize i, const u32 w, const u32 h, u32* y_out)
+{
+    const u32 x = sky->nodes[i].x;
+    if (x + w > TEXTURE_ATLAS_PAGE_SIZE) {
+        return false;
+    }
+
+    u32 y = 0;
+    u32 width_left = w;
+    for (usize k = i; width_left > 0; k += 1) {
+        y = glm::max(y, sky->nodes[k].y);
+        if (y + h > TEXTURE_ATLAS_PAGE_SIZE) {
+            return false;
+        }
+        width_left -= glm::min(width_left, sky->nodes[k].w);
+    }
+
+    *y_out = y;
+    return true;
+}
+
+// bottom-left rule (top-left here, y grows down): lowest top edge first, then the narrowest node
+static bool skyline_insert(Skyline* sky, const u32 w, const u32 h, u32* x_out, u32* y_out)
+{
+    usize best = sky->count;
+    u32 best_y = TEXTURE_ATLAS_PAGE_SIZE;
+    u32 best_w = TEXTURE_ATLAS_PAGE_SIZE + 1;
+
+    foreach (i, sky->count) {
+        u32 y;
+        if (skyline_fit(sky, i, w, h, &y) && (y < best_y || (y == best_y && sky->nodes[i].w < best_w))) {
+            best   = i;
+            best_y = y;
+            best_w = sky->nodes[i].w;
+        }
+    }
+    if (best == sky->count) {
+        return false;
+    }
+
+    const u32 x = sky->nodes[best].x;
+
+    // the new segment replaces everything it covers
+    memmove(&sky->nodes[best + 1], &sky->nodes[best], (sky->count - best) * sizeof(Skyline_Node));
+    sky->count += 1;
+    sky->nodes[best].x = x;
+    sky->nodes[best].y = best_y + h;
+    sky->nodes[best].w = w;
+
+    usize i = best + 1;
+    while (i < sky->count) {
+        Skyline_Node* prev = &sky->nodes[i - 1];
+        Skyline_Node* node = &sky->nodes[i];
+        const u32 prev_end = prev->x + prev->w;
+        if (node->x >= prev_end) {
+            break;
+        }
+
+        const u32 shrink = prev_end - node->x;
+        if (node->w > shrink) {
+            node->x += shrink;
+            node->w -= shrink;
+            break;
+        }
+
+        memmove(&sky->nodes[i], &sky->nodes[i + 1], (sky->count - i - 1) * sizeof(Skyline_Node));
+        sky->count -= 1;
+    }
+
+    // merge neighbours at the same height
+    i = 0;
+    while (i + 1 < sky->count) {
+        if (sky->nodes[i].y == sky->nodes[i + 1].y) {
+            sky->nodes[i].w += sky->nodes[i + 1].w;
+            memmove(&sky->nodes[i + 1], &sky->nodes[i + 2], (sky->count - i - 2) * sizeof(Skyline_Node));
+            sky->count -= 1;
+        } else {
+            i += 1;
+        }
+    }
+
+    *x_out = x;
+    *y_out = best_y;
+    return true;
+}
+
+// copies the image to (x, y) and extrudes its edges into the padding
+static void skyline_blit(Skyline* sky, const Texture_Atlas_Image* img, const u32 x, const u32 y)
+{
+    const i32 pad = TEXTURE_ATLAS_PADDING;
+    for (i32 dy = -pad; dy < (i32)img->h + pad; dy += 1) {
+        const u32 sy = (u32)glm::clamp(dy, 0, (i32)img->h - 1);
+        for (i32 dx = -pad; dx < (i32)img->w + pad; dx += 1) {
+            const u32 sx = (u32)glm::clamp(dx, 0, (i32)img->w - 1);
+            sky->pixels[(y + dy) * TEXTURE_ATLAS_PAGE_SIZE + (x + dx)] = img->pixels[sy * img->w + sx];
+        }
+    }
+}
+
+static int texture_atlas_image_compare_height(const void* a, const void* b)
+{
+    const Texture_Atlas_Image* ia = (const Texture_Atlas_Image*)a;
+    const Texture_Atlas_Image* ib = (const Texture_Atlas_Image*)b;
+    if (ia->h != ib->h) {
+        return (ia->h > ib->h) ? -1 : 1;
+    }
+    return (ia->w > ib->w) ? -1 : (ia->w < ib->w);
+}
+
+static int texture_atlas_region_compare_name(const void* a, const void* b)
+{
+    return strncmp(((const Texture_Atlas_File_Region*)a)->name, ((const Texture_Atlas_File_Region*)b)->name, TEXTURE_ATLAS_NAME_MAX);
+}
+
+static bool texture_atlas_image_load(Texture_Atlas_Image* img, const char* path)
+{
+    const char* base = path;
+    for (const char* c = path; *c != '\0'; c += 1) {
+        if (*c == '/' || *c == '\\') {
+            base = c + 1;
+        }
+    }
+    const char* dot = strrchr(base, '.');
+    const usize len = (dot != nullptr) ? (usize)(dot - base) : strlen(base);
+    if (len == 0 || len >= TEXTURE_ATLAS_NAME_MAX) {
+        fprintf(stderr, "ERROR: texture_atlas_pack, unusable name %s\n", path);
+        return false;
+    }
+    memcpy(img->name, base, len);
+    img->name[len] = '\0';
+
+    SDL_Surface* loaded = IMG_Load(path);
+    if (loaded == nullptr) {
+        fprintf(stderr, "ERROR: texture_atlas_pack %s, SDL_image Error: %s\n", path, IMG_GetError());
+        return false;
+    }
+
+    SDL_Surface* rgba = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+    if (rgba == nullptr) {
+        fprintf(stderr, "ERROR: texture_atlas_pack %s, SDL Error: %s\n", path, SDL_GetError());
+        return false;
+    }
+
+    img->w      = rgba->w;
+    img->h      = rgba->h;
+    img->pixels = (u32*)xmalloc(img->w * img->h * sizeof(u32));
+
+    SDL_LockSurface(rgba);
+    foreach (y, img->h) {
+        memcpy(&img->pixels[y * img->w], (u8*)rgba->pixels + (y * rgba->pitch), img->w * sizeof(u32));
+    }
+    SDL_UnlockSurface(rgba);
+    SDL_FreeSurface(rgba);
+
+    return true;
+}
+
+static bool texture_atlas_page_save(const Skyline* sky, const char* out_prefix, const usize page)
+{
+    char path[TEXTURE_ATLAS_PATH_MAX];
+    snprintf(path, TEXTURE_ATLAS_PATH_MAX, "%s_%llu.png", out_prefix, (unsigned long long)page);
+
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(
+        sky->pixels, TEXTURE_ATLAS_PAGE_SIZE, TEXTURE_ATLAS_PAGE_SIZE, 32, TEXTURE_ATLAS_PAGE_SIZE * sizeof(u32), SDL_PIXELFORMAT_RGBA32
+    );
+    if (surface == nullptr) {
+        fprintf(stderr, "ERROR: texture_atlas_pack %s, SDL Error: %s\n", path, SDL_GetError());
+        return false;
+    }
+
+    const bool ok = (IMG_SavePNG(surface, path) == 0);
+    if (!ok) {
+        fprintf(stderr, "ERROR: texture_atlas_pack %s, SDL_image Error: %s\n", path, IMG_GetError());
+    }
+    SDL_FreeSurface(surface);
+
+    return ok;
+}
+
+bool texture_atlas_pack(const char* out_prefix, const char* const* paths, const usize count_paths)
+{
+    Texture_Atlas_Image* images = (Texture_Atlas_Image*)xcalloc(count_paths, sizeof(Texture_Atlas_Image));
+    usize count_images = 0;
+
+    foreach (i, count_paths) {
+        Texture_Atlas_Image* img = &images[count_images];
+        if (!texture_atlas_image_load(img, paths[i])) {
+            continue;
+        }
+        if (img->w > TEXTURE_ATLAS_MAX_REGION_SIZE || img->h > TEXTURE_ATLAS_MAX_REGION_SIZE) {
+            printf("%s is %ux%u, left out of the atlas\n", paths[i], img->w, img->h);
+            ::free(img->pixels);
+            continue;
+        }
+        count_images += 1;
+    }
+
+    // tallest first keeps the skyline flat
+    qsort(images, count_images, sizeof(Texture_Atlas_Image), texture_atlas_image_compare_height);
+
+    Skyline pages[TEXTURE_ATLAS_MAX_PAGES];
+    usize page_count = 0;
+
+    Texture_Atlas_File_Region* regions = (Texture_Atlas_File_Region*)xcalloc(glm::max(count_images, (usize)1), sizeof(Texture_Atlas_File_Region));
+    usize region_count = 0;
+
+    bool ok = true;
+    foreach (i, count_images) {
+        const Texture_Atlas_Image* img = &images[i];
+        const u32 w = img->w + 2 * TEXTURE_ATLAS_PADDING;
+        const u32 h = img->h + 2 * TEXTURE_ATLAS_PADDING;
+
+        u32 x = 0;
+        u32 y = 0;
+        usize page = 0;
+        while (page < page_count && !skyline_insert(&pages[page], w, h, &x, &y)) {
+            page += 1;
+        }
+        if (page == page_count) {
+            if (page_count == TEXTURE_ATLAS_MAX_PAGES) {
+                fprintf(stderr, "ERROR: texture_atlas_pack, more than %d pages needed\n", TEXTURE_ATLAS_MAX_PAGES);
+                ok = false;
+                break;
+            }
+            skyline_init(&pages[page_count]);
+            page_count += 1;
+            skyline_insert(&pages[page], w, h, &x, &y);
+        }
+
+        x += TEXTURE_ATLAS_PADDING;
+        y += TEXTURE_ATLAS_PADDING;
+        skyline_blit(&pages[page], img, x, y);
+
+        Texture_Atlas_File_Region* region = &regions[region_count];
+        memcpy(region->name, img->name, TEXTURE_ATLAS_NAME_MAX);
+        region->page = (u32)page;
+        region->x    = x;
+        region->y    = y;
+        region->w    = img->w;
+        region->h    = img->h;
+        region_count += 1;
+    }
+
+    foreach (i, page_count) {
+        if (ok && !texture_atlas_page_save(&pages[i], out_prefix, i)) {
+            ok = false;
+        }
+        skyline_free(&pages[i]);
+    }
+
+    if (ok) {
+        qsort(regions, region_count, sizeof(Texture_Atlas_File_Region), texture_atlas_region_compare_name);
+
+        for (usize i = 1; i < region_count; i += 1) {
+            if (strncmp(regions[i - 1].name, regions[i].name, TEXTURE_ATLAS_NAME_MAX) == 0) {
+                fprintf(stderr, "ERROR: texture_atlas_pack, two images named %s\n", regions[i].name);
+                ok = false;
+            }
+        }
+    }
+
+    if (ok) {
+        char path[TEXTURE_ATLAS_PATH_MAX];
+        snprintf(path, TEXTURE_ATLAS_PATH_MAX, "%s.atlas", out_prefix);
+
+        FILE* out = fopen(path, "wb");
+        if (out == nullptr) {
+            fprintf(stderr, "ERROR: texture_atlas_pack could not write %s\n", path);
+            ok = false;
+        } else {
+            Texture_Atlas_File_Header header;
+            header.magic        = TEXTURE_ATLAS_MAGIC;
+            header.version      = TEXTURE_ATLAS_VERSION;
+            header.page_size    = TEXTURE_ATLAS_PAGE_SIZE;
+            header.page_count   = (u32)page_count;
+            header.region_count = (u32)region_count;
+
+            ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+                 fwrite(regions, sizeof(Texture_Atlas_File_Region), region_count, out) == region_count;
+            fclose(out);
+
+            if (ok) {
+                printf("packed %llu images into %llu pages, %s\n", (unsigned long long)region_count, (unsigned long long)page_count, path);
+            } else {
+                fprintf(stderr, "ERROR: texture_atlas_pack could not write %s\n", path);
+            }
+        }
+    }
+
+    foreach (i, count_images) {
+        ::free(images[i].pixels);
+    }
+    ::free(images);
+    ::free(regions);
+
+    return ok;
+}
+
+// RUNTIME
+
+bool Texture_Atlas_load(Texture_Atlas* atlas, const char* prefix)
+{
+    atlas->page_count   = 0;
+    atlas->regions      = nullptr;
+    atlas->names        = nullptr;
+    atlas->region_count = 0;
+
+    char path[TEXTURE_ATLAS_PATH_MAX];
+    snprintf(path, TEXTURE_ATLAS_PATH_MAX, "%s.atlas", prefix);
+
+    FILE* in = fopen(path, "rb");
+    if (in == nullptr) {
+        fprintf(stderr, "ERROR: Texture_Atlas_load could not open %s\n", path);
+        return false;
+    }
+
+    Texture_Atlas_File_Header header;
+    if (fread(&header, sizeof(header), 1, in) != 1 ||
+        header.magic != TEXTURE_ATLAS_MAGIC || header.version != TEXTURE_ATLAS_VERSION ||
+        header.page_count > TEXTURE_ATLAS_MAX_PAGES) {
+        fprintf(stderr, "ERROR: Texture_Atlas_load %s is not a version %d atlas\n", path, TEXTURE_ATLAS_VERSION);
+        fclose(in);
+        return false;
+    }
+
+    Texture_Atlas_File_Region* file_regions = (Texture_Atlas_File_Region*)xmalloc(glm::max(header.region_count, 1u) * sizeof(Texture_Atlas_File_Region));
+    const bool read = fread(file_regions, sizeof(Texture_Atlas_File_Region), header.region_count, in) == header.region_count;
+    fclose(in);
+    if (!read) {
+        fprintf(stderr, "ERROR: Texture_Atlas_load %s is truncated\n", path);
+        ::free(file_regions);
+        return false;
+    }
+
+    foreach (i, header.page_count) {
+        snprintf(path, TEXTURE_ATLAS_PATH_MAX, "%s_%llu.png", prefix, (unsigned long long)i);
+        if (!GL_texture_gen_and_load_1(&atlas->pages[i], path, GL_TRUE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE)) {
+            ::free(file_regions);
+            Texture_Atlas_free(atlas);
+            return false;
+        }
+        atlas->page_count += 1;
+    }
+
+    atlas->regions      = (Texture_Atlas_Region*)xmalloc(glm::max(header.region_count, 1u) * sizeof(Texture_Atlas_Region));
+    atlas->names        = (char (*)[TEXTURE_ATLAS_NAME_MAX])xmalloc(glm::max(header.region_count, 1u) * TEXTURE_ATLAS_NAME_MAX);
+    atlas->region_count = header.region_count;
+
+    const f32 inv_size = 1.0f / (f32)header.page_size;
+    foreach (i, header.region_count) {
+        const Texture_Atlas_File_Region* src = &file_regions[i];
+        Texture_Atlas_Region* dst = &atlas->regions[i];
+
+        memcpy(atlas->names[i], src->name, TEXTURE_ATLAS_NAME_MAX);
+        atlas->names[i][TEXTURE_ATLAS_NAME_MAX - 1] = '\0';
+
+        dst->page    = glm::min(src->page, atlas->page_count - 1);
+        dst->texture = atlas->pages[dst->page];
+        dst->uv_min  = Vec2(src->x, src->y) * inv_size;
+        dst->uv_max  = Vec2(src->x + src->w, src->y + src->h) * inv_size;
+        dst->w       = src->w;
+        dst->h       = src->h;
+    }
+
+    ::free(file_regions);
+
+    return true;
+}
+
+const Texture_Atlas_Region* Texture_Atlas_find(const Texture_Atlas* atlas, const char* name)
+{
+    usize lo = 0;
+    usize hi = atlas->region_count;
+    while (lo < hi) {
+        const usize mid = lo + ((hi - lo) / 2);
+        const int cmp = strncmp(name, atlas->names[mid], TEXTURE_ATLAS_NAME_MAX);
+        if (cmp == 0) {
+            return &atlas->regions[mid];
+        }
+        if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    return nullptr;
+}
+
+void Texture_Atlas_free(Texture_Atlas* atlas)
+{
+    if (atlas->page_count > 0) {
+        glDeleteTextures(atlas->page_count, atlas->pages);
+    }
+    atlas->page_count = 0;
+
+    ::free(atlas->regions);
+    ::free(atlas->names);
+    atlas->regions      = nullptr;
+    atlas->names        = nullptr;
+    atlas->region_count = 0;
+}
+
+#endif // TEXTURE_ATLAS_HPP
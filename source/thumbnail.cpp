@@ -0,0 +1,163 @@
+// headless level thumbnails through the software rasterizer, no window or GL context is created
+// enable with #define THUMBNAIL in run.cpp, renders the world file given as the first argument
+// (worlds/lines_test_a.txt by default) to screens/<world name>.png
+
+#define THUMBNAIL_BG_LAYER_LIST "textures/separate_test_2/layers.txt"
+
+// the per-layer uv mapping of shaders/parallax/parallax_v2_frg.glsl,
+// scale(a_uv + off, off, 1 / cam_scale) is a_uv * s + off + 0.5 * (1 - s)
+static void thumbnail_parallax_uv(const Vec2 divisor, const Vec3 position_cam, const f32 cam_scale, Vec2* uv_scale, Vec2* uv_offset)
+{
+    const Vec2 off = Vec2(position_cam.x, glm::clamp(position_cam.y, -1.45f, 1.45f)) / divisor;
+    const f32 s = 1.0f / cam_scale;
+
+    *uv_scale  = Vec2(s);
+    *uv_offset = off + Vec2(0.5f * (1.0f - s));
+}
+
+// one collider per line: ax,ay,az,bx,by,bz
+static bool thumbnail_load_colliders(const char* path)
+{
+    FILE* in = fopen(path, "r");
+    if (in == nullptr) {
+        fprintf(stderr, "ERROR: thumbnail could not open %s\n", path);
+        return false;
+    }
+
+    collision_map.count = 0;
+
+    Collider c;
+    while (collision_map.count < MAX_COLLIDERS && fscanf(in, " %f,%f,%f,%f,%f,%f", &c.a.x, &c.a.y, &c.a.z, &c.b.x, &c.b.y, &c.b.z) == 6) {
+        collision_map.push_back(c);
+    }
+
+    fclose(in);
+
+    return true;
+}
+
+bool thumbnail(const char* world_path)
+{
+    if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)) {
+        fprintf(stderr, "SDL_image could not initialize, SDL_image Error: %s\n", IMG_GetError());
+        return false;
+    }
+
+    if (!thumbnail_load_colliders(world_path)) {
+        IMG_Quit();
+        return false;
+    }
+
+    // same layer list as the game
+    Parallax_Layer_List layers;
+    if (!Parallax_Layer_List_read(&layers, THUMBNAIL_BG_LAYER_LIST)) {
+        IMG_Quit();
+        return false;
+    }
+
+    Software_Texture bgs[PARALLAX_MAX_LAYERS];
+    foreach (i, layers.count) {
+        if (!Software_Texture_load(&bgs[i], layers.paths[i], true, false)) {
+            for (usize k = 0; k < i; k += 1) {
+                Software_Texture_free(&bgs[k]);
+            }
+            IMG_Quit();
+            return false;
+        }
+    }
+
+    Software_Renderer r;
+    const int cpus = SDL_GetCPUCount();
+    if (!Software_Renderer_init(&r, (u32)SCREEN_WIDTH, (u32)SCREEN_HEIGHT, (cpus > 1) ? cpus - 1 : 0)) {
+        foreach (i, layers.count) {
+            Software_Texture_free(&bgs[i]);
+        }
+        IMG_Quit();
+        return false;
+    }
+
+    Mat4 mat_projection = glm::ortho(
+        0.0f,
+        1.0f * SCREEN_WIDTH,
+        1.0f * SCREEN_HEIGHT,
+        0.0f,
+        0.0f,
+        1.0f * 10.0f
+    );
+
+    // the camera the game starts with
+    FreeCamera cam;
+    FreeCamera_init(&cam, Vec3(0.0f, 0.0f, 1.0f));
+    cam.orientation = Quat();
+    cam.offset = Vec2(SCREEN_WIDTH / 2.0, SCREEN_HEIGHT / 2.0);
+    cam.target = Vec2(0);
+    cam.scale  = 1.0;
+
+    Software_Renderer_clear(&r, Vec4(97.0f / 255.0f, 201.0f / 255.0f, 1.0f, 1.0f));
+
+    // BACKGROUND, the same quad as the game, each layer blended over the previous one
+    // as the parallax fragment shader does
+    {
+        const Vec2 tex_res(2048.0f, 1024.0f);
+        const Vec3 world_bguv_factor = Vec3(Vec2(1.0f) / tex_res, 1.0f);
+
+        const GLfloat X_OFF = (tex_res.x - SCREEN_WIDTH) / 2.0f;
+        const GLfloat Y_OFF = (tex_res.y - SCREEN_HEIGHT) / 2.0f;
+
+        const GLfloat T[] = {
+           0.0f - X_OFF,      0.0f - Y_OFF,      0.0f,    0.0f, 0.0f,    // top left
+           0.0f - X_OFF,      tex_res.y - Y_OFF, 0.0f,    0.0f, 1.0f,    // bottom left
+           tex_res.x - X_OFF, tex_res.y - Y_OFF, 0.0f,    1.0f, 1.0f,    // bottom right
+           tex_res.x - X_OFF, 0.0f - Y_OFF,      0.0f,    1.0f, 0.0f,    // top right
+        };
+        const GLuint TI[] = {
+            0, 1, 2,
+            2, 3, 0,
+        };
+
+        foreach (i, layers.count) {
+            Vec2 uv_scale;
+            Vec2 uv_offset;
+            thumbnail_parallax_uv(layers.scroll_divisors[i], cam.position * world_bguv_factor, cam.scale, &uv_scale, &uv_offset);
+
+            r.blend = (i != 0);
+            Software_Renderer_draw_textured(&r, mat_projection, T, 5, TI, StaticArrayCount(TI), &bgs[i], uv_scale, uv_offset);
+        }
+    }
+
+    // COLLIDERS, the same sd geometry as the game rasterized by the software batch
+    r.blend      = false;
+    r.depth_test = true;
+
+    auto* batch = (sd::Software_Render_Batch<MAX_COLLIDERS * 2>*)xcalloc(1, sizeof(sd::Software_Render_Batch<MAX_COLLIDERS * 2>));
+    batch->init(&r, mat_projection);
+    batch->begin();
+    batch->geometry.transform_matrix = FreeCamera_calc_view_matrix(&cam);
+    batch->geometry.draw_type = sd::LINES;
+    batch->geometry.color = Color::BLACK;
+    foreach (i, collision_map.count) {
+        batch->line(collision_map[i].a, collision_map[i].b);
+    }
+    batch->end();
+
+    Software_Renderer_flush(&r);
+
+    std::string name = world_path;
+    name = name.substr(name.find_last_of("/\\") + 1);
+    name = name.substr(0, name.find_last_of('.'));
+    const std::string out_path = "screens/" + name + ".png";
+
+    const bool ok = Software_Renderer_save_png(&r, out_path.c_str());
+    if (ok) {
+        printf("thumbnail written to %s\n", out_path.c_str());
+    }
+
+    ::free(batch);
+    Software_Renderer_free(&r);
+    foreach (i, layers.count) {
+        Software_Texture_free(&bgs[i]);
+    }
+    IMG_Quit();
+
+    return ok;
+}
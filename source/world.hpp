@@ -0,0 +1,398 @@
+#ifndef WORLD_HPP
+#define WORLD_HPP
+
+// the level as a grid of fixed-size rooms streamed in around the camera,
+// room (x, y) is read from <dir>/<x>_<y>.txt with one collider per line (ax,ay,az,bx,by,bz)
+// in world space, a missing file is an empty room, see World_partition for splitting a whole level
+#if !(UNITY_BUILD)
+#define COMMON_UTILS_CPP_IMPLEMENTATION
+#include "common_utils_cpp.hpp"
+
+#include "opengl.hpp"
+#include "sdl.hpp"
+#include "collision.h"
+#include "sd.hpp"
+#include "rotologic_renderer.hpp"
+#endif
+
+#define WORLD_ROOM_SIZE (2048.0f)
+// rooms up to this many rooms away from the camera's are loaded, one more ring stays resident before eviction
+#define WORLD_ROOM_RADIUS (1)
+#define WORLD_ROOM_SPAN (2 * (WORLD_ROOM_RADIUS + 1) + 1)
+#define WORLD_MAX_ROOMS (WORLD_ROOM_SPAN * WORLD_ROOM_SPAN)
+#define ROOM_MAX_COLLIDERS (512)
+#define WORLD_PATH_MAX (256)
+
+enum struct ROOM_STATE : int {
+    FREE,
+    // waiting for the loader thread
+    QUEUED,
+    LOADING,
+    // colliders read, the mesh is built by the main thread
+    LOADED,
+    RESIDENT,
+};
+
+struct Room {
+    // ROOM_STATE, the loader only touches a room between QUEUED and LOADED
+    SDL_atomic_t state;
+    i32 x;
+    i32 y;
+
+    Array<Collider, ROOM_MAX_COLLIDERS> collision_data;
+    sd::Static_Mesh<ROOM_MAX_COLLIDERS * 2> mesh;
+};
+
+struct World {
+    Room* rooms;
+    char  dir[WORLD_PATH_MAX];
+    f32   room_size;
+
+    // one program for every room mesh
+    Shader shader;
+
+    SDL_Thread*  loader;
+    SDL_sem*     wake;
+    SDL_atomic_t quit;
+};
+
+struct Collider_Span {
+    Collider* begin;
+    Collider* end;
+};
+
+bool World_init(World* world, const char* dir, const f32 room_size);
+// evicts the rooms that drifted out of range, builds the meshes of finished loads
+// and queues the missing rooms around center, main thread only
+void World_update(World* world, const Vec2 center);
+void World_draw(World* world, sd::Render_Context* ctx, const Mat4& transform, const Vec2 view_min, const Vec2 view_max);
+// the colliders of every resident room, out holds WORLD_MAX_ROOMS spans
+usize World_collider_spans(World* world, Collider_Span* out);
+void World_free(World* world);
+
+// writes each collider of the level file src_path to the room owning its midpoint, dir must exist
+bool World_partition(const char* src_path, const char* dir, const f32 room_size);
+
+#endif
+
+#ifdef WORLD_IMPLEMENTATION
+#undef WORLD_IMPLEMENTATION
+
+static inline i32 world_room_coord(const f32 v, const f32 room_size)
+{
+    return (i32)floorf(v / room_size);
+}
+
+static inline void world_room_path(char* out, const char* dir, const i32 x, const i32 y)
+{
+    snprintf(out, WORLD_PATH_MAX, "%s/%d_%d.txt", dir, x, y);
+}
+
+// loader thread
+static void world_room_read(World* world, Room* room)
+{
+    room->collision_data.count = 0;
+
+    char path[WORLD_PATH_MAX];
+    world_room_path(path, world->dir, room->x, room->y);
+
+    FILE* in = fopen(path, "r");
+    if (in == nullptr) {
+        return;
+    }
+
+    Collider c;
+    while (fscanf(in, " %f,%f,%f,%f,%f,%f", &c.a.x, &c.a.y, &c.a.z, &c.b.x, &c.b.y, &c.b.z) == 6) {
+        if (room->collision_data.count == ROOM_MAX_COLLIDERS) {
+            fprintf(stderr, "WARNING: %s has more than %d colliders, the rest are ignored\n", path, ROOM_MAX_COLLIDERS);
+            break;
+        }
+        room->collision_data.push_back(c);
+    }
+
+    fclose(in);
+}
+
+static int World_loader_proc(void* data)
+{
+    World* world = (World*)data;
+
+    for (;;) {
+        // one post per queued room, the room may have been evicted again since
+        SDL_SemWait(world->wake);
+        if (SDL_AtomicGet(&world->quit)) {
+            break;
+        }
+
+        foreach (i, WORLD_MAX_ROOMS) {
+            Room* room = &world->rooms[i];
+            if (SDL_AtomicCAS(&room->state, (int)ROOM_STATE::QUEUED, (int)ROOM_STATE::LOADING)) {
+                world_room_read(world, room);
+                SDL_AtomicSet(&room->state, (int)ROOM_STATE::LOADED);
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+bool World_init(World* world, const char* dir, const f32 room_size)
+{
+    if (strlen(dir) >= WORLD_PATH_MAX - 32) {
+        fprintf(stderr, "ERROR: world directory path too long: %s\n", dir);
+        return false;
+    }
+    strcpy(world->dir, dir);
+    world->room_size = room_size;
+
+    if (false == Shader_load_shared_from_file(
+        &world->shader,
+        sd::Render_Batch<>::SHADER_VERTEX_PATH,
+        sd::Render_Batch<>::SHADER_FRAGMENT_PATH
+    )) {
+        fprintf(stderr, "ERROR: world shader could not be loaded\n");
+        return false;
+    }
+
+    world->rooms = (Room*)xcalloc(WORLD_MAX_ROOMS, sizeof(Room));
+    foreach (i, WORLD_MAX_ROOMS) {
+        Room* room = &world->rooms[i];
+        SDL_AtomicSet(&room->state, (int)ROOM_STATE::FREE);
+        sd::Static_Mesh_init(&room->mesh, world->shader.program);
+    }
+
+    SDL_AtomicSet(&world->quit, 0);
+    world->wake   = SDL_CreateSemaphore(0);
+    world->loader = (world->wake == nullptr) ? nullptr :
+        SDL_CreateThread(World_loader_proc, "world_loader", (void*)world);
+
+    if (world->loader == nullptr) {
+        fprintf(stderr, "ERROR: World_init %s\n", SDL_GetError());
+        if (world->wake != nullptr) {
+            SDL_DestroySemaphore(world->wake);
+            world->wake = nullptr;
+        }
+        World_free(world);
+        return false;
+    }
+
+    return true;
+}
+
+static void world_room_build(Room* room)
+{
+    sd::Render_Batch<ROOM_MAX_COLLIDERS * 2>* g = &room->mesh.geometry;
+
+    sd::Static_Mesh_reset(&room->mesh);
+    g->draw_type = sd::LINES;
+    g->color     = Color::BLACK;
+    foreach (i, room->collision_data.count) {
+        sd::line(g, room->collision_data[i].a, room->collision_data[i].b);
+    }
+}
+
+void World_update(World* world, const Vec2 center)
+{
+    const i32 cx = world_room_coord(center.x, world->room_size);
+    const i32 cy = world_room_coord(center.y, world->room_size);
+
+    // rooms wanted this frame that are already present in some state
+    bool present[2 * WORLD_ROOM_RADIUS + 1][2 * WORLD_ROOM_RADIUS + 1] = {};
+
+    foreach (i, WORLD_MAX_ROOMS) {
+        Room* room = &world->rooms[i];
+
+        const i32 dx = room->x - cx;
+        const i32 dy = room->y - cy;
+        const bool keep = glm::abs(dx) <= WORLD_ROOM_RADIUS + 1 && glm::abs(dy) <= WORLD_ROOM_RADIUS + 1;
+
+        switch ((ROOM_STATE)SDL_AtomicGet(&room->state)) {
+        case ROOM_STATE::FREE:
+            continue;
+        case ROOM_STATE::QUEUED:
+            if (!keep && SDL_AtomicCAS(&room->state, (int)ROOM_STATE::QUEUED, (int)ROOM_STATE::FREE)) {
+                continue;
+            }
+            break;
+        case ROOM_STATE::LOADING:
+            // evicted once the loader is done with it
+            break;
+        case ROOM_STATE::LOADED:
+            if (!keep) {
+                SDL_AtomicSet(&room->state, (int)ROOM_STATE::FREE);
+                continue;
+            }
+            world_room_build(room);
+            SDL_AtomicSet(&room->state, (int)ROOM_STATE::RESIDENT);
+            break;
+        case ROOM_STATE::RESIDENT:
+            if (!keep) {
+                SDL_AtomicSet(&room->state, (int)ROOM_STATE::FREE);
+                continue;
+            }
+            break;
+        }
+
+        if (glm::abs(dx) <= WORLD_ROOM_RADIUS && glm::abs(dy) <= WORLD_ROOM_RADIUS) {
+            present[dy + WORLD_ROOM_RADIUS][dx + WORLD_ROOM_RADIUS] = true;
+        }
+    }
+
+    usize next_free = 0;
+    for (i32 dy = -WORLD_ROOM_RADIUS; dy <= WORLD_ROOM_RADIUS; dy += 1) {
+        for (i32 dx = -WORLD_ROOM_RADIUS; dx <= WORLD_ROOM_RADIUS; dx += 1) {
+            if (present[dy + WORLD_ROOM_RADIUS][dx + WORLD_ROOM_RADIUS]) {
+                continue;
+            }
+
+            while (next_free < WORLD_MAX_ROOMS && SDL_AtomicGet(&world->rooms[next_free].state) != (int)ROOM_STATE::FREE) {
+                next_free += 1;
+            }
+            // only possible while far rooms are still loading, retried next frame
+            if (next_free == WORLD_MAX_ROOMS) {
+                return;
+            }
+
+            Room* room = &world->rooms[next_free];
+            room->x = cx + dx;
+            room->y = cy + dy;
+            SDL_AtomicSet(&room->state, (int)ROOM_STATE::QUEUED);
+            SDL_SemPost(world->wake);
+        }
+    }
+}
+
+void World_draw(World* world, sd::Render_Context* ctx, const Mat4& transform, const Vec2 view_min, const Vec2 view_max)
+{
+    foreach (i, WORLD_MAX_ROOMS) {
+        Room* room = &world->rooms[i];
+        if (SDL_AtomicGet(&room->state) != (int)ROOM_STATE::RESIDENT) {
+            continue;
+        }
+
+        sd::cull_rect_set(&room->mesh.geometry, view_min, view_max);
+        sd::Static_Mesh_draw(&room->mesh, ctx, transform);
+    }
+}
+
+usize World_collider_spans(World* world, Collider_Span* out)
+{
+    usize count = 0;
+    foreach (i, WORLD_MAX_ROOMS) {
+        Room* room = &world->rooms[i];
+        if (SDL_AtomicGet(&room->state) != (int)ROOM_STATE::RESIDENT || room->collision_data.count == 0) {
+            continue;
+        }
+
+        out[count].begin = room->collision_data.begin();
+        out[count].end   = room->collision_data.next_free_slot();
+        count += 1;
+    }
+
+    return count;
+}
+
+void World_free(World* world)
+{
+    if (world->loader != nullptr) {
+        SDL_AtomicSet(&world->quit, 1);
+        SDL_SemPost(world->wake);
+        SDL_WaitThread(world->loader, nullptr);
+        world->loader = nullptr;
+    }
+    if (world->wake != nullptr) {
+        SDL_DestroySemaphore(world->wake);
+        world->wake = nullptr;
+    }
+
+    if (world->rooms != nullptr) {
+        foreach (i, WORLD_MAX_ROOMS) {
+            sd::Static_Mesh_free(&world->rooms[i].mesh);
+        }
+        ::free(world->rooms);
+        world->rooms = nullptr;
+    }
+
+    Shader_release(&world->shader);
+}
+
+bool World_partition(const char* src_path, const char* dir, const f32 room_size)
+{
+    FILE* in = fopen(src_path, "r");
+    if (in == nullptr) {
+        fprintf(stderr, "ERROR: could not open %s\n", src_path);
+        return false;
+    }
+
+    usize count = 0;
+    usize cap   = 64;
+    Collider* colliders = (Collider*)xmalloc(cap * sizeof(Collider));
+    i32* room_x = (i32*)xmalloc(cap * sizeof(i32));
+    i32* room_y = (i32*)xmalloc(cap * sizeof(i32));
+
+    Collider c;
+    while (fscanf(in, " %f,%f,%f,%f,%f,%f", &c.a.x, &c.a.y, &c.a.z, &c.b.x, &c.b.y, &c.b.z) == 6) {
+        if (count == cap) {
+            cap *= 2;
+            colliders = (Collider*)xrealloc(colliders, cap * sizeof(Collider));
+            room_x    = (i32*)xrealloc(room_x, cap * sizeof(i32));
+            room_y    = (i32*)xrealloc(room_y, cap * sizeof(i32));
+        }
+
+        colliders[count] = c;
+        room_x[count]    = world_room_coord((c.a.x + c.b.x) * 0.5f, room_size);
+        room_y[count]    = world_room_coord((c.a.y + c.b.y) * 0.5f, room_size);
+        count += 1;
+    }
+    fclose(in);
+
+    // each room is written by its first collider, later ones of the same room are skipped
+    bool ok = true;
+    foreach (i, count) {
+        bool written = false;
+        for (usize k = 0; k < i; k += 1) {
+            if (room_x[k] == room_x[i] && room_y[k] == room_y[i]) {
+                written = true;
+                break;
+            }
+        }
+        if (written) {
+            continue;
+        }
+
+        char path[WORLD_PATH_MAX];
+        world_room_path(path, dir, room_x[i], room_y[i]);
+
+        FILE* out = fopen(path, "w");
+        if (out == nullptr) {
+            fprintf(stderr, "ERROR: could not write %s\n", path);
+            ok = false;
+            break;
+        }
+
+        usize in_room = 0;
+        for (usize k = i; k < count; k += 1) {
+            if (room_x[k] != room_x[i] || room_y[k] != room_y[i]) {
+                continue;
+            }
+
+            const Collider* ck = &colliders[k];
+            fprintf(out, "%f,%f,%f,%f,%f,%f\n", ck->a.x, ck->a.y, ck->a.z, ck->b.x, ck->b.y, ck->b.z);
+            in_room += 1;
+        }
+        fclose(out);
+
+        if (in_room > ROOM_MAX_COLLIDERS) {
+            fprintf(stderr, "WARNING: %s has %llu colliders, only %d are loaded\n", path, (unsigned long long)in_room, ROOM_MAX_COLLIDERS);
+        }
+    }
+
+    ::free(colliders);
+    ::free(room_x);
+    ::free(room_y);
+
+    return ok;
+}
+
+#endif // WORLD_HPP